@@ -0,0 +1,92 @@
+#include "arena.h"
+
+#include <stdlib.h>
+
+// Block headers are padded so the memory following them is aligned:
+#define HEADER_SIZE \
+    ((sizeof(ArenaBlock) + ARENA_ALIGN - 1)/ARENA_ALIGN*ARENA_ALIGN)
+
+// ---------------------------------------------------------------------------
+// Arena functions
+
+/**
+ * Initialize an empty arena.
+ * @param arena arena to initialize.
+ */
+
+void arena_init(Arena *arena) {
+    arena->first = NULL;
+    arena->current = NULL;
+    arena->last = NULL;
+}
+
+
+/**
+ * Allocate memory from an arena, aligned for any type. It stays valid until
+ * the arena is reset or freed.
+ * @param arena arena to allocate from.
+ * @param size number of bytes.
+ * @return the memory, NULL if out of memory.
+ */
+
+void *arena_alloc(Arena *arena, size_t size) {
+    ArenaBlock *block;
+    size_t block_size;
+    
+    size = (size + ARENA_ALIGN - 1)/ARENA_ALIGN*ARENA_ALIGN;
+    
+    // Blocks after the current one are empty, use the first large enough:
+    for(block = arena->current; block != NULL; block = block->next)
+        if(block->size - block->used >= size) {
+            void *memory = (char *)block + HEADER_SIZE + block->used;
+            block->used += size;
+            arena->current = block;
+            return memory;
+        }
+    
+    // None left, add a block:
+    block_size = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+    block = (ArenaBlock *)malloc(HEADER_SIZE + block_size);
+    if(block == NULL) return NULL;
+    block->next = NULL;
+    block->size = block_size;
+    block->used = size;
+    if(arena->last != NULL)
+        arena->last->next = block;
+    else
+        arena->first = block;
+    arena->last = block;
+    arena->current = block;
+    
+    return (char *)block + HEADER_SIZE;
+}
+
+
+/**
+ * Take back all memory allocated from an arena, keeping its blocks for
+ * the next allocations.
+ * @param arena arena to reset.
+ */
+
+void arena_reset(Arena *arena) {
+    for(ArenaBlock *block = arena->first; block != NULL; block = block->next)
+        block->used = 0;
+    arena->current = arena->first;
+}
+
+
+/**
+ * Free the blocks of an arena, it is then empty.
+ * @param arena arena to free.
+ */
+
+void arena_free(Arena *arena) {
+    ArenaBlock *block = arena->first;
+    
+    while(block != NULL) {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    arena_init(arena);
+}
@@ -0,0 +1,45 @@
+/**
+ * Arena allocator.
+ * Memory handed out in order from a list of blocks, and taken back all at
+ * once. Blocks are kept when the arena is reset, so code which allocates
+ * the same amounts between resets (e.g. once per menu refresh) only calls
+ * malloc the first time.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#include "utils.h"
+
+// ---------------------------------------------------------------------------
+// Module constants
+
+#define ARENA_BLOCK_SIZE 4096 /* bytes of a block, unless more is needed */
+#define ARENA_ALIGN _Alignof(max_align_t)
+
+// ---------------------------------------------------------------------------
+// Arena structs
+
+typedef struct ArenaBlock {
+    struct ArenaBlock *next; // next block, NULL for the last one
+    size_t size; // bytes of memory following the block's header
+    size_t used; // bytes handed out since the last reset
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock *first; // NULL until the first allocation
+    ArenaBlock *current; // block allocations are made from
+    ArenaBlock *last; // block new ones are linked after
+} Arena;
+
+// ---------------------------------------------------------------------------
+// Functions Prototypes
+
+void arena_init(Arena *arena);
+void *arena_alloc(Arena *arena, size_t size);
+void arena_reset(Arena *arena);
+void arena_free(Arena *arena);
+
+#endif
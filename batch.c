@@ -0,0 +1,194 @@
+/**
+ * Ez Task batch maintenance - update every user's data file in a directory,
+ * without the interactive menus, on a pool of worker threads.
+ */
+
+#include <stdlib.h>
+#include <dirent.h>
+
+#include "task.h"
+#include "store.h"
+#include "pool.h"
+
+// ---------------------------------------------------------------------------
+// BatchFile struct
+// A data file to be updated, and how it went.
+
+typedef struct {
+    char *file_name; // path of the data file
+    long int task_cnt; // live tasks after updating
+    double secs; // wall-clock time spent on the file
+    int result; // 0 if updated, else -1
+} BatchFile;
+
+int is_sidecar(const char *file_name);
+int compare_files(const void *a, const void *b);
+long int list_data_files(const char *dir_name, BatchFile **files);
+void update_file(void *context, long int job, int worker);
+
+int main(int argc, char *argv[]) {
+    const char *usage = "Usage: %s directory [worker_cnt]\n";
+    BatchFile *files;
+    long int file_cnt;
+    long int task_cnt = 0;
+    long int failed_cnt = 0;
+    double busy_secs = 0;
+    double start, secs;
+    int worker_cnt;
+    
+    if(argc < 2 || argc > 3) {
+        printf(usage, argv[0]);
+        return -1;
+    }
+    worker_cnt = argc > 2 ? atoi(argv[2]) : pool_cpu_cnt();
+    if(worker_cnt < 1 || worker_cnt > POOL_MAX_WORKERS) {
+        printf(usage, argv[0]);
+        return -1;
+    }
+    
+    file_cnt = list_data_files(argv[1], &files);
+    if(file_cnt == UNSUCCESSFUL) {
+        printf("Error: Unable to read directory %s...\n", argv[1]);
+        return -1;
+    }
+    
+    start = get_wall_time();
+    if(pool_run(worker_cnt, file_cnt, update_file, files) == UNSUCCESSFUL) {
+        printf("Error: Unable to start workers...\n");
+        return -1;
+    }
+    secs = get_wall_time() - start;
+    
+    for(long int i = 0; i < file_cnt; i++) {
+        printf("%-40s %10ld tasks %10.3f ms  %s\n",
+               files[i].file_name, files[i].task_cnt, files[i].secs*1e3,
+               files[i].result == SUCCESSFUL ? "ok" : "failed");
+        task_cnt += files[i].task_cnt;
+        busy_secs += files[i].secs;
+        if(files[i].result == UNSUCCESSFUL) failed_cnt++;
+        free(files[i].file_name);
+    }
+    free(files);
+    
+    printf("%ld files (%ld failed), %ld tasks, %d workers\n",
+           file_cnt, failed_cnt, task_cnt, worker_cnt);
+    printf("%.3f s: %.1f files/s, %.2f Mtasks/s, %.2fx parallelism\n",
+           secs, secs > 0 ? file_cnt/secs : 0.0,
+           secs > 0 ? task_cnt/secs/1e6 : 0.0,
+           secs > 0 ? busy_secs/secs : 0.0);
+    
+    return failed_cnt ? -1 : 0;
+}
+
+// ---------------------------------------------------------------------------
+// Helpers
+
+/**
+ * Tell whether a file name is that of a sidecar file rather than a user's
+ * data file. Users whose names end like sidecars are not told apart.
+ * @param file_name name of a file with the data file extension.
+ * @return 1 if it is a sidecar, else 0.
+ */
+
+int is_sidecar(const char *file_name) {
+    const char *postfixes[] = {INDEX_POSTFIX, BTREE_POSTFIX, JOURNAL_POSTFIX,
+                               LOCK_POSTFIX, TMP_POSTFIX};
+    size_t len = strlen(file_name) - strlen(DATAFILE_EXTENSION);
+    
+    for(size_t i = 0; i < sizeof(postfixes)/sizeof(postfixes[0]); i++) {
+        size_t postfix_len = strlen(postfixes[i]);
+        if(len >= postfix_len
+           && strncmp(file_name + len - postfix_len, postfixes[i],
+                      postfix_len) == 0)
+            return 1;
+    }
+    
+    return 0;
+}
+
+
+/**
+ * Order files by name, for qsort.
+ */
+
+int compare_files(const void *a, const void *b) {
+    return strcmp(((const BatchFile *)a)->file_name,
+                  ((const BatchFile *)b)->file_name);
+}
+
+
+/**
+ * Find the users' data files of a directory.
+ * @param dir_name name of the directory.
+ * @param files place-holder for the files found, ordered by name. Remember
+ *        to free it, and the name of every file.
+ * @return number of files found if successful, else -1.
+ */
+
+long int list_data_files(const char *dir_name, BatchFile **files) {
+    DIR *dir;
+    struct dirent *entry;
+    size_t ext_len = strlen(DATAFILE_EXTENSION);
+    long int file_cnt = 0;
+    long int file_cap = 64;
+    
+    dir = opendir(dir_name);
+    if(dir == NULL) return UNSUCCESSFUL;
+    *files = (BatchFile *)malloc(file_cap*sizeof(BatchFile));
+    if(*files == NULL) {
+        closedir(dir);
+        return UNSUCCESSFUL;
+    }
+    
+    while((entry = readdir(dir)) != NULL) {
+        size_t len = strlen(entry->d_name);
+        BatchFile *file;
+        
+        if(len <= ext_len
+           || strcmp(entry->d_name + len - ext_len, DATAFILE_EXTENSION)
+           || is_sidecar(entry->d_name))
+            continue;
+        
+        if(file_cnt == file_cap) {
+            BatchFile *grown = (BatchFile *)realloc(
+                *files, 2*file_cap*sizeof(BatchFile));
+            if(grown == NULL) break;
+            *files = grown;
+            file_cap *= 2;
+        }
+        file = *files + file_cnt;
+        memset(file, 0, sizeof(BatchFile));
+        file->file_name = (char *)malloc(strlen(dir_name) + len + 2);
+        if(file->file_name == NULL) break;
+        sprintf(file->file_name, "%s/%s", dir_name, entry->d_name);
+        file->result = UNSUCCESSFUL;
+        file_cnt++;
+    }
+    closedir(dir);
+    
+    qsort(*files, file_cnt, sizeof(BatchFile), compare_files);
+    return file_cnt;
+}
+
+
+/**
+ * Update all tasks of a data file, run by the pool's workers. Files opened
+ * by an interactive session are left alone.
+ * @param context the files to update.
+ * @param job number of the file to update.
+ * @param worker number of the worker running the job.
+ */
+
+void update_file(void *context, long int job, int worker) {
+    BatchFile *file = (BatchFile *)context + job;
+    TaskStore store;
+    double start = get_wall_time();
+    
+    (void)worker;
+    if(store_open(&store, file->file_name, STORE_WRITE) == SUCCESSFUL) {
+        file->result = update_all_tasks(&store);
+        file->task_cnt = store.live_cnt;
+        store_close(&store);
+    }
+    file->secs = get_wall_time() - start;
+}
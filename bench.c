@@ -0,0 +1,1566 @@
+/**
+ * Ez Task benchmarks - time task.c operations on synthetic data files.
+ */
+
+#include <stdlib.h>
+
+#include "task.h"
+#include "store.h"
+#include "itree.h"
+#include "filter.h"
+#include "occur.h"
+#include "reminder.h"
+#include "rank.h"
+
+#define BENCH_FILE_NAME "bench.dat"
+#define BENCH_TASK_CNT 100000
+#define BENCH_STALE_DAYS 3650
+#define BENCH_INTERVAL_CNT 1000000
+#define BENCH_TREE_QUERY_CNT 100000
+#define BENCH_SCAN_QUERY_CNT 100
+#define BENCH_FILTER_CNT 100
+#define BENCH_SUITE_MAX_TASK_CNT 1000000
+#define BENCH_SUITE_DELETE_CNT 1000
+#define BENCH_MIN_SECS 0.2 /* shortest timing of a query, in seconds */
+#define BENCH_READ_BATCH_SIZE 256
+#define BENCH_TIME_CNT 1000000
+#define BENCH_TIME_SPAN_DAYS 28
+#define BENCH_OCCUR_DAYS 30
+#define BENCH_OCCUR_BATCH_SIZE 256
+#define BENCH_REMIND_TASK_CNT 1000000
+#define BENCH_REMIND_DAYS 7
+#define BENCH_JITTER_TASK_CNT 1000
+#define BENCH_JITTER_SECS 3
+#define BENCH_ENGINE_OP_CNT 10000
+#define BENCH_LOOKUP_CNT 100000
+#define BENCH_SCAN_LOOKUP_CNT 100
+#define BENCH_TOP_CNT 10
+#define BENCH_TOP_STEP_CNT 100
+
+// ---------------------------------------------------------------------------
+// GenSpec struct
+// Make-up of a synthetic data file. Tasks are rated from 0 to 255, evenly
+// for an importance_skew of 1, mostly low for higher skews. Tasks which are
+// not stale start within a day ago and two weeks from now.
+
+typedef struct {
+    long int task_cnt; // number of tasks
+    int daily_pct; // percentage of daily tasks
+    int weekly_pct; // percentage of weekly tasks, the others happen once
+    int stale_pct; // percentage of tasks last updated stale_days ago
+    int stale_days; // negative for tasks that many days ahead
+    int importance_skew; // at least 1
+} GenSpec;
+
+// Make-up of the suite's files, and of generated ones by default:
+const GenSpec default_spec = {BENCH_TASK_CNT, 20, 20, 10, 30, 2};
+const char *kernel_names[] = {"scalar", "sse4.2", "avx2"};
+
+// ---------------------------------------------------------------------------
+// Lateness struct
+// Reminders notified during a benchmark, and how late.
+
+typedef struct {
+    long int notified_cnt; // number of reminders
+    int64_t max_lateness; // latest reminder, in nanoseconds
+    double total_lateness; // sum over all reminders, in nanoseconds
+    int64_t *samples; // lateness of each reminder, NULL if not kept
+    long int sample_cap; // most samples kept
+} Lateness;
+
+void print_usage(const char *program);
+int make_data_file(const char *file_name, const GenSpec *spec);
+int make_stale_file(const char *file_name, long int task_cnt, int stale_days);
+void update_task_loop(Task *task, time_t now);
+double secs_since(clock_t start);
+void ref_time2str(time_t t, char *s);
+time_t ref_midnight(time_t t, int day_offset);
+int bench_update(long int task_cnt, int stale_days);
+int bench_collisions(long int interval_cnt);
+int bench_filter(long int task_cnt);
+int bench_dashboard(long int task_cnt);
+int bench_calendar(long int time_cnt, int span_days);
+int compare_occurrences(const void *a, const void *b);
+int bench_occurrences(long int task_cnt, int days);
+void count_reminder(void *context, const Task *task, int64_t lateness);
+int compare_lateness(const void *a, const void *b);
+int bench_reminders(long int task_cnt, int days, long int jitter_cnt);
+int check_index(const TaskStore *store);
+int bench_engines(long int task_cnt);
+int bench_ids(long int task_cnt);
+int compare_ranked(const void *a, const void *b);
+long int rank_by_sort(RankedTask *tasks, const TaskStore *store, time_t now);
+int check_ranking(const Ranking *ranking,
+                  int ranked_cnt,
+                  RankedTask *sorted,
+                  const TaskStore *store,
+                  time_t now);
+int bench_top(long int task_cnt);
+double time_query(int (*query)(TaskStore *),
+                  TaskStore *store,
+                  long int *run_cnt);
+int query_task_cnt(TaskStore *store);
+int query_read_tasks(TaskStore *store);
+int query_next_task(TaskStore *store);
+int query_day_tasks(TaskStore *store);
+int query_week_tasks(TaskStore *store);
+void print_result(long int task_cnt,
+                  const char *operation,
+                  long int run_cnt,
+                  double secs);
+int bench_suite(long int max_task_cnt);
+
+int main(int argc, char *argv[]) {
+    int result;
+    
+    if(argc > 1 && strcmp(argv[1], "update") == 0) {
+        long int task_cnt = argc > 2 ? atol(argv[2]) : BENCH_TASK_CNT;
+        int stale_days = argc > 3 ? atoi(argv[3]) : BENCH_STALE_DAYS;
+        if(task_cnt < 1 || stale_days < 0) {
+            print_usage(argv[0]);
+            return -1;
+        }
+        result = bench_update(task_cnt, stale_days);
+    } else if(argc > 1 && strcmp(argv[1], "collisions") == 0) {
+        long int interval_cnt = argc > 2 ? atol(argv[2]) : BENCH_INTERVAL_CNT;
+        if(interval_cnt < 1) {
+            print_usage(argv[0]);
+            return -1;
+        }
+        result = bench_collisions(interval_cnt);
+    } else if(argc > 1 && strcmp(argv[1], "filter") == 0) {
+        long int task_cnt = argc > 2 ? atol(argv[2]) : BENCH_TASK_CNT;
+        if(task_cnt < 1) {
+            print_usage(argv[0]);
+            return -1;
+        }
+        result = bench_filter(task_cnt);
+    } else if(argc > 1 && strcmp(argv[1], "dashboard") == 0) {
+        long int task_cnt = argc > 2 ? atol(argv[2]) : BENCH_TASK_CNT;
+        if(task_cnt < 1) {
+            print_usage(argv[0]);
+            return -1;
+        }
+        result = bench_dashboard(task_cnt);
+    } else if(argc > 1 && strcmp(argv[1], "calendar") == 0) {
+        long int time_cnt = argc > 2 ? atol(argv[2]) : BENCH_TIME_CNT;
+        int span_days = argc > 3 ? atoi(argv[3]) : BENCH_TIME_SPAN_DAYS;
+        if(time_cnt < 1 || span_days < 1) {
+            print_usage(argv[0]);
+            return -1;
+        }
+        result = bench_calendar(time_cnt, span_days);
+    } else if(argc > 1 && strcmp(argv[1], "occurrences") == 0) {
+        long int task_cnt = argc > 2 ? atol(argv[2]) : BENCH_TASK_CNT;
+        int days = argc > 3 ? atoi(argv[3]) : BENCH_OCCUR_DAYS;
+        if(task_cnt < 1 || days < 1) {
+            print_usage(argv[0]);
+            return -1;
+        }
+        result = bench_occurrences(task_cnt, days);
+    } else if(argc > 1 && strcmp(argv[1], "reminders") == 0) {
+        long int task_cnt = argc > 2 ? atol(argv[2]) : BENCH_REMIND_TASK_CNT;
+        int days = argc > 3 ? atoi(argv[3]) : BENCH_REMIND_DAYS;
+        long int jitter_cnt = argc > 4 ? atol(argv[4])
+                                       : BENCH_JITTER_TASK_CNT;
+        if(task_cnt < 1 || days < 1 || jitter_cnt < 1) {
+            print_usage(argv[0]);
+            return -1;
+        }
+        result = bench_reminders(task_cnt, days, jitter_cnt);
+    } else if(argc > 1 && strcmp(argv[1], "engines") == 0) {
+        long int task_cnt = argc > 2 ? atol(argv[2]) : BENCH_TASK_CNT;
+        if(task_cnt < 1) {
+            print_usage(argv[0]);
+            return -1;
+        }
+        result = bench_engines(task_cnt);
+    } else if(argc > 1 && strcmp(argv[1], "ids") == 0) {
+        long int task_cnt = argc > 2 ? atol(argv[2]) : BENCH_TASK_CNT;
+        if(task_cnt < 1) {
+            print_usage(argv[0]);
+            return -1;
+        }
+        result = bench_ids(task_cnt);
+    } else if(argc > 1 && strcmp(argv[1], "top") == 0) {
+        long int task_cnt = argc > 2 ? atol(argv[2]) : BENCH_TASK_CNT;
+        if(task_cnt < 1) {
+            print_usage(argv[0]);
+            return -1;
+        }
+        result = bench_top(task_cnt);
+    } else if(argc > 1 && strcmp(argv[1], "suite") == 0) {
+        long int max_task_cnt = argc > 2 ? atol(argv[2])
+                                         : BENCH_SUITE_MAX_TASK_CNT;
+        if(max_task_cnt < 1) {
+            print_usage(argv[0]);
+            return -1;
+        }
+        result = bench_suite(max_task_cnt);
+    } else if(argc > 2 && strcmp(argv[1], "generate") == 0) {
+        GenSpec spec = default_spec;
+        if(argc > 3) spec.task_cnt = atol(argv[3]);
+        if(argc > 4) spec.daily_pct = atoi(argv[4]);
+        if(argc > 5) spec.weekly_pct = atoi(argv[5]);
+        if(argc > 6) spec.stale_pct = atoi(argv[6]);
+        if(argc > 7) spec.stale_days = atoi(argv[7]);
+        if(argc > 8) spec.importance_skew = atoi(argv[8]);
+        if(spec.task_cnt < 0 || spec.daily_pct < 0 || spec.weekly_pct < 0
+           || spec.daily_pct + spec.weekly_pct > 100
+           || spec.stale_pct < 0 || spec.stale_pct > 100
+           || spec.importance_skew < 1) {
+            print_usage(argv[0]);
+            return -1;
+        }
+        if(make_data_file(argv[2], &spec) == UNSUCCESSFUL) {
+            printf("Error: Unable to create file %s...\n", argv[2]);
+            return -1;
+        }
+        return 0; // keep the file
+    } else {
+        print_usage(argv[0]);
+        return -1;
+    }
+    
+    store_unlink(BENCH_FILE_NAME);
+    return result == UNSUCCESSFUL ? -1 : 0;
+}
+
+// ---------------------------------------------------------------------------
+// Helpers
+
+/**
+ * Print how to run the benchmarks.
+ * @param program name the program was run with.
+ */
+
+void print_usage(const char *program) {
+    const char *usages[] = {
+        "update [task_cnt] [stale_days]",
+        "collisions [interval_cnt]",
+        "filter [task_cnt]",
+        "dashboard [task_cnt]",
+        "calendar [time_cnt] [span_days]",
+        "occurrences [task_cnt] [days]",
+        "reminders [task_cnt] [days] [jitter_cnt]",
+        "engines [task_cnt]",
+        "ids [task_cnt]",
+        "top [task_cnt]",
+        "suite [max_task_cnt]",
+        "generate file_name [task_cnt] [daily_pct] [weekly_pct] [stale_pct]"
+        " [stale_days] [importance_skew]"
+    };
+    
+    for(size_t i = 0; i < sizeof(usages)/sizeof(usages[0]); i++)
+        printf("%s %s %s\n", i ? "      " : "Usage:", program, usages[i]);
+}
+
+
+/**
+ * Write a synthetic data file, replacing any previous one and its sidecar
+ * files. Recurrences are dealt out by position, the rest at random, so
+ * whether a task is stale does not depend on its recurrence.
+ * @param file_name name of the file to create.
+ * @param spec make-up of the file.
+ * @return 0 if successful, else -1.
+ */
+
+int make_data_file(const char *file_name, const GenSpec *spec) {
+    FILE *fp;
+    FileHeader header;
+    Task task;
+    time_t now;
+    double u;
+    
+    store_unlink(file_name);
+    fp = fopen(file_name, "wb");
+    if(fp == NULL) return UNSUCCESSFUL;
+    store_init_header(&header);
+    header.next_id = spec->task_cnt + 1;
+    fwrite(&header, sizeof(FileHeader), 1, fp);
+    
+    time(&now);
+    srand(1);
+    memset(&task, 0, sizeof(Task));
+    for(long int i = 0; i < spec->task_cnt; i++) {
+        int pct = i%100;
+        task.t_id = i + 1;
+        sprintf(task.t_name, "Task %ld", i);
+        if(rand()%100 < spec->stale_pct)
+            task.t_time = now - (time_t)spec->stale_days*SECS_PER_DAY
+                          - rand()%SECS_PER_DAY;
+        else
+            task.t_time = now - SECS_PER_DAY
+                          + ((time_t)rand()*RAND_MAX + rand())
+                            %(2*SECS_PER_WEEK + SECS_PER_DAY);
+        task.t_duration_in_mins = rand()%(2*MINS_PER_HOUR) + 1;
+        task.t_repeat_cnt = 0;
+        u = (double)rand()/((double)RAND_MAX + 1);
+        for(int j = 1; j < spec->importance_skew; j++)
+            u *= (double)rand()/((double)RAND_MAX + 1);
+        task.t_importance_rtn = (uint8_t)(u*256);
+        task.flags = FLAG_ACTIVE;
+        if(pct < spec->daily_pct)
+            task.flags |= FLAG_DAILY;
+        else if(pct < spec->daily_pct + spec->weekly_pct)
+            task.flags |= FLAG_WEEKLY;
+        if(fwrite(&task, sizeof(Task), 1, fp) != 1) {
+            fclose(fp);
+            return UNSUCCESSFUL;
+        }
+    }
+    
+    return fclose(fp) == 0 ? SUCCESSFUL : UNSUCCESSFUL;
+}
+
+
+/**
+ * Write a data file of recurrent tasks which have not been updated for a
+ * number of days.
+ * @param file_name name of the file to create.
+ * @param task_cnt number of tasks to write.
+ * @param stale_days how long ago the tasks were last updated.
+ * @return 0 if successful, else -1.
+ */
+
+int make_stale_file(const char *file_name, long int task_cnt, int stale_days) {
+    GenSpec spec = {task_cnt, 50, 50, 100, stale_days, 1};
+    return make_data_file(file_name, &spec);
+}
+
+
+/**
+ * Reference update: step recurrent tasks one period at a time.
+ * @param task the task being checked.
+ * @param now time used as reference.
+ */
+
+void update_task_loop(Task *task, time_t now) {
+    if(now<get_end_time(task))
+        return;
+    
+    if(task->flags & FLAG_DAILY)
+        while(now>=get_end_time(task)) {
+            task->t_time += SECS_PER_DAY;
+            task->t_repeat_cnt++;
+        }
+    else if(task->flags & FLAG_WEEKLY)
+        while(now>=get_end_time(task)) {
+            task->t_time += SECS_PER_WEEK;
+            task->t_repeat_cnt++;
+        }
+    else
+        task->flags &= ~FLAG_ACTIVE;
+}
+
+
+/**
+ * Processor time spent since a given clock value, in seconds.
+ */
+
+double secs_since(clock_t start) {
+    return (double)(clock() - start)/CLOCKS_PER_SEC;
+}
+
+
+/**
+ * Reference time2str: convert with the time zone on every call.
+ * @param t time to format.
+ * @param s place-holder for the string, room for TIME_STR_LEN chars.
+ */
+
+void ref_time2str(time_t t, char *s) {
+    strftime(s, TIME_STR_LEN, "%H:%M %d/%m/%Y", localtime(&t));
+}
+
+
+/**
+ * Reference get_midnight and get_weekend_midnight: convert with the time
+ * zone on every call.
+ * @param t time in question.
+ * @param day_offset 0 for get_midnight, else get_weekend_midnight.
+ * @return the midnight.
+ */
+
+time_t ref_midnight(time_t t, int day_offset) {
+    struct tm time_info = *localtime(&t);
+    
+    time_info.tm_mday += day_offset ? 8 - time_info.tm_wday : 1;
+    time_info.tm_hour = 0;
+    time_info.tm_min = 0;
+    time_info.tm_sec = 0;
+    time_info.tm_isdst = -1;
+    
+    return mktime(&time_info);
+}
+
+/**
+ * Time a query, running it as many times as needed to last BENCH_MIN_SECS.
+ * @param query query to time.
+ * @param store opened data file, passed to the query.
+ * @param run_cnt place-holder for the number of runs.
+ * @return wall-clock time per run, in seconds.
+ */
+
+double time_query(int (*query)(TaskStore *),
+                  TaskStore *store,
+                  long int *run_cnt) {
+    double start, secs;
+    
+    *run_cnt = 1;
+    for(;;) {
+        start = get_wall_time();
+        for(long int i = 0; i < *run_cnt; i++) query(store);
+        secs = get_wall_time() - start;
+        if(secs >= BENCH_MIN_SECS) break;
+        *run_cnt *= 2;
+    }
+    
+    return secs / *run_cnt;
+}
+
+
+/**
+ * Queries timed by the suite.
+ */
+
+int query_task_cnt(TaskStore *store) {
+    return (int)get_task_cnt(store);
+}
+
+int query_read_tasks(TaskStore *store) {
+    Task buffer[BENCH_READ_BATCH_SIZE];
+    long int index = 0;
+    int read_cnt;
+    
+    while((read_cnt = read_tasks(buffer, index, BENCH_READ_BATCH_SIZE,
+                                 store)) > 0)
+        index += read_cnt;
+    
+    return (int)index;
+}
+
+int query_next_task(TaskStore *store) {
+    Task task;
+    return get_next_task(&task, 0, store);
+}
+
+int query_day_tasks(TaskStore *store) {
+    TaskView view;
+    int task_cnt;
+    
+    store_view_all(&view, store);
+    task_cnt = get_day_tasks(&view, store);
+    store_view_free(&view);
+    
+    return task_cnt;
+}
+
+int query_week_tasks(TaskStore *store) {
+    TaskView view;
+    int task_cnt;
+    
+    store_view_all(&view, store);
+    task_cnt = get_week_tasks(&view, store);
+    store_view_free(&view);
+    
+    return task_cnt;
+}
+
+
+/**
+ * Print the timing of an operation as a JSON object of the suite's
+ * results.
+ * @param task_cnt number of tasks in the data file.
+ * @param operation name of the operation.
+ * @param run_cnt number of runs timed.
+ * @param secs wall-clock time per run, in seconds.
+ */
+
+void print_result(long int task_cnt,
+                  const char *operation,
+                  long int run_cnt,
+                  double secs) {
+    static int result_cnt = 0;
+    
+    printf("%s\n    {\"task_cnt\": %ld, \"operation\": \"%s\", "
+           "\"runs\": %ld, \"secs_per_run\": %.9f, "
+           "\"runs_per_sec\": %.1f}",
+           result_cnt++ ? "," : "", task_cnt, operation, run_cnt, secs,
+           secs > 0 ? 1/secs : 0.0);
+}
+
+
+// ---------------------------------------------------------------------------
+// Benchmarks
+
+/**
+ * Compare the step-by-step update against update_task_at on stale tasks.
+ * @param task_cnt number of tasks in the synthetic file.
+ * @param stale_days how long ago the tasks were last updated.
+ * @return 0 if both methods agree, else -1.
+ */
+
+int bench_update(long int task_cnt, int stale_days) {
+    TaskStore store;
+    Task *tasks;
+    clock_t start;
+    time_t now;
+    double loop_secs, closed_secs;
+    long int mismatch_cnt = 0;
+    
+    if(make_stale_file(BENCH_FILE_NAME, task_cnt, stale_days)
+       == UNSUCCESSFUL
+       || store_open(&store, BENCH_FILE_NAME, STORE_WRITE) == UNSUCCESSFUL) {
+        printf("Error: Unable to create benchmark file...\n");
+        return UNSUCCESSFUL;
+    }
+    
+    tasks = (Task *)malloc(task_cnt*sizeof(Task));
+    memcpy(tasks, store.tasks, task_cnt*sizeof(Task));
+    
+    time(&now);
+    start = clock();
+    for(long int i = 0; i < task_cnt; i++)
+        update_task_loop(tasks + i, now);
+    loop_secs = secs_since(start);
+    
+    start = clock();
+    for(long int i = 0; i < task_cnt; i++)
+        update_task_at(store.tasks + i, now);
+    closed_secs = secs_since(start);
+    
+    for(long int i = 0; i < task_cnt; i++)
+        if(tasks[i].t_time != store.tasks[i].t_time
+           || tasks[i].t_repeat_cnt != store.tasks[i].t_repeat_cnt)
+            mismatch_cnt++;
+    
+    printf("update (%ld tasks, %d days stale)\n", task_cnt, stale_days);
+    printf("  loop:        %10.6f s\n", loop_secs);
+    printf("  closed-form: %10.6f s\n", closed_secs);
+    printf("  mismatches:  %ld\n", mismatch_cnt);
+    
+    free(tasks);
+    store_close(&store);
+    
+    return mismatch_cnt ? UNSUCCESSFUL : SUCCESSFUL;
+}
+
+
+/**
+ * Compare interval tree lookups against pairwise scanning.
+ * Intervals are spread over a year and last up to two hours, like tasks.
+ * @param interval_cnt number of intervals in the tree.
+ * @return 0 if both methods agree, else -1.
+ */
+
+int bench_collisions(long int interval_cnt) {
+    IntervalTree tree;
+    int64_t (*intervals)[2];
+    int64_t slots[1];
+    clock_t start;
+    double build_secs, tree_secs, scan_secs;
+    long int tree_found = 0, scan_found = 0;
+    long int mismatch_cnt = 0;
+    
+    intervals = malloc(interval_cnt*sizeof(*intervals));
+    if(intervals == NULL) return UNSUCCESSFUL;
+    srand(1);
+    for(long int i = 0; i < interval_cnt; i++) {
+        intervals[i][0] = ((int64_t)rand()*RAND_MAX + rand())
+                          %(365*(int64_t)SECS_PER_DAY);
+        intervals[i][1] = intervals[i][0]
+                          + (rand()%(2*MINS_PER_HOUR) + 1)*SECS_PER_MIN;
+    }
+    
+    itree_init(&tree);
+    start = clock();
+    for(long int i = 0; i < interval_cnt; i++)
+        if(itree_insert(&tree, intervals[i][0], intervals[i][1], i)
+           == UNSUCCESSFUL) {
+            printf("Error: Out of memory...\n");
+            free(intervals);
+            itree_free(&tree);
+            return UNSUCCESSFUL;
+        }
+    build_secs = secs_since(start);
+    
+    // Query with the intervals themselves, as if adding them again:
+    start = clock();
+    for(long int q = 0; q < BENCH_TREE_QUERY_CNT; q++) {
+        long int i = q%interval_cnt;
+        tree_found += itree_overlaps(&tree, intervals[i][0], intervals[i][1],
+                                     slots, 0);
+    }
+    tree_secs = secs_since(start);
+    
+    start = clock();
+    for(long int q = 0; q < BENCH_SCAN_QUERY_CNT; q++) {
+        long int i = q%interval_cnt;
+        long int found = 0;
+        for(long int j = 0; j < interval_cnt; j++)
+            if(intervals[j][0] < intervals[i][1]
+               && intervals[i][0] < intervals[j][1])
+                found++;
+        scan_found += found;
+        if(found != itree_overlaps(&tree, intervals[i][0], intervals[i][1],
+                                   slots, 0))
+            mismatch_cnt++;
+    }
+    scan_secs = secs_since(start);
+    
+    printf("collisions (%ld intervals)\n", interval_cnt);
+    printf("  build:       %10.6f s\n", build_secs);
+    printf("  tree query:  %10.3f us (%ld overlaps in %d queries)\n",
+           tree_secs*1e6/BENCH_TREE_QUERY_CNT, tree_found,
+           BENCH_TREE_QUERY_CNT);
+    printf("  scan query:  %10.3f us (%ld overlaps in %d queries)\n",
+           scan_secs*1e6/BENCH_SCAN_QUERY_CNT, scan_found,
+           BENCH_SCAN_QUERY_CNT);
+    printf("  mismatches:  %ld\n", mismatch_cnt);
+    
+    free(intervals);
+    itree_free(&tree);
+    
+    return mismatch_cnt ? UNSUCCESSFUL : SUCCESSFUL;
+}
+
+
+/**
+ * Compare filtering whole records against filtering the store's columns
+ * with each kernel, with get_week_tasks' filter.
+ * Tasks are spread over the last and next two weeks, to be updated first.
+ * @param task_cnt number of tasks in the synthetic file.
+ * @return 0 if all methods agree, else -1.
+ */
+
+int bench_filter(long int task_cnt) {
+    TaskStore store;
+    uint64_t *bitmap;
+    clock_t start;
+    time_t now;
+    time_t weekend;
+    double secs;
+    long int row_found = 0;
+    long int mismatch_cnt = 0;
+    int default_kernel;
+    
+    if(make_stale_file(BENCH_FILE_NAME, task_cnt, -14) == UNSUCCESSFUL
+       || store_open(&store, BENCH_FILE_NAME, STORE_WRITE) == UNSUCCESSFUL) {
+        printf("Error: Unable to create benchmark file...\n");
+        return UNSUCCESSFUL;
+    }
+    srand(2);
+    for(long int i = 0; i < task_cnt; i++) {
+        store.tasks[i].t_time -= rand()%(4*SECS_PER_WEEK);
+        if(i%4 == 0) store.tasks[i].flags &= ~FLAG_ACTIVE;
+    }
+    columns_build(&store.cols, store.tasks, store.task_cnt);
+    bitmap = malloc(BITMAP_WORDS(task_cnt)*sizeof(uint64_t));
+    
+    time(&now);
+    weekend = get_weekend_midnight(now) + SECS_PER_WEEK;
+    
+    printf("filter (%ld tasks)\n", task_cnt);
+    
+    start = clock();
+    for(int q = 0; q < BENCH_FILTER_CNT; q++)
+        for(long int i = 0; i < task_cnt; i++) {
+            const Task *task = store.tasks + i;
+            if(task->flags & FLAG_ACTIVE
+               && task->t_time > now
+               && task->t_time < weekend
+               && task->t_importance_rtn >= IMPORTANCE_THRESHOLD)
+                row_found++;
+        }
+    secs = secs_since(start);
+    printf("  records:     %10.1f Mtasks/s (%ld matches)\n",
+           task_cnt*BENCH_FILTER_CNT/secs/1e6, row_found/BENCH_FILTER_CNT);
+    
+    default_kernel = filter_get_kernel();
+    for(int kernel = FILTER_SCALAR; kernel <= FILTER_AVX2; kernel++) {
+        long int found = 0;
+        
+        if(filter_use_kernel(kernel) == UNSUCCESSFUL) {
+            printf("  %-12s unsupported\n", kernel_names[kernel]);
+            continue;
+        }
+        start = clock();
+        for(int q = 0; q < BENCH_FILTER_CNT; q++)
+            found += filter_upcoming(&store.cols, task_cnt, now, weekend,
+                                     IMPORTANCE_THRESHOLD, bitmap);
+        secs = secs_since(start);
+        printf("  %-12s %10.1f Mtasks/s (%ld matches)\n",
+               kernel_names[kernel], task_cnt*BENCH_FILTER_CNT/secs/1e6,
+               found/BENCH_FILTER_CNT);
+        if(found != row_found) mismatch_cnt++;
+    }
+    printf("  mismatches:  %ld\n", mismatch_cnt);
+    filter_use_kernel(default_kernel);
+    
+    free(bitmap);
+    store_close(&store);
+    
+    return mismatch_cnt ? UNSUCCESSFUL : SUCCESSFUL;
+}
+
+
+/**
+ * Compare the main menu's separate queries against get_dashboard.
+ * The watermark is reset before each refresh, so both update every task.
+ * Tasks are spread over the last and next two weeks.
+ * @param task_cnt number of tasks in the synthetic file.
+ * @return 0 if both methods agree, else -1.
+ */
+
+int bench_dashboard(long int task_cnt) {
+    TaskStore store;
+    TaskView view;
+    Dashboard dashboard;
+    Arena arena;
+    Task *current_tasks;
+    clock_t start;
+    time_t now;
+    double separate_secs, fused_secs;
+    int current_cnt, day_cnt, week_cnt;
+    int mismatch_cnt;
+    
+    if(make_stale_file(BENCH_FILE_NAME, task_cnt, -14) == UNSUCCESSFUL
+       || store_open(&store, BENCH_FILE_NAME, STORE_WRITE) == UNSUCCESSFUL) {
+        printf("Error: Unable to create benchmark file...\n");
+        return UNSUCCESSFUL;
+    }
+    srand(2);
+    for(long int i = 0; i < task_cnt; i++)
+        store.tasks[i].t_time -= rand()%(4*SECS_PER_WEEK);
+    columns_build(&store.cols, store.tasks, store.task_cnt);
+    store_reindex(&store);
+    store_view_all(&view, &store);
+    arena_init(&arena);
+    
+    start = clock();
+    for(int q = 0; q < BENCH_FILTER_CNT; q++) {
+        arena_reset(&arena);
+        store_set_next_expiry(&store, 0);
+        update_all_tasks(&store);
+        get_current_tasks(&current_tasks, &arena, &store);
+        get_day_tasks(&view, &store);
+        get_week_tasks(&view, &store);
+    }
+    separate_secs = secs_since(start);
+    
+    start = clock();
+    for(int q = 0; q < BENCH_FILTER_CNT; q++) {
+        arena_reset(&arena);
+        store_set_next_expiry(&store, 0);
+        get_dashboard(&dashboard, &arena, &store);
+    }
+    fused_secs = secs_since(start);
+    
+    // Compare once more, within the same second:
+    do {
+        time(&now);
+        arena_reset(&arena);
+        current_cnt = get_current_tasks(&current_tasks, &arena, &store);
+        day_cnt = get_day_tasks(&view, &store);
+        week_cnt = get_week_tasks(&view, &store);
+        get_dashboard(&dashboard, &arena, &store);
+    } while(time(NULL) != now);
+    mismatch_cnt = (current_cnt != dashboard.current_cnt)
+                   + (day_cnt != dashboard.day_cnt)
+                   + (week_cnt != dashboard.week_cnt);
+    
+    printf("dashboard (%ld tasks)\n", task_cnt);
+    printf("  separate:    %10.3f us per refresh\n",
+           separate_secs*1e6/BENCH_FILTER_CNT);
+    printf("  fused:       %10.3f us per refresh\n",
+           fused_secs*1e6/BENCH_FILTER_CNT);
+    printf("  mismatches:  %d\n", mismatch_cnt);
+    
+    arena_free(&arena);
+    store_view_free(&view);
+    store_close(&store);
+    
+    return mismatch_cnt ? UNSUCCESSFUL : SUCCESSFUL;
+}
+
+
+/**
+ * Compare converting times with the time zone on every call against the
+ * per-day cache of time2str, get_midnight and get_weekend_midnight.
+ * Times are spread over a number of days from now, in random order like
+ * tasks in a file.
+ * @param time_cnt number of times converted.
+ * @param span_days number of days the times are spread over.
+ * @return 0 if both methods agree, else -1.
+ */
+
+int bench_calendar(long int time_cnt, int span_days) {
+    time_t *times;
+    char ref_str[TIME_STR_LEN], str[TIME_STR_LEN];
+    clock_t start;
+    time_t now;
+    time_t sum = 0;
+    double ref_secs, cached_secs;
+    long int mismatch_cnt = 0;
+    
+    times = (time_t *)malloc(time_cnt*sizeof(time_t));
+    if(times == NULL) return UNSUCCESSFUL;
+    time(&now);
+    srand(4);
+    for(long int i = 0; i < time_cnt; i++)
+        times[i] = now + ((time_t)rand()*RAND_MAX + rand())
+                         %((time_t)span_days*SECS_PER_DAY);
+    
+    start = clock();
+    for(long int i = 0; i < time_cnt; i++) {
+        ref_time2str(times[i], ref_str);
+        sum += ref_midnight(times[i], 0) + ref_midnight(times[i], 1)
+               + ref_str[0];
+    }
+    ref_secs = secs_since(start);
+    
+    start = clock();
+    for(long int i = 0; i < time_cnt; i++) {
+        time2str(times + i, str);
+        sum -= get_midnight(times[i]) + get_weekend_midnight(times[i])
+               + str[0];
+    }
+    cached_secs = secs_since(start);
+    
+    for(long int i = 0; i < time_cnt; i++) {
+        ref_time2str(times[i], ref_str);
+        if(strcmp(ref_str, time2str(times + i, str)) != 0
+           || ref_midnight(times[i], 0) != get_midnight(times[i])
+           || ref_midnight(times[i], 1) != get_weekend_midnight(times[i]))
+            mismatch_cnt++;
+    }
+    
+    printf("calendar (%ld times over %d days)\n", time_cnt, span_days);
+    printf("  localtime:   %10.3f ns per time\n", ref_secs*1e9/time_cnt);
+    printf("  cached:      %10.3f ns per time\n", cached_secs*1e9/time_cnt);
+    printf("  mismatches:  %ld\n", mismatch_cnt + (sum != 0));
+    
+    free(times);
+    
+    return mismatch_cnt || sum ? UNSUCCESSFUL : SUCCESSFUL;
+}
+
+/**
+ * Order occurrences by start time, then slot, for qsort.
+ */
+
+int compare_occurrences(const void *a, const void *b) {
+    const Occurrence *x = (const Occurrence *)a;
+    const Occurrence *y = (const Occurrence *)b;
+    
+    if(x->t_start != y->t_start) return x->t_start < y->t_start ? -1 : 1;
+    return (x->slot > y->slot) - (x->slot < y->slot);
+}
+
+
+/**
+ * Compare listing the occurrences of the next days by storing every one of
+ * them and sorting, against merging the tasks' streams with OccurrenceIter.
+ * @param task_cnt number of tasks in the synthetic file.
+ * @param days length of the time range, from now.
+ * @return 0 if both methods agree, else -1.
+ */
+
+int bench_occurrences(long int task_cnt, int days) {
+    GenSpec spec = default_spec;
+    TaskStore store;
+    OccurrenceIter iter;
+    Occurrence buffer[BENCH_OCCUR_BATCH_SIZE];
+    Occurrence *occurrences = NULL;
+    long int occurrence_cnt = 0;
+    long int occurrence_cap = 0;
+    long int merged_cnt = 0;
+    long int counted_cnt;
+    long int mismatch_cnt = 0;
+    clock_t start;
+    double sorted_secs, merged_secs, counted_secs;
+    time_t from, to;
+    int read_cnt;
+    
+    spec.task_cnt = task_cnt;
+    if(make_data_file(BENCH_FILE_NAME, &spec) == UNSUCCESSFUL
+       || store_open(&store, BENCH_FILE_NAME, STORE_WRITE) == UNSUCCESSFUL) {
+        printf("Error: Unable to create benchmark file...\n");
+        return UNSUCCESSFUL;
+    }
+    update_all_tasks(&store);
+    time(&from);
+    to = from + (time_t)days*SECS_PER_DAY;
+    
+    // Reference: every occurrence of every active task, then sort them:
+    start = clock();
+    for(long int i = 0; i < store.task_cnt; i++) {
+        const Task *task = store.tasks + i;
+        time_t period = get_period(task);
+        if(!(task->flags & FLAG_ACTIVE)) continue;
+        for(time_t t = task->t_time; t < to; t += period) {
+            if(t >= from) {
+                if(occurrence_cnt == occurrence_cap) {
+                    long int cap = occurrence_cap ? 2*occurrence_cap : 1024;
+                    Occurrence *grown = (Occurrence *)realloc(
+                        occurrences, cap*sizeof(Occurrence));
+                    if(grown == NULL) {
+                        free(occurrences);
+                        store_close(&store);
+                        return UNSUCCESSFUL;
+                    }
+                    occurrences = grown;
+                    occurrence_cap = cap;
+                }
+                occurrences[occurrence_cnt].t_start = t;
+                occurrences[occurrence_cnt++].slot = i;
+            }
+            if(!period) break;
+        }
+    }
+    qsort(occurrences, occurrence_cnt, sizeof(Occurrence),
+          compare_occurrences);
+    sorted_secs = secs_since(start);
+    
+    start = clock();
+    if(occur_init(&iter, &store, from, to, 0) == UNSUCCESSFUL) {
+        free(occurrences);
+        store_close(&store);
+        return UNSUCCESSFUL;
+    }
+    while((read_cnt = occur_read(&iter, buffer, BENCH_OCCUR_BATCH_SIZE))
+          > 0) {
+        for(int i = 0; i < read_cnt; i++, merged_cnt++)
+            if(merged_cnt >= occurrence_cnt
+               || buffer[i].t_start != occurrences[merged_cnt].t_start
+               || buffer[i].slot != occurrences[merged_cnt].slot)
+                mismatch_cnt++;
+    }
+    occur_free(&iter);
+    merged_secs = secs_since(start);
+    
+    start = clock();
+    counted_cnt = occur_count(&store, from, to, 0);
+    counted_secs = secs_since(start);
+    mismatch_cnt += (merged_cnt != occurrence_cnt)
+                    + (counted_cnt != occurrence_cnt);
+    
+    printf("occurrences (%ld tasks, %d days, %ld occurrences)\n",
+           task_cnt, days, occurrence_cnt);
+    printf("  sorted:      %10.3f ms\n", sorted_secs*1e3);
+    printf("  merged:      %10.3f ms\n", merged_secs*1e3);
+    printf("  counted:     %10.3f ms\n", counted_secs*1e3);
+    printf("  mismatches:  %ld\n", mismatch_cnt);
+    
+    free(occurrences);
+    store_close(&store);
+    
+    return mismatch_cnt ? UNSUCCESSFUL : SUCCESSFUL;
+}
+
+
+/**
+ * Count a reminder and how late it is, for the scheduler.
+ * @param context the Lateness to update.
+ */
+
+void count_reminder(void *context, const Task *task, int64_t lateness) {
+    Lateness *stats = (Lateness *)context;
+    
+    (void)task;
+    if(stats->notified_cnt < stats->sample_cap)
+        stats->samples[stats->notified_cnt] = lateness;
+    stats->notified_cnt++;
+    stats->total_lateness += lateness;
+    if(lateness > stats->max_lateness) stats->max_lateness = lateness;
+}
+
+
+/**
+ * Order lateness samples, for qsort.
+ */
+
+int compare_lateness(const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+    
+    return (x > y) - (x < y);
+}
+
+
+/**
+ * Schedule the tasks of a synthetic file and run the scheduler over the
+ * next days on a manual clock, checking the reminders against
+ * occur_count. Then run it for a few seconds on the system clock, with
+ * more tasks starting every second, to measure how late reminders are:
+ * every lateness is kept, and their percentiles reported. Reminders of
+ * the same second are notified one after the other, so the more start
+ * together, the later the last ones.
+ * @param task_cnt number of tasks in the synthetic file.
+ * @param days length of the manual run.
+ * @param jitter_cnt number of tasks added for the system clock's run.
+ * @return 0 if the reminders match the occurrences, else -1.
+ */
+
+int bench_reminders(long int task_cnt, int days, long int jitter_cnt) {
+    GenSpec spec = default_spec;
+    TaskStore store;
+    ReminderClock clock;
+    Reminder reminder;
+    Lateness stats;
+    Task task;
+    time_t now, until;
+    int64_t *samples;
+    long int occurrence_cnt;
+    long int mismatch_cnt;
+    long int sample_cnt;
+    double start, load_secs, run_secs;
+    int result;
+    
+    spec.task_cnt = task_cnt;
+    if(make_data_file(BENCH_FILE_NAME, &spec) == UNSUCCESSFUL
+       || store_open(&store, BENCH_FILE_NAME, STORE_WRITE) == UNSUCCESSFUL) {
+        printf("Error: Unable to create benchmark file...\n");
+        return UNSUCCESSFUL;
+    }
+    
+    // Manual clock, jumping from a reminder to the next:
+    time(&now);
+    until = now + (time_t)days*SECS_PER_DAY;
+    memset(&stats, 0, sizeof(Lateness));
+    reminder_clock_manual(&clock, (int64_t)now*NSECS_PER_SEC);
+    reminder_init(&reminder, &clock, count_reminder, &stats);
+    start = get_wall_time();
+    result = reminder_load(&reminder, &store);
+    load_secs = get_wall_time() - start;
+    start = get_wall_time();
+    if(result == SUCCESSFUL) result = reminder_run(&reminder, until);
+    run_secs = get_wall_time() - start;
+    reminder_free(&reminder);
+    if(result == UNSUCCESSFUL) {
+        store_close(&store);
+        return UNSUCCESSFUL;
+    }
+    occurrence_cnt = occur_count(&store, now, until, 0);
+    mismatch_cnt = (stats.notified_cnt != occurrence_cnt)
+                   + (stats.max_lateness != 0);
+    
+    printf("reminders (%ld tasks, %d days)\n", task_cnt, days);
+    printf("  load:        %10.3f ns per task\n", load_secs*1e9/task_cnt);
+    printf("  run:         %10.3f ns per reminder (%ld reminders)\n",
+           stats.notified_cnt ? run_secs*1e9/stats.notified_cnt : 0.0,
+           stats.notified_cnt);
+    printf("  mismatches:  %ld\n", mismatch_cnt);
+    
+    // System clock, with more tasks starting every second:
+    if(reminder_clock_system(&clock) == UNSUCCESSFUL) {
+        printf("Error: Unable to create a timer...\n");
+        store_close(&store);
+        return UNSUCCESSFUL;
+    }
+    // Each task starts at most once during the run:
+    samples = (int64_t *)malloc((task_cnt + jitter_cnt)*sizeof(int64_t));
+    if(samples == NULL) {
+        printf("Error: Out of memory...\n");
+        reminder_clock_close(&clock);
+        store_close(&store);
+        return UNSUCCESSFUL;
+    }
+    memset(&stats, 0, sizeof(Lateness));
+    reminder_init(&reminder, &clock, count_reminder, &stats);
+    result = reminder_load(&reminder, &store);
+    // The scheduler's clock, time() may still be a few ms in the last second:
+    now = (time_t)(clock.now(&clock)/NSECS_PER_SEC);
+    memset(&task, 0, sizeof(Task));
+    task.flags = FLAG_ACTIVE;
+    for(long int i = 0; i < jitter_cnt && result == SUCCESSFUL; i++) {
+        task.t_time = now + 2 + i%BENCH_JITTER_SECS;
+        result = reminder_add(&reminder, &task);
+    }
+    // Tasks of the current second are late already, and the first wake-up
+    // may wait on the synthetic file's writeback, leave both out:
+    if(result == SUCCESSFUL) result = reminder_run(&reminder, now + 2);
+    memset(&stats, 0, sizeof(Lateness));
+    stats.samples = samples;
+    stats.sample_cap = task_cnt + jitter_cnt;
+    if(result == SUCCESSFUL)
+        result = reminder_run(&reminder, now + 2 + BENCH_JITTER_SECS);
+    reminder_free(&reminder);
+    reminder_clock_close(&clock);
+    store_close(&store);
+    if(result == UNSUCCESSFUL || stats.notified_cnt == 0) {
+        free(samples);
+        return UNSUCCESSFUL;
+    }
+    
+    sample_cnt = stats.notified_cnt < stats.sample_cap ? stats.notified_cnt
+                                                       : stats.sample_cap;
+    qsort(samples, sample_cnt, sizeof(int64_t), compare_lateness);
+    printf("  lateness:    %10.3f us p50, %.3f us p99, %.3f us max "
+           "(%ld reminders)\n",
+           samples[(sample_cnt - 1)/2]/1e3,
+           samples[(sample_cnt - 1)*99/100]/1e3,
+           stats.max_lateness/1e3,
+           stats.notified_cnt);
+    printf("  average:     %10.3f us\n",
+           stats.total_lateness/stats.notified_cnt/1e3);
+    free(samples);
+    
+    return mismatch_cnt ? UNSUCCESSFUL : SUCCESSFUL;
+}
+
+
+/**
+ * Hash the entries of an index, read in order, against the same entries
+ * sorted aside.
+ * @param store store whose index is to be checked.
+ * @return 0 if they match, else -1.
+ */
+
+int check_index(const TaskStore *store) {
+    Occurrence *entries;
+    IndexCursor cursor;
+    IndexEntry entry;
+    uint64_t hash = 0;
+    uint64_t ref_hash = 0;
+    long int entry_cnt = 0;
+    long int read_cnt = 0;
+    
+    entries = (Occurrence *)malloc((store->task_cnt + 1)*sizeof(Occurrence));
+    if(entries == NULL) return UNSUCCESSFUL;
+    for(long int i = 0; i < store->task_cnt; i++)
+        if(store->tasks[i].flags & FLAG_ACTIVE) {
+            entries[entry_cnt].t_start = store->tasks[i].t_time;
+            entries[entry_cnt++].slot = i;
+        }
+    qsort(entries, entry_cnt, sizeof(Occurrence), compare_occurrences);
+    for(long int i = 0; i < entry_cnt; i++)
+        ref_hash = (ref_hash*31 + (uint64_t)entries[i].t_start)*31
+                   + (uint64_t)entries[i].slot;
+    free(entries);
+    
+    index_seek(&store->index, -TIME_T_MAX - 1, &cursor); // from the first
+    while(index_next(&cursor, &entry)) {
+        hash = (hash*31 + (uint64_t)entry.t_time)*31 + (uint64_t)entry.slot;
+        read_cnt++;
+    }
+    
+    return hash == ref_hash && read_cnt == entry_cnt ? SUCCESSFUL
+                                                     : UNSUCCESSFUL;
+}
+
+
+/**
+ * Compare the index engines on the same tasks: building the index, adding
+ * and deleting tasks one by one, finding the next task, scanning all tasks
+ * in time order and opening the store again. Each engine's index is
+ * checked against the records after the adds and after reopening.
+ * @param task_cnt number of tasks in the synthetic file.
+ * @return 0 if both engines index the tasks in order, else -1.
+ */
+
+int bench_engines(long int task_cnt) {
+    const char *names[] = {"array", "btree"}; // by INDEX_ARRAY, INDEX_BTREE
+    GenSpec spec = default_spec;
+    TaskStore store;
+    Task task;
+    long int *slots;
+    IndexCursor cursor;
+    IndexEntry entry;
+    long int mismatch_cnt = 0;
+    long int scan_cnt[2] = {0, 0};
+    double start, secs[2][6];
+    long int run_cnt;
+    time_t now;
+    
+    slots = (long int *)malloc(BENCH_ENGINE_OP_CNT*sizeof(long int));
+    if(slots == NULL) return UNSUCCESSFUL;
+    spec.task_cnt = task_cnt;
+    
+    for(int engine = INDEX_ARRAY; engine <= INDEX_BTREE; engine++) {
+        if(make_data_file(BENCH_FILE_NAME, &spec) == UNSUCCESSFUL
+           || store_open(&store, BENCH_FILE_NAME, STORE_WRITE)
+              == UNSUCCESSFUL) {
+            printf("Error: Unable to create benchmark file...\n");
+            free(slots);
+            return UNSUCCESSFUL;
+        }
+        if(store_set_engine(&store, engine) == UNSUCCESSFUL) {
+            store_close(&store);
+            free(slots);
+            return UNSUCCESSFUL;
+        }
+        
+        start = get_wall_time();
+        store_reindex(&store);
+        secs[engine][0] = get_wall_time() - start;
+        
+        // The same tasks for both engines, somewhere in the next two weeks:
+        time(&now);
+        srand(4);
+        memset(&task, 0, sizeof(Task));
+        task.t_duration_in_mins = 30;
+        task.flags = FLAG_ACTIVE;
+        start = get_wall_time();
+        for(long int i = 0; i < BENCH_ENGINE_OP_CNT; i++) {
+            sprintf(task.t_name, "Added %ld", i);
+            task.t_time = now + ((time_t)rand()*RAND_MAX + rand())
+                                %(2*SECS_PER_WEEK);
+            task.t_importance_rtn = (uint8_t)(rand()%256);
+            slots[i] = store_add(&store, &task);
+        }
+        secs[engine][1] = (get_wall_time() - start)/BENCH_ENGINE_OP_CNT;
+        
+        secs[engine][2] = time_query(query_next_task, &store, &run_cnt);
+        
+        start = get_wall_time();
+        index_seek(&store.index, -TIME_T_MAX - 1, &cursor);
+        while(index_next(&cursor, &entry)) scan_cnt[engine]++;
+        secs[engine][3] = get_wall_time() - start;
+        mismatch_cnt += check_index(&store) == UNSUCCESSFUL;
+        
+        start = get_wall_time();
+        for(long int i = 0; i < BENCH_ENGINE_OP_CNT; i++)
+            store_tombstone(&store, slots[i]);
+        secs[engine][4] = (get_wall_time() - start)/BENCH_ENGINE_OP_CNT;
+        
+        store_close(&store);
+        start = get_wall_time();
+        if(store_open(&store, BENCH_FILE_NAME, STORE_READ) == UNSUCCESSFUL) {
+            free(slots);
+            return UNSUCCESSFUL;
+        }
+        secs[engine][5] = get_wall_time() - start;
+        mismatch_cnt += store.index.engine != engine
+                        || check_index(&store) == UNSUCCESSFUL;
+        store_close(&store);
+    }
+    
+    printf("engines (%ld tasks, %d added then deleted)\n",
+           task_cnt, BENCH_ENGINE_OP_CNT);
+    printf("               %12s %12s\n", names[0], names[1]);
+    printf("  build:       %9.3f ms %9.3f ms\n",
+           secs[0][0]*1e3, secs[1][0]*1e3);
+    printf("  add:         %9.3f us %9.3f us\n",
+           secs[0][1]*1e6, secs[1][1]*1e6);
+    printf("  next task:   %9.3f us %9.3f us\n",
+           secs[0][2]*1e6, secs[1][2]*1e6);
+    printf("  scan:        %9.3f ms %9.3f ms\n",
+           secs[0][3]*1e3, secs[1][3]*1e3);
+    printf("  delete:      %9.3f us %9.3f us\n",
+           secs[0][4]*1e6, secs[1][4]*1e6);
+    printf("  reopen:      %9.3f ms %9.3f ms\n",
+           secs[0][5]*1e3, secs[1][5]*1e3);
+    printf("  mismatches:  %ld\n",
+           mismatch_cnt + (scan_cnt[0] != scan_cnt[1]));
+    
+    free(slots);
+    return mismatch_cnt || scan_cnt[0] != scan_cnt[1] ? UNSUCCESSFUL
+                                                       : SUCCESSFUL;
+}
+
+
+/**
+ * Compare finding tasks by scanning the records against the store's hash
+ * indexes: by ID, by name, and while deleting tasks by ID.
+ * @param task_cnt number of tasks in the synthetic file.
+ * @return 0 if both methods agree, else -1.
+ */
+
+int bench_ids(long int task_cnt) {
+    GenSpec spec = default_spec;
+    TaskStore store;
+    uint64_t ids[TASK_FIND_MAX];
+    char name[TASK_NAME_MAXLEN];
+    long int mismatch_cnt = 0;
+    long int delete_cnt;
+    double start, scan_secs, build_secs, id_secs, name_secs, delete_secs;
+    
+    spec.task_cnt = task_cnt;
+    if(make_data_file(BENCH_FILE_NAME, &spec) == UNSUCCESSFUL
+       || store_open(&store, BENCH_FILE_NAME, STORE_WRITE) == UNSUCCESSFUL) {
+        printf("Error: Unable to create benchmark file...\n");
+        return UNSUCCESSFUL;
+    }
+    
+    // Reference: scan the records for the task of an ID.
+    srand(5);
+    start = get_wall_time();
+    for(long int i = 0; i < BENCH_SCAN_LOOKUP_CNT; i++) {
+        uint64_t id = ((uint64_t)rand()*RAND_MAX + rand())%task_cnt + 1;
+        long int slot = UNSUCCESSFUL;
+        for(long int j = 0; j < store.task_cnt && slot == UNSUCCESSFUL; j++)
+            if(store.tasks[j].t_id == id) slot = j;
+        mismatch_cnt += slot == UNSUCCESSFUL;
+    }
+    scan_secs = (get_wall_time() - start)/BENCH_SCAN_LOOKUP_CNT;
+    
+    start = get_wall_time();
+    store_find_id(&store, 1); // builds the hash indexes
+    build_secs = get_wall_time() - start;
+    
+    srand(5);
+    start = get_wall_time();
+    for(long int i = 0; i < BENCH_LOOKUP_CNT; i++) {
+        uint64_t id = ((uint64_t)rand()*RAND_MAX + rand())%task_cnt + 1;
+        long int slot = store_find_id(&store, id);
+        mismatch_cnt += slot == UNSUCCESSFUL || store.tasks[slot].t_id != id;
+    }
+    id_secs = (get_wall_time() - start)/BENCH_LOOKUP_CNT;
+    
+    // Names are unique in synthetic files:
+    start = get_wall_time();
+    for(long int i = 0; i < BENCH_LOOKUP_CNT; i++) {
+        long int n = ((long int)rand()*RAND_MAX + rand())%task_cnt;
+        sprintf(name, "Task %ld", n);
+        mismatch_cnt += find_tasks_by_name(ids, TASK_FIND_MAX, name, &store)
+                        != 1
+                        || ids[0] != (uint64_t)n + 1;
+    }
+    name_secs = (get_wall_time() - start)/BENCH_LOOKUP_CNT;
+    
+    delete_cnt = task_cnt/10 < BENCH_SUITE_DELETE_CNT
+                 ? task_cnt/10 : BENCH_SUITE_DELETE_CNT;
+    start = get_wall_time();
+    for(long int i = 0; i < delete_cnt; i++)
+        mismatch_cnt += delete_task_id((uint64_t)(10*i + 1), &store)
+                        == UNSUCCESSFUL;
+    delete_secs = delete_cnt ? (get_wall_time() - start)/delete_cnt : 0;
+    for(long int i = 0; i < delete_cnt; i++)
+        mismatch_cnt += store_find_id(&store, (uint64_t)(10*i + 1))
+                        != UNSUCCESSFUL
+                        || store_find_id(&store, (uint64_t)(10*i + 2))
+                           == UNSUCCESSFUL;
+    
+    printf("ids (%ld tasks)\n", task_cnt);
+    printf("  scan by ID:  %10.3f us\n", scan_secs*1e6);
+    printf("  build:       %10.3f ms\n", build_secs*1e3);
+    printf("  by ID:       %10.3f us\n", id_secs*1e6);
+    printf("  by name:     %10.3f us\n", name_secs*1e6);
+    printf("  delete:      %10.3f us (%ld tasks)\n", delete_secs*1e6,
+           delete_cnt);
+    printf("  mismatches:  %ld\n", mismatch_cnt);
+    
+    store_close(&store);
+    
+    return mismatch_cnt ? UNSUCCESSFUL : SUCCESSFUL;
+}
+
+
+/**
+ * Order ranked tasks by key, then slot, for qsort.
+ */
+
+int compare_ranked(const void *a, const void *b) {
+    const RankedTask *x = (const RankedTask *)a;
+    const RankedTask *y = (const RankedTask *)b;
+    
+    if(x->key != y->key) return x->key < y->key ? -1 : 1;
+    return (x->slot > y->slot) - (x->slot < y->slot);
+}
+
+
+/**
+ * Reference ranking: store every upcoming task and sort them all.
+ * @param tasks place-holder for the tasks, room for every record.
+ * @param store opened data file.
+ * @param now tasks starting at or before this are left out.
+ * @return number of upcoming tasks.
+ */
+
+long int rank_by_sort(RankedTask *tasks, const TaskStore *store, time_t now) {
+    const TaskColumns *cols = &store->cols;
+    long int task_cnt = 0;
+    
+    for(long int i = 0; i < store->task_cnt; i++) {
+        if(!(cols->flags[i] & FLAG_ACTIVE) || cols->t_time[i] <= now)
+            continue;
+        tasks[task_cnt].key = rank_key(cols->t_time[i],
+                                       cols->t_importance_rtn[i]);
+        tasks[task_cnt++].slot = i;
+    }
+    qsort(tasks, task_cnt, sizeof(RankedTask), compare_ranked);
+    
+    return task_cnt;
+}
+
+
+/**
+ * Check the tasks of a ranking against the reference ranking.
+ * @param ranking ranking in question.
+ * @param ranked_cnt number of tasks ranked, as returned with it.
+ * @param sorted place-holder for the reference, room for every record.
+ * @param store opened data file.
+ * @param now time the ranking is for.
+ * @return number of tasks which differ.
+ */
+
+int check_ranking(const Ranking *ranking,
+                  int ranked_cnt,
+                  RankedTask *sorted,
+                  const TaskStore *store,
+                  time_t now) {
+    long int sorted_cnt = rank_by_sort(sorted, store, now);
+    int expected_cnt = sorted_cnt < ranking->k ? (int)sorted_cnt
+                                               : ranking->k;
+    int mismatch_cnt = ranked_cnt != expected_cnt;
+    
+    for(int i = 0; i < ranked_cnt && i < expected_cnt; i++)
+        mismatch_cnt += ranking->tasks[i].slot != sorted[i].slot;
+    
+    return mismatch_cnt;
+}
+
+
+/**
+ * Compare ranking the upcoming tasks by sorting them all, against a single
+ * pass with a bounded heap, and against refreshing the ranking as time
+ * passes over the next two weeks, which only scans again when candidates
+ * run out. Every ranking is checked against the reference.
+ * @param task_cnt number of tasks in the synthetic file.
+ * @return 0 if successful, else -1.
+ */
+
+int bench_top(long int task_cnt) {
+    GenSpec spec = default_spec;
+    TaskStore store;
+    Ranking ranking;
+    RankedTask *sorted;
+    long int mismatch_cnt = 0;
+    double start, sort_secs, scan_secs, refresh_secs, step_secs = 0;
+    time_t now;
+    int ranked_cnt;
+    
+    spec.task_cnt = task_cnt;
+    if(make_data_file(BENCH_FILE_NAME, &spec) == UNSUCCESSFUL
+       || store_open(&store, BENCH_FILE_NAME, STORE_WRITE) == UNSUCCESSFUL) {
+        printf("Error: Unable to create benchmark file...\n");
+        return UNSUCCESSFUL;
+    }
+    sorted = malloc(task_cnt*sizeof(RankedTask));
+    if(sorted == NULL || rank_init(&ranking, BENCH_TOP_CNT) == UNSUCCESSFUL) {
+        printf("Error: Out of memory...\n");
+        free(sorted);
+        store_close(&store);
+        return UNSUCCESSFUL;
+    }
+    time(&now);
+    
+    start = get_wall_time();
+    for(int q = 0; q < BENCH_FILTER_CNT; q++)
+        rank_by_sort(sorted, &store, now);
+    sort_secs = (get_wall_time() - start)/BENCH_FILTER_CNT;
+    
+    start = get_wall_time();
+    for(int q = 0; q < BENCH_FILTER_CNT; q++)
+        ranked_cnt = rank_scan(&ranking, &store, now);
+    scan_secs = (get_wall_time() - start)/BENCH_FILTER_CNT;
+    mismatch_cnt += check_ranking(&ranking, ranked_cnt, sorted, &store, now);
+    
+    // Dashboard refreshes while nothing starts:
+    start = get_wall_time();
+    for(long int i = 0; i < BENCH_LOOKUP_CNT; i++)
+        ranked_cnt = rank_refresh(&ranking, &store, now);
+    refresh_secs = (get_wall_time() - start)/BENCH_LOOKUP_CNT;
+    mismatch_cnt += check_ranking(&ranking, ranked_cnt, sorted, &store, now);
+    
+    // Refreshes as tasks start, a scan is needed once candidates run out:
+    for(int i = 1; i <= BENCH_TOP_STEP_CNT; i++) {
+        time_t t = now + (time_t)i*2*SECS_PER_WEEK/BENCH_TOP_STEP_CNT;
+        start = get_wall_time();
+        ranked_cnt = rank_refresh(&ranking, &store, t);
+        step_secs += get_wall_time() - start;
+        mismatch_cnt += check_ranking(&ranking, ranked_cnt, sorted, &store,
+                                      t);
+    }
+    
+    // Writes change the keys, the next refresh scans again:
+    if(ranked_cnt) {
+        delete_task_id(store.tasks[ranking.tasks[0].slot].t_id, &store);
+        ranked_cnt = rank_refresh(&ranking, &store, now);
+        mismatch_cnt += check_ranking(&ranking, ranked_cnt, sorted, &store,
+                                      now);
+    }
+    
+    printf("top %d (%ld tasks)\n", BENCH_TOP_CNT, task_cnt);
+    printf("  sort:        %10.3f ms\n", sort_secs*1e3);
+    printf("  heap:        %10.3f ms\n", scan_secs*1e3);
+    printf("  refresh:     %10.3f us\n", refresh_secs*1e6);
+    printf("  two weeks:   %10.3f us (%d refreshes)\n",
+           step_secs/BENCH_TOP_STEP_CNT*1e6, BENCH_TOP_STEP_CNT);
+    printf("  mismatches:  %ld\n", mismatch_cnt);
+    
+    rank_free(&ranking);
+    free(sorted);
+    store_close(&store);
+    
+    return mismatch_cnt ? UNSUCCESSFUL : SUCCESSFUL;
+}
+
+
+/**
+ * Time the task.c operations on data files of 1000 tasks and up, ten times
+ * larger each, and print the results as JSON.
+ * update_all_tasks is timed once per file, on its stale tasks. delete_task
+ * is timed on tasks picked at random, it may compact the file.
+ * @param max_task_cnt number of tasks in the largest file.
+ * @return 0 if successful, else -1.
+ */
+
+int bench_suite(long int max_task_cnt) {
+    const char *names[] = {"get_task_cnt", "read_tasks", "get_next_task",
+                           "get_day_tasks", "get_week_tasks"};
+    int (*queries[])(TaskStore *) = {query_task_cnt, query_read_tasks,
+                                     query_next_task, query_day_tasks,
+                                     query_week_tasks};
+    TaskStore store;
+    GenSpec spec = default_spec;
+    double start, secs;
+    long int run_cnt;
+    long int delete_cnt;
+    
+    printf("{\n  \"time\": %lld,\n  \"filter_kernel\": \"%s\",\n"
+           "  \"task_size\": %d,\n  \"results\": [",
+           (long long)time(NULL), kernel_names[filter_get_kernel()],
+           (int)sizeof(Task));
+        
+    for(spec.task_cnt = 1000;
+        spec.task_cnt <= max_task_cnt;
+        spec.task_cnt *= 10) {
+        if(make_data_file(BENCH_FILE_NAME, &spec) == UNSUCCESSFUL) {
+            printf("Error: Unable to create benchmark file...\n");
+            return UNSUCCESSFUL;
+        }
+            
+        start = get_wall_time();
+        if(store_open(&store, BENCH_FILE_NAME, STORE_WRITE) == UNSUCCESSFUL)
+            return UNSUCCESSFUL;
+        print_result(spec.task_cnt, "store_open", 1, get_wall_time() - start);
+            
+        start = get_wall_time();
+        update_all_tasks(&store);
+        print_result(spec.task_cnt, "update_all_tasks", 1,
+                     get_wall_time() - start);
+            
+        for(size_t i = 0; i < sizeof(queries)/sizeof(queries[0]); i++) {
+            secs = time_query(queries[i], &store, &run_cnt);
+            print_result(spec.task_cnt, names[i], run_cnt, secs);
+        }
+            
+        delete_cnt = spec.task_cnt/10 < BENCH_SUITE_DELETE_CNT
+                     ? spec.task_cnt/10 : BENCH_SUITE_DELETE_CNT;
+        srand(3);
+        start = get_wall_time();
+        for(long int i = 0; i < delete_cnt; i++)
+            delete_task(((long int)rand()*RAND_MAX + rand())
+                        %get_task_cnt(&store), &store);
+        print_result(spec.task_cnt, "delete_task", delete_cnt,
+                     (get_wall_time() - start)/delete_cnt);
+            
+        store_close(&store);
+    }
+        
+    printf("\n  ]\n}\n");
+    return SUCCESSFUL;
+}
@@ -0,0 +1,618 @@
+#include "btree.h"
+
+#include <stdlib.h>
+
+#include "mapfile.h"
+
+// ---------------------------------------------------------------------------
+// Helpers
+
+/**
+ * Order keys by start time, then by slot.
+ */
+
+static int compare_keys(const BTreeKey *a, const BTreeKey *b) {
+    if(a->t_time != b->t_time) return a->t_time < b->t_time ? -1 : 1;
+    if(a->slot != b->slot) return a->slot < b->slot ? -1 : 1;
+    return 0;
+}
+
+
+/**
+ * Binary search for the first key of an array not ordered before a key.
+ * @param upper 1 to find the first key ordered after it instead.
+ * @return position of that key, key_cnt if none.
+ */
+
+static int search(const BTreeKey *keys,
+                  int key_cnt,
+                  const BTreeKey *key,
+                  int upper) {
+    int low = 0;
+    int high = key_cnt;
+    
+    while(low < high) {
+        int mid = low + (high - low)/2;
+        if(compare_keys(keys + mid, key) < upper)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    
+    return low;
+}
+
+
+/**
+ * Read or write a page of the tree's file.
+ * @param write 1 to write data to the page, 0 to read it into data.
+ * @return 0 if successful, else -1.
+ */
+
+static int transfer(const BTree *tree, uint32_t page, void *data, int write) {
+    if(fseek(tree->fp, (long int)page*BTREE_PAGE_SIZE, SEEK_SET) != 0)
+        return UNSUCCESSFUL;
+    if(write)
+        return fwrite(data, BTREE_PAGE_SIZE, 1, tree->fp) == 1
+               ? SUCCESSFUL : UNSUCCESSFUL;
+    return fread(data, BTREE_PAGE_SIZE, 1, tree->fp) == 1
+           ? SUCCESSFUL : UNSUCCESSFUL;
+}
+
+
+/**
+ * Empty the buffer pool, without writing its pages.
+ * @param pool pool to empty.
+ */
+
+static void drop_pages(BTreePool *pool) {
+    for(int i = 0; i < BTREE_POOL_SIZE; i++) {
+        pool->frames[i].page = 0;
+        pool->frames[i].pin_cnt = 0;
+        pool->frames[i].dirty = 0;
+        pool->frames[i].referenced = 0;
+        pool->frames[i].next = -1;
+        pool->buckets[i] = -1;
+    }
+    pool->hand = 0;
+}
+
+
+/**
+ * Pin a page in the buffer pool, reading it unless it is new. Frames are
+ * reused by the clock algorithm: unpinned frames are passed over once if
+ * used since last time, dirty ones are written back before reuse.
+ * @param page page number, at least 1.
+ * @param fresh 1 for a page just allocated, its frame is then zeroed.
+ * @return the page's frame, NULL if it cannot be read or every frame is
+ *         pinned.
+ */
+
+static BTreeFrame *fetch(const BTree *tree, uint32_t page, int fresh) {
+    BTreePool *pool = tree->pool;
+    int32_t *link;
+    BTreeFrame *frame;
+    int32_t f;
+    
+    for(f = pool->buckets[page%BTREE_POOL_SIZE]; f >= 0;
+        f = pool->frames[f].next)
+        if(pool->frames[f].page == page) {
+            frame = pool->frames + f;
+            frame->pin_cnt++;
+            frame->referenced = 1;
+            return frame;
+        }
+    
+    // Find a victim, every frame may have to be passed over once:
+    for(int step = 0; ; step++) {
+        if(step == 2*BTREE_POOL_SIZE) return NULL;
+        f = pool->hand;
+        pool->hand = (pool->hand + 1)%BTREE_POOL_SIZE;
+        frame = pool->frames + f;
+        if(frame->pin_cnt) continue;
+        if(frame->referenced) {
+            frame->referenced = 0;
+            continue;
+        }
+        break;
+    }
+    if(frame->dirty) {
+        if(transfer(tree, frame->page, frame->data.bytes, 1) == UNSUCCESSFUL)
+            return NULL;
+        frame->dirty = 0;
+    }
+    if(frame->page) { // unlink it from its bucket
+        for(link = pool->buckets + frame->page%BTREE_POOL_SIZE; *link != f;
+            link = &pool->frames[*link].next);
+        *link = frame->next;
+        frame->page = 0;
+    }
+    
+    if(fresh)
+        memset(frame->data.bytes, 0, BTREE_PAGE_SIZE);
+    else if(transfer(tree, page, frame->data.bytes, 0) == UNSUCCESSFUL)
+        return NULL;
+    frame->page = page;
+    frame->pin_cnt = 1;
+    frame->dirty = (uint8_t)fresh;
+    frame->referenced = 1;
+    frame->next = pool->buckets[page%BTREE_POOL_SIZE];
+    pool->buckets[page%BTREE_POOL_SIZE] = f;
+    
+    return frame;
+}
+
+
+/**
+ * Unpin a page.
+ * @param frame frame of the page, as fetched.
+ * @param dirty 1 if the page has been modified.
+ */
+
+static void release(BTreeFrame *frame, int dirty) {
+    frame->pin_cnt--;
+    frame->dirty |= (uint8_t)dirty;
+}
+
+
+/**
+ * Allocate a page at the end of the file and pin it, zeroed.
+ * @return its frame, NULL if it cannot be allocated.
+ */
+
+static BTreeFrame *allocate(BTree *tree) {
+    BTreeFrame *frame;
+    
+    if(tree->meta.page_cnt == UINT32_MAX) return NULL;
+    frame = fetch(tree, tree->meta.page_cnt, 1);
+    if(frame != NULL) tree->meta.page_cnt++;
+    
+    return frame;
+}
+
+
+/**
+ * Insert a key into the subtree rooted at a page, splitting full pages on
+ * the way back up.
+ * @param page root of the subtree.
+ * @param key key to insert.
+ * @param split_key place-holder for the first key of the new right page,
+ *        if the page is split.
+ * @param split_page place-holder for the new right page.
+ * @return 1 if the page was split, 0 if not, -1 if unsuccessful.
+ */
+
+static int insert_into(BTree *tree,
+                       uint32_t page,
+                       const BTreeKey *key,
+                       BTreeKey *split_key,
+                       uint32_t *split_page) {
+    BTreeFrame *frame = fetch(tree, page, 0);
+    BTreeFrame *right;
+    BTreeKey child_key;
+    uint32_t child_page;
+    int pos, result, half;
+    
+    if(frame == NULL) return UNSUCCESSFUL;
+    
+    if(frame->data.header.leaf) {
+        BTreeLeaf *leaf = &frame->data.leaf;
+        int key_cnt = leaf->header.key_cnt;
+        
+        pos = search(leaf->keys, key_cnt, key, 0);
+        if(pos < key_cnt && compare_keys(leaf->keys + pos, key) == 0) {
+            release(frame, 0); // already there
+            return 0;
+        }
+        if(key_cnt < (int)BTREE_LEAF_MAX) {
+            memmove(leaf->keys + pos + 1, leaf->keys + pos,
+                    (key_cnt - pos)*sizeof(BTreeKey));
+            leaf->keys[pos] = *key;
+            leaf->header.key_cnt++;
+            tree->meta.key_cnt++;
+            release(frame, 1);
+            return 0;
+        }
+        
+        // Full, move the upper half to a new leaf following it:
+        right = allocate(tree);
+        if(right == NULL) {
+            release(frame, 0);
+            return UNSUCCESSFUL;
+        }
+        half = (key_cnt + 1)/2;
+        right->data.header.leaf = 1;
+        right->data.header.key_cnt = (uint16_t)(key_cnt - half);
+        right->data.header.next = leaf->header.next;
+        memcpy(right->data.leaf.keys, leaf->keys + half,
+               (key_cnt - half)*sizeof(BTreeKey));
+        leaf->header.key_cnt = (uint16_t)half;
+        leaf->header.next = right->page;
+        *split_key = right->data.leaf.keys[0];
+        *split_page = right->page;
+        release(right, 1);
+        release(frame, 1);
+        
+        // The key goes into either half, which has room now:
+        return insert_into(tree, compare_keys(key, split_key) < 0
+                                 ? page : *split_page,
+                           key, &child_key, &child_page) == UNSUCCESSFUL
+               ? UNSUCCESSFUL : 1;
+    }
+    
+    BTreeInner *inner = &frame->data.inner;
+    int key_cnt = inner->header.key_cnt;
+    
+    pos = search(inner->keys, key_cnt, key, 1);
+    result = insert_into(tree, inner->children[pos], key,
+                         &child_key, &child_page);
+    if(result != 1) {
+        release(frame, 0);
+        return result;
+    }
+    
+    // The child was split, add its new page after it:
+    if(key_cnt < (int)BTREE_INNER_MAX) {
+        memmove(inner->keys + pos + 1, inner->keys + pos,
+                (key_cnt - pos)*sizeof(BTreeKey));
+        memmove(inner->children + pos + 2, inner->children + pos + 1,
+                (key_cnt - pos)*sizeof(uint32_t));
+        inner->keys[pos] = child_key;
+        inner->children[pos + 1] = child_page;
+        inner->header.key_cnt++;
+        release(frame, 1);
+        return 0;
+    }
+    
+    // Full as well: split it around its middle key, which moves up.
+    BTreeKey keys[BTREE_INNER_MAX + 1];
+    uint32_t children[BTREE_INNER_MAX + 2];
+    
+    memcpy(keys, inner->keys, pos*sizeof(BTreeKey));
+    keys[pos] = child_key;
+    memcpy(keys + pos + 1, inner->keys + pos,
+           (key_cnt - pos)*sizeof(BTreeKey));
+    memcpy(children, inner->children, (pos + 1)*sizeof(uint32_t));
+    children[pos + 1] = child_page;
+    memcpy(children + pos + 2, inner->children + pos + 1,
+           (key_cnt - pos)*sizeof(uint32_t));
+    key_cnt++;
+    
+    right = allocate(tree);
+    if(right == NULL) {
+        release(frame, 0);
+        return UNSUCCESSFUL;
+    }
+    half = key_cnt/2;
+    inner->header.key_cnt = (uint16_t)half;
+    memcpy(inner->keys, keys, half*sizeof(BTreeKey));
+    memcpy(inner->children, children, (half + 1)*sizeof(uint32_t));
+    right->data.header.key_cnt = (uint16_t)(key_cnt - half - 1);
+    memcpy(right->data.inner.keys, keys + half + 1,
+           (key_cnt - half - 1)*sizeof(BTreeKey));
+    memcpy(right->data.inner.children, children + half + 1,
+           (key_cnt - half)*sizeof(uint32_t));
+    *split_key = keys[half];
+    *split_page = right->page;
+    release(right, 1);
+    release(frame, 1);
+    
+    return 1;
+}
+
+// ---------------------------------------------------------------------------
+// Tree functions
+
+/**
+ * Open a tree's file, creating it if needed. Trees which are new or not
+ * valid are opened empty, with a task_cnt of -1 so they are found stale.
+ * @param tree place-holder for the opened tree.
+ * @param file_name name of the tree's file.
+ * @param writable 0 to open it for reading only, then it must exist.
+ * @return 0 if successful, else -1.
+ */
+
+int btree_open(BTree *tree, const char *file_name, int writable) {
+    BTreeFrame *frame;
+    
+    memset(tree, 0, sizeof(BTree));
+    tree->writable = writable;
+    tree->fp = fopen(file_name, writable ? "r+b" : "rb");
+    if(tree->fp == NULL && writable) tree->fp = fopen(file_name, "w+b");
+    if(tree->fp == NULL) return UNSUCCESSFUL;
+    tree->pool = (BTreePool *)malloc(sizeof(BTreePool));
+    if(tree->pool == NULL) {
+        btree_close(tree);
+        return UNSUCCESSFUL;
+    }
+    drop_pages(tree->pool);
+    
+    // The meta page is read through the first frame, then dropped:
+    frame = tree->pool->frames;
+    if(transfer(tree, 0, frame->data.bytes, 0) == SUCCESSFUL)
+        memcpy(&tree->meta, frame->data.bytes, sizeof(BTreeMeta));
+    if(memcmp(tree->meta.magic, BTREE_MAGIC, sizeof(BTREE_MAGIC))
+       || tree->meta.height < 1 || tree->meta.page_cnt < 2) {
+        memset(&tree->meta, 0, sizeof(BTreeMeta));
+        tree->meta.task_cnt = -1;
+    }
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Write back a tree's pages and close it. Trees opened for reading only
+ * are closed as they are.
+ * @param tree tree to close.
+ */
+
+void btree_close(BTree *tree) {
+    if(tree->fp != NULL && tree->writable && tree->pool != NULL
+       && tree->meta.page_cnt > 0)
+        btree_sync(tree);
+    if(tree->fp != NULL) fclose(tree->fp);
+    free(tree->pool);
+    memset(tree, 0, sizeof(BTree));
+}
+
+
+/**
+ * Write a tree's modified pages and meta page, and flush them to disk.
+ * @param tree tree to sync.
+ * @return 0 if successful, else -1.
+ */
+
+int btree_sync(BTree *tree) {
+    unsigned char page[BTREE_PAGE_SIZE];
+    
+    if(!tree->writable || tree->meta.page_cnt == 0) return SUCCESSFUL;
+    
+    for(int i = 0; i < BTREE_POOL_SIZE; i++) {
+        BTreeFrame *frame = tree->pool->frames + i;
+        if(frame->page && frame->dirty) {
+            if(transfer(tree, frame->page, frame->data.bytes, 1)
+               == UNSUCCESSFUL)
+                return UNSUCCESSFUL;
+            frame->dirty = 0;
+        }
+    }
+    memset(page, 0, BTREE_PAGE_SIZE);
+    memcpy(page, &tree->meta, sizeof(BTreeMeta));
+    if(transfer(tree, 0, page, 1) == UNSUCCESSFUL) return UNSUCCESSFUL;
+    
+    return mapfile_sync_stream(tree->fp);
+}
+
+
+/**
+ * Replace the keys of a tree by sorted keys, filling its pages from the
+ * leaves up. Inserting keys in between then splits pages.
+ * @param tree tree opened for writing.
+ * @param keys keys in order, without duplicates.
+ * @param key_cnt number of keys.
+ * @param task_cnt number of tasks in the data file, kept in the meta page.
+ * @return 0 if successful, else -1.
+ */
+
+int btree_build(BTree *tree,
+                const BTreeKey *keys,
+                long int key_cnt,
+                long int task_cnt) {
+    BTreeKey *first_keys; // first key under each page of the level built
+    uint32_t *pages; // pages of the level built
+    long int page_cnt = 0;
+    int result = SUCCESSFUL;
+    
+    if(!tree->writable) return UNSUCCESSFUL;
+    
+    page_cnt = key_cnt ? (key_cnt + BTREE_LEAF_MAX - 1)/BTREE_LEAF_MAX : 1;
+    first_keys = (BTreeKey *)malloc(page_cnt*sizeof(BTreeKey));
+    pages = (uint32_t *)malloc(page_cnt*sizeof(uint32_t));
+    if(first_keys == NULL || pages == NULL) {
+        free(first_keys);
+        free(pages);
+        return UNSUCCESSFUL;
+    }
+    
+    drop_pages(tree->pool);
+    memcpy(tree->meta.magic, BTREE_MAGIC, sizeof(BTREE_MAGIC));
+    tree->meta.task_cnt = -1; // until synced
+    tree->meta.key_cnt = key_cnt;
+    tree->meta.page_cnt = 1;
+    tree->meta.height = 1;
+    
+    // Leaves, linked in order:
+    for(long int i = 0; i < page_cnt && result == SUCCESSFUL; i++) {
+        long int first = i*BTREE_LEAF_MAX;
+        long int cnt = key_cnt - first < (long int)BTREE_LEAF_MAX
+                       ? key_cnt - first : (long int)BTREE_LEAF_MAX;
+        BTreeFrame *frame = allocate(tree);
+        
+        if(frame == NULL) {
+            result = UNSUCCESSFUL;
+            break;
+        }
+        frame->data.header.leaf = 1;
+        frame->data.header.key_cnt = (uint16_t)cnt;
+        frame->data.header.next = i + 1 < page_cnt ? frame->page + 1 : 0;
+        memcpy(frame->data.leaf.keys, keys + first, cnt*sizeof(BTreeKey));
+        if(cnt > 0) first_keys[i] = keys[first];
+        pages[i] = frame->page;
+        release(frame, 1);
+    }
+    
+    // Inner levels, until a single page is left:
+    while(page_cnt > 1 && result == SUCCESSFUL) {
+        long int parent_cnt = (page_cnt + BTREE_INNER_MAX)
+                              /(BTREE_INNER_MAX + 1);
+        
+        for(long int i = 0; i < parent_cnt; i++) {
+            long int first = i*(BTREE_INNER_MAX + 1);
+            long int cnt = page_cnt - first < (long int)BTREE_INNER_MAX + 1
+                           ? page_cnt - first : (long int)BTREE_INNER_MAX + 1;
+            BTreeFrame *frame = allocate(tree);
+            
+            if(frame == NULL) {
+                result = UNSUCCESSFUL;
+                break;
+            }
+            frame->data.header.key_cnt = (uint16_t)(cnt - 1);
+            memcpy(frame->data.inner.children, pages + first,
+                   cnt*sizeof(uint32_t));
+            memcpy(frame->data.inner.keys, first_keys + first + 1,
+                   (cnt - 1)*sizeof(BTreeKey));
+            first_keys[i] = first_keys[first];
+            pages[i] = frame->page;
+            release(frame, 1);
+        }
+        page_cnt = parent_cnt;
+        tree->meta.height++;
+    }
+    tree->meta.root = pages[0];
+    free(first_keys);
+    free(pages);
+    
+    if(result == SUCCESSFUL) tree->meta.task_cnt = task_cnt;
+    return result;
+}
+
+
+/**
+ * Insert a key into a tree, in O(log n) page reads and writes. The root
+ * is split, and the tree grows a level, when it is full.
+ * @param tree tree opened for writing.
+ * @param key key to insert, nothing is done if it is there already.
+ * @return 0 if successful, else -1.
+ */
+
+int btree_insert(BTree *tree, const BTreeKey *key) {
+    BTreeKey split_key;
+    uint32_t split_page;
+    BTreeFrame *root;
+    int result;
+    
+    if(!tree->writable || tree->meta.height < 1) return UNSUCCESSFUL;
+    
+    result = insert_into(tree, tree->meta.root, key, &split_key, &split_page);
+    if(result != 1) return result;
+    
+    root = allocate(tree);
+    if(root == NULL) return UNSUCCESSFUL;
+    root->data.header.key_cnt = 1;
+    root->data.inner.keys[0] = split_key;
+    root->data.inner.children[0] = tree->meta.root;
+    root->data.inner.children[1] = split_page;
+    tree->meta.root = root->page;
+    tree->meta.height++;
+    release(root, 1);
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Remove a key from a tree, in O(log n) page reads and one write. Pages
+ * are not merged: the tree is rebuilt often enough for underfull pages
+ * not to matter.
+ * @param tree tree opened for writing.
+ * @param key key to remove, nothing is done if it is not there.
+ * @return 0 if successful, else -1.
+ */
+
+int btree_remove(BTree *tree, const BTreeKey *key) {
+    uint32_t page = tree->meta.root;
+    BTreeFrame *frame;
+    BTreeLeaf *leaf;
+    int pos;
+    
+    if(!tree->writable || tree->meta.height < 1) return UNSUCCESSFUL;
+    
+    for(;;) {
+        frame = fetch(tree, page, 0);
+        if(frame == NULL) return UNSUCCESSFUL;
+        if(frame->data.header.leaf) break;
+        page = frame->data.inner.children[
+            search(frame->data.inner.keys, frame->data.header.key_cnt,
+                   key, 1)];
+        release(frame, 0);
+    }
+    
+    leaf = &frame->data.leaf;
+    pos = search(leaf->keys, leaf->header.key_cnt, key, 0);
+    if(pos == leaf->header.key_cnt
+       || compare_keys(leaf->keys + pos, key) != 0) {
+        release(frame, 0);
+        return SUCCESSFUL;
+    }
+    memmove(leaf->keys + pos, leaf->keys + pos + 1,
+            (leaf->header.key_cnt - pos - 1)*sizeof(BTreeKey));
+    leaf->header.key_cnt--;
+    tree->meta.key_cnt--;
+    release(frame, 1);
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Position a cursor on the first key of a tree not ordered before a key.
+ * @param tree tree to search.
+ * @param key key in question.
+ * @param cursor place-holder for the cursor, past the last key if none.
+ */
+
+void btree_seek(const BTree *tree, const BTreeKey *key, BTreeCursor *cursor) {
+    uint32_t page = tree->meta.root;
+    BTreeFrame *frame;
+    
+    cursor->page = 0;
+    cursor->pos = 0;
+    if(tree->meta.height < 1) return;
+    
+    for(;;) {
+        frame = fetch(tree, page, 0);
+        if(frame == NULL) return;
+        if(frame->data.header.leaf) break;
+        page = frame->data.inner.children[
+            search(frame->data.inner.keys, frame->data.header.key_cnt,
+                   key, 1)];
+        release(frame, 0);
+    }
+    
+    cursor->page = page;
+    cursor->pos = search(frame->data.leaf.keys, frame->data.header.key_cnt,
+                         key, 0);
+    release(frame, 0);
+}
+
+
+/**
+ * Read the key under a cursor and move it to the next one, following the
+ * leaves' links.
+ * @param tree tree the cursor is in.
+ * @param cursor cursor to move.
+ * @param key place-holder for the key read.
+ * @return 1 if a key was read, 0 past the last one.
+ */
+
+int btree_next(const BTree *tree, BTreeCursor *cursor, BTreeKey *key) {
+    while(cursor->page) {
+        BTreeFrame *frame = fetch(tree, cursor->page, 0);
+        
+        if(frame == NULL) {
+            cursor->page = 0;
+            return 0;
+        }
+        if(cursor->pos < frame->data.header.key_cnt) {
+            *key = frame->data.leaf.keys[cursor->pos++];
+            release(frame, 0);
+            return 1;
+        }
+        cursor->page = frame->data.header.next;
+        cursor->pos = 0;
+        release(frame, 0);
+    }
+    
+    return 0;
+}
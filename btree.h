@@ -0,0 +1,128 @@
+/**
+ * Page-based B+-tree.
+ * Keys (a start time and a slot) are kept sorted in 4 KiB pages of a
+ * single file: leaves hold the keys and link to the next leaf, inner pages
+ * hold the first key under each of their children but the first. Pages are
+ * read and written through a buffer pool evicting them by the clock
+ * algorithm, so inserting or removing a key reads and writes O(log n)
+ * pages, and ordered scans read the leaves in turn.
+ */
+
+#ifndef BTREE_H
+#define BTREE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "utils.h"
+
+// ---------------------------------------------------------------------------
+// Module constants
+
+#define BTREE_MAGIC "EZBTREE"
+#define BTREE_PAGE_SIZE 4096
+#define BTREE_POOL_SIZE 256 /* pages cached per tree, 1 MiB */
+
+// ---------------------------------------------------------------------------
+// Page structs
+// Page 0 of the file holds the BTreeMeta, the others a leaf or inner page.
+// Pages emptied by removals are kept until the tree is next built.
+
+typedef struct {
+    int64_t t_time; // task's start time
+    int64_t slot; // task's position in the data file
+} BTreeKey;
+
+typedef struct {
+    char magic[8]; // BTREE_MAGIC
+    int64_t task_cnt; // number of tasks in the data file when last synced
+    int64_t key_cnt; // number of keys in the leaves
+    uint32_t root; // root page
+    uint32_t height; // levels of pages, 1 if the root is a leaf
+    uint32_t page_cnt; // pages in use, the meta page included
+    uint32_t reserved; // must be zero
+} BTreeMeta;
+
+typedef struct {
+    uint16_t leaf; // 1 for leaves, 0 for inner pages
+    uint16_t key_cnt; // number of keys in the page
+    uint32_t next; // next leaf, 0 for the last one and inner pages
+} BTreePageHeader;
+
+#define BTREE_LEAF_MAX \
+    ((BTREE_PAGE_SIZE - sizeof(BTreePageHeader))/sizeof(BTreeKey))
+#define BTREE_INNER_MAX \
+    ((BTREE_PAGE_SIZE - sizeof(BTreePageHeader) - 2*sizeof(uint32_t)) \
+     /(sizeof(BTreeKey) + sizeof(uint32_t)))
+
+typedef struct {
+    BTreePageHeader header;
+    BTreeKey keys[BTREE_LEAF_MAX];
+} BTreeLeaf;
+
+typedef struct {
+    BTreePageHeader header;
+    uint32_t children[BTREE_INNER_MAX + 1];
+    BTreeKey keys[BTREE_INNER_MAX]; // keys[i] is the first under children[i+1]
+} BTreeInner;
+
+_Static_assert(sizeof(BTreeLeaf) <= BTREE_PAGE_SIZE
+               && sizeof(BTreeInner) <= BTREE_PAGE_SIZE,
+               "B+-tree pages must fit in BTREE_PAGE_SIZE");
+
+// ---------------------------------------------------------------------------
+// BTreePool struct
+// Frames holding cached pages, found by page number through a hash table
+// of chained frames. Frames in use by an operation are pinned.
+
+typedef struct {
+    uint32_t page; // page held, 0 if the frame is unused
+    uint16_t pin_cnt; // number of operations using the page
+    uint8_t dirty; // 1 if the page must be written before reuse
+    uint8_t referenced; // 1 if used since the clock last passed
+    int32_t next; // next frame of the same bucket, -1 if none
+    union {
+        BTreePageHeader header;
+        BTreeLeaf leaf;
+        BTreeInner inner;
+        unsigned char bytes[BTREE_PAGE_SIZE];
+    } data;
+} BTreeFrame;
+
+typedef struct {
+    BTreeFrame frames[BTREE_POOL_SIZE];
+    int32_t buckets[BTREE_POOL_SIZE]; // first frames by page, -1 if none
+    int hand; // next frame the clock looks at
+} BTreePool;
+
+// ---------------------------------------------------------------------------
+// BTree struct
+
+typedef struct {
+    FILE *fp; // the tree's file, NULL if closed
+    int writable; // 0 if opened for reading only
+    BTreeMeta meta; // meta page, written back when synced
+    BTreePool *pool; // cached pages
+} BTree;
+
+typedef struct {
+    uint32_t page; // leaf of the next key, 0 past the last one
+    int pos; // position of the next key in the leaf
+} BTreeCursor;
+
+// ---------------------------------------------------------------------------
+// Functions Prototypes
+
+int btree_open(BTree *tree, const char *file_name, int writable);
+void btree_close(BTree *tree);
+int btree_sync(BTree *tree);
+int btree_build(BTree *tree,
+                const BTreeKey *keys,
+                long int key_cnt,
+                long int task_cnt);
+int btree_insert(BTree *tree, const BTreeKey *key);
+int btree_remove(BTree *tree, const BTreeKey *key);
+void btree_seek(const BTree *tree, const BTreeKey *key, BTreeCursor *cursor);
+int btree_next(const BTree *tree, BTreeCursor *cursor, BTreeKey *key);
+
+#endif
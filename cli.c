@@ -0,0 +1,628 @@
+/**
+ * Ez Task command line - run a single task operation without the
+ * interactive menus, for scripts. Tasks are written one JSON object per
+ * line; errors go to stdout as "Error: ..." lines and a non-zero exit code.
+ */
+
+#include <stdlib.h>
+#include <errno.h>
+#include <limits.h>
+
+#include "task.h"
+#include "store.h"
+#include "occur.h"
+#include "rank.h"
+
+#define CLI_BATCH_SIZE 256
+#define CLI_COLLISIONS_SHOWN 16
+#define CLI_AGENDA_DAYS 30
+#define CLI_TOP_CNT 5
+#define CLI_EXTRA_LEN 48 /* a member name and an int64 value */
+
+void print_usage(const char *program);
+int parse_integer(const char *s, long long min, long long max, long long *n);
+int open_user_store(TaskStore *store, const char *file_name, int writable);
+void print_json_string(const char *s);
+void print_task_json(const Task *task, long int index, const char *extra);
+void print_view_json(const TaskView *view);
+int compare_slots(const void *a, const void *b);
+int cli_add(TaskStore *store, int argc, char *argv[]);
+int cli_list(TaskStore *store, int argc, char *argv[]);
+int cli_next(TaskStore *store, int argc, char *argv[]);
+int cli_top(TaskStore *store, int argc, char *argv[]);
+int cli_day_week(TaskStore *store,
+                 int (*filter)(TaskView *, const TaskStore *));
+int cli_agenda(TaskStore *store, int argc, char *argv[]);
+int cli_delete(TaskStore *store, int argc, char *argv[]);
+int cli_engine(TaskStore *store, int argc, char *argv[]);
+int cli_get(TaskStore *store, int argc, char *argv[]);
+int cli_find(TaskStore *store, int argc, char *argv[]);
+
+int main(int argc, char *argv[]) {
+    TaskStore store;
+    char *file_name;
+    const char *command;
+    int writable;
+    int result;
+    
+    if(argc < 4 || strcmp(argv[1], "--user") != 0) {
+        print_usage(argv[0]);
+        return -1;
+    }
+    if(!valid_username(argv[2])) {
+        printf("Error: Invalid username...\n");
+        return -1;
+    }
+    command = argv[3];
+    writable = strcmp(command, "add") == 0 || strcmp(command, "delete") == 0
+               || (strcmp(command, "engine") == 0 && argc > 4);
+    
+    file_name = username2datafilename(argv[2], "");
+    result = open_user_store(&store, file_name, writable);
+    free(file_name);
+    if(result == UNSUCCESSFUL) return -1;
+    
+    if(strcmp(command, "add") == 0)
+        result = cli_add(&store, argc - 4, argv + 4);
+    else if(strcmp(command, "list") == 0)
+        result = cli_list(&store, argc - 4, argv + 4);
+    else if(strcmp(command, "next") == 0)
+        result = cli_next(&store, argc - 4, argv + 4);
+    else if(strcmp(command, "top") == 0)
+        result = cli_top(&store, argc - 4, argv + 4);
+    else if(strcmp(command, "day") == 0 && argc == 4)
+        result = cli_day_week(&store, get_day_tasks);
+    else if(strcmp(command, "week") == 0 && argc == 4)
+        result = cli_day_week(&store, get_week_tasks);
+    else if(strcmp(command, "agenda") == 0)
+        result = cli_agenda(&store, argc - 4, argv + 4);
+    else if(strcmp(command, "delete") == 0)
+        result = cli_delete(&store, argc - 4, argv + 4);
+    else if(strcmp(command, "engine") == 0)
+        result = cli_engine(&store, argc - 4, argv + 4);
+    else if(strcmp(command, "get") == 0)
+        result = cli_get(&store, argc - 4, argv + 4);
+    else if(strcmp(command, "find") == 0)
+        result = cli_find(&store, argc - 4, argv + 4);
+    else {
+        print_usage(argv[0]);
+        result = UNSUCCESSFUL;
+    }
+    
+    store_close(&store);
+    return result == UNSUCCESSFUL ? -1 : 0;
+}
+
+// ---------------------------------------------------------------------------
+// Helpers
+
+/**
+ * Print how to run the commands.
+ * @param program name the program was run with.
+ */
+
+void print_usage(const char *program) {
+    const char *usages[] = {
+        "add NAME START MINUTES IMPORTANCE [once|daily|weekly] [--force]",
+        "list [FROM [COUNT]]",
+        "next [THRESHOLD]",
+        "top [COUNT]",
+        "day|week",
+        "agenda [DAYS [MIN_IMPORTANCE]]",
+        "get ID",
+        "find NAME",
+        "delete INDEX|--id ID",
+        "engine [array|btree]"
+    };
+    
+    for(size_t i = 0; i < sizeof(usages)/sizeof(usages[0]); i++)
+        printf("%s %s --user USER %s\n", i ? "      " : "Usage:", program,
+               usages[i]);
+    printf("START is in seconds since the epoch, tasks are numbered from 0.\n"
+           "IDs are given when tasks are added and never change.\n"
+           "Agendas list recurrent tasks once per occurrence, DAYS is 30 by\n"
+           "default.\n"
+           "Top tasks are ranked by start time, less an hour per point of\n"
+           "importance, COUNT is 5 by default.\n"
+           "Engines index tasks by start time, the B+-tree suits users with\n"
+           "many tasks.\n");
+}
+
+
+/**
+ * Parse a whole string as a decimal integer within bounds.
+ * @param s string to parse.
+ * @param min smallest value accepted.
+ * @param max largest value accepted.
+ * @param n place-holder for the value.
+ * @return 0 if successful, else -1.
+ */
+
+int parse_integer(const char *s, long long min, long long max, long long *n) {
+    char *end;
+    
+    errno = 0;
+    *n = strtoll(s, &end, 10);
+    if(errno || end == s || *end || *n < min || *n > max)
+        return UNSUCCESSFUL;
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Open a user's data file, bringing its tasks up to date as main_menu
+ * does. Commands which only read share the file with other sessions,
+ * unless some of its tasks need updating.
+ * @param store place-holder for the opened store.
+ * @param file_name name of the user's data file.
+ * @param writable 1 if the command writes tasks, else 0.
+ * @return 0 if successful, else -1.
+ */
+
+int open_user_store(TaskStore *store, const char *file_name, int writable) {
+    if(!writable) {
+        if(store_open(store, file_name, STORE_READ) == UNSUCCESSFUL)
+            return UNSUCCESSFUL;
+        if(time(NULL) < store->header->next_expiry) return SUCCESSFUL;
+        store_close(store); // some tasks have expired
+    }
+    
+    if(store_open(store, file_name, STORE_WRITE) == UNSUCCESSFUL)
+        return UNSUCCESSFUL;
+    if(update_all_tasks(store) == UNSUCCESSFUL) {
+        printf("Error: Unable to update tasks...\n");
+        store_close(store);
+        return UNSUCCESSFUL;
+    }
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Print a string as a JSON string literal.
+ */
+
+void print_json_string(const char *s) {
+    putchar('"');
+    for(; *s; s++) {
+        if(*s == '"' || *s == '\\')
+            printf("\\%c", *s);
+        else if((unsigned char)*s < 0x20)
+            printf("\\u%04x", (unsigned char)*s);
+        else
+            putchar(*s);
+    }
+    putchar('"');
+}
+
+
+/**
+ * Print a task as a JSON object on its own line.
+ * @param task task to print.
+ * @param index number of the task in the store.
+ * @param extra more members, printed as is after a comma, or NULL.
+ */
+
+void print_task_json(const Task *task, long int index, const char *extra) {
+    char name[TASK_NAME_MAXLEN];
+    
+    memcpy(name, task->t_name, TASK_NAME_MAXLEN);
+    name[TASK_NAME_MAXLEN - 1] = '\0'; // names read from file may be full
+    
+    printf("{\"index\":%ld,\"id\":%llu,\"name\":", index,
+           (unsigned long long)task->t_id);
+    print_json_string(name);
+    printf(",\"time\":%lld,\"duration\":%u,\"importance\":%u,"
+           "\"recurrence\":\"%s\",\"repeat_cnt\":%u,\"active\":%s",
+           (long long)task->t_time, task->t_duration_in_mins,
+           task->t_importance_rtn,
+           task->flags & FLAG_DAILY ? "daily"
+           : task->flags & FLAG_WEEKLY ? "weekly" : "once",
+           task->t_repeat_cnt,
+           task->flags & FLAG_ACTIVE ? "true" : "false");
+    if(extra != NULL) printf(",%s", extra);
+    printf("}\n");
+}
+
+
+/**
+ * Print every task of a view, in batches.
+ */
+
+void print_view_json(const TaskView *view) {
+    Task buffer[CLI_BATCH_SIZE];
+    TaskCursor cursor;
+    long int index = 0;
+    int read_cnt;
+    
+    store_cursor_init(&cursor, view, 0);
+    while((read_cnt = store_cursor_read(&cursor, buffer, CLI_BATCH_SIZE))
+          > 0)
+        for(int i = 0; i < read_cnt; i++, index++)
+            print_task_json(buffer + i,
+                            store_index(view->store,
+                                        store_view_slot(view, index)),
+                            NULL);
+}
+
+
+/**
+ * Order slots, so tasks are printed in file order.
+ */
+
+int compare_slots(const void *a, const void *b) {
+    long int sa = *(const long int *)a;
+    long int sb = *(const long int *)b;
+    return (sa > sb) - (sa < sb);
+}
+
+// ---------------------------------------------------------------------------
+// Commands
+// Each gets the arguments following its name.
+
+/**
+ * Add a task, warned about collisions. It is not saved if it collides with
+ * others, which are printed, unless forced.
+ * @return 0 if successful, else -1.
+ */
+
+int cli_add(TaskStore *store, int argc, char *argv[]) {
+    Task task;
+    long long n;
+    int64_t collisions[CLI_COLLISIONS_SHOWN];
+    long int collision_cnt;
+    int force = argc > 0 && strcmp(argv[argc - 1], "--force") == 0;
+    
+    if(force) argc--;
+    if(argc < 4 || argc > 5) {
+        printf("Error: Invalid arguments...\n");
+        return UNSUCCESSFUL;
+    }
+    
+    memset(&task, 0, sizeof(Task)); // keep reserved bytes zero
+    task.flags = FLAG_ACTIVE | FLAG_COLLISION_WARNING;
+    strncpy(task.t_name, argv[0], TASK_NAME_MAXLEN - 1);
+    if(parse_integer(argv[1], 0, INT64_MAX, &n) == UNSUCCESSFUL) {
+        printf("Error: Invalid start time...\n");
+        return UNSUCCESSFUL;
+    }
+    task.t_time = n;
+    if(parse_integer(argv[2], 1, UINT16_MAX, &n) == UNSUCCESSFUL) {
+        printf("Error: Invalid duration...\n");
+        return UNSUCCESSFUL;
+    }
+    task.t_duration_in_mins = (uint16_t)n;
+    if(parse_integer(argv[3], 0, UINT8_MAX, &n) == UNSUCCESSFUL) {
+        printf("Error: Invalid importance rating...\n");
+        return UNSUCCESSFUL;
+    }
+    task.t_importance_rtn = (uint8_t)n;
+    if(argc == 5) {
+        if(strcmp(argv[4], "daily") == 0)
+            task.flags |= FLAG_DAILY;
+        else if(strcmp(argv[4], "weekly") == 0)
+            task.flags |= FLAG_WEEKLY;
+        else if(strcmp(argv[4], "once") != 0) {
+            printf("Error: Invalid recurrence...\n");
+            return UNSUCCESSFUL;
+        }
+    }
+    
+    if(!force) {
+        collision_cnt = find_collisions(&task, store, collisions,
+                                        CLI_COLLISIONS_SHOWN);
+        if(collision_cnt > 0) {
+            for(long int i = 0; i < collision_cnt; i++)
+                print_task_json(store->tasks + collisions[i],
+                                store_index(store, collisions[i]),
+                                "\"collision\":true");
+            printf("Error: Task collides with others, use --force...\n");
+            return UNSUCCESSFUL;
+        }
+    }
+    
+    if(save_task(&task, store) == UNSUCCESSFUL) return UNSUCCESSFUL;
+    printf("{\"id\":%llu}\n", (unsigned long long)task.t_id);
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * List tasks in file order, all of them or COUNT from FROM.
+ * @return 0 if successful, else -1.
+ */
+
+int cli_list(TaskStore *store, int argc, char *argv[]) {
+    Task buffer[CLI_BATCH_SIZE];
+    long long from = 0;
+    long long task_cnt = LONG_MAX;
+    int read_cnt;
+    
+    if(argc > 2
+       || (argc > 0
+           && parse_integer(argv[0], 0, LONG_MAX, &from) == UNSUCCESSFUL)
+       || (argc > 1
+           && parse_integer(argv[1], 0, LONG_MAX, &task_cnt)
+              == UNSUCCESSFUL)) {
+        printf("Error: Invalid arguments...\n");
+        return UNSUCCESSFUL;
+    }
+    
+    while(task_cnt > 0
+          && (read_cnt = read_tasks(buffer, (long int)from,
+                                    task_cnt < CLI_BATCH_SIZE
+                                    ? (int)task_cnt : CLI_BATCH_SIZE,
+                                    store)) > 0) {
+        for(int i = 0; i < read_cnt; i++)
+            print_task_json(buffer + i, (long int)from + i, NULL);
+        from += read_cnt;
+        task_cnt -= read_cnt;
+    }
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Show the next task rated above THRESHOLD, 0 by default.
+ * @return 0 if there is one, else -1.
+ */
+
+int cli_next(TaskStore *store, int argc, char *argv[]) {
+    Task task;
+    IndexCursor cursor;
+    IndexEntry entry;
+    long long threshold = 0;
+    char extra[CLI_EXTRA_LEN];
+    int mins_til_next;
+    
+    if(argc > 1
+       || (argc > 0
+           && parse_integer(argv[0], 0, UINT8_MAX, &threshold)
+              == UNSUCCESSFUL)) {
+        printf("Error: Invalid arguments...\n");
+        return UNSUCCESSFUL;
+    }
+    
+    mins_til_next = get_next_task(&task, (uint8_t)threshold, store);
+    if(mins_til_next == UNSUCCESSFUL) return UNSUCCESSFUL;
+    
+    // Find its slot again: the first entry from its start time rated above
+    // the threshold, as get_next_task found it.
+    snprintf(extra, sizeof(extra), "\"mins_til_start\":%d", mins_til_next);
+    index_seek(&store->index, task.t_time, &cursor);
+    while(index_next(&cursor, &entry)) {
+        if(store->cols.t_importance_rtn[entry.slot] > threshold) {
+            print_task_json(&task, store_index(store, entry.slot), extra);
+            break;
+        }
+    }
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * List the COUNT upcoming tasks ranking first by importance and time until
+ * start, best first.
+ * @return 0 if successful, else -1.
+ */
+
+int cli_top(TaskStore *store, int argc, char *argv[]) {
+    Ranking ranking;
+    long long task_cnt = CLI_TOP_CNT;
+    char extra[CLI_EXTRA_LEN];
+    time_t now;
+    int ranked_cnt;
+    
+    if(argc > 1
+       || (argc > 0
+           && parse_integer(argv[0], 1, RANK_MAX, &task_cnt)
+              == UNSUCCESSFUL)) {
+        printf("Error: Invalid arguments...\n");
+        return UNSUCCESSFUL;
+    }
+    if(rank_init(&ranking, (int)task_cnt) == UNSUCCESSFUL) {
+        printf("Error: Out of memory...\n");
+        return UNSUCCESSFUL;
+    }
+    
+    time(&now);
+    ranked_cnt = rank_scan(&ranking, store, now);
+    for(int i = 0; i < ranked_cnt; i++) {
+        long int slot = ranking.tasks[i].slot;
+        snprintf(extra, sizeof(extra), "\"mins_til_start\":%lld",
+                 (long long)(store->tasks[slot].t_time - now)/SECS_PER_MIN);
+        print_task_json(store->tasks + slot, store_index(store, slot), extra);
+    }
+    rank_free(&ranking);
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * List the tasks left today, or the important ones left this week.
+ * @param filter get_day_tasks or get_week_tasks.
+ * @return 0 if successful, else -1.
+ */
+
+int cli_day_week(TaskStore *store,
+                 int (*filter)(TaskView *, const TaskStore *)) {
+    TaskView view;
+    
+    store_view_all(&view, store);
+    if(filter(&view, store) == UNSUCCESSFUL) {
+        store_view_free(&view);
+        return UNSUCCESSFUL;
+    }
+    print_view_json(&view);
+    store_view_free(&view);
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * List the occurrences of tasks rated at least MIN_IMPORTANCE, 0 by
+ * default, starting within the next DAYS days, in time order. Recurrent
+ * tasks are listed once per occurrence.
+ * @return 0 if successful, else -1.
+ */
+
+int cli_agenda(TaskStore *store, int argc, char *argv[]) {
+    Occurrence buffer[CLI_BATCH_SIZE];
+    OccurrenceIter iter;
+    long long days = CLI_AGENDA_DAYS;
+    long long min_importance = 0;
+    char extra[CLI_EXTRA_LEN];
+    time_t now;
+    int read_cnt;
+    
+    if(argc > 2
+       || (argc > 0
+           && parse_integer(argv[0], 1, INT_MAX/SECS_PER_DAY, &days)
+              == UNSUCCESSFUL)
+       || (argc > 1
+           && parse_integer(argv[1], 0, UINT8_MAX, &min_importance)
+              == UNSUCCESSFUL)) {
+        printf("Error: Invalid arguments...\n");
+        return UNSUCCESSFUL;
+    }
+    
+    time(&now);
+    if(occur_init(&iter, store, now, now + (time_t)days*SECS_PER_DAY,
+                  (uint8_t)min_importance) == UNSUCCESSFUL)
+        return UNSUCCESSFUL;
+    while((read_cnt = occur_read(&iter, buffer, CLI_BATCH_SIZE)) > 0)
+        for(int i = 0; i < read_cnt; i++) {
+            snprintf(extra, sizeof(extra), "\"start\":%lld",
+                     (long long)buffer[i].t_start);
+            print_task_json(store->tasks + buffer[i].slot,
+                            store_index(store, buffer[i].slot),
+                            extra);
+        }
+    occur_free(&iter);
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Delete the task numbered INDEX, as listed, or the task of ID ID.
+ * @return 0 if successful, else -1.
+ */
+
+int cli_delete(TaskStore *store, int argc, char *argv[]) {
+    long long index;
+    long long id;
+    
+    if(argc == 2 && strcmp(argv[0], "--id") == 0) {
+        if(parse_integer(argv[1], 1, LLONG_MAX, &id) == UNSUCCESSFUL) {
+            printf("Error: Invalid arguments...\n");
+            return UNSUCCESSFUL;
+        }
+        if(delete_task_id((uint64_t)id, store) == UNSUCCESSFUL) {
+            printf("Error: Specified ID does not exist...\n");
+            return UNSUCCESSFUL;
+        }
+        return SUCCESSFUL;
+    }
+    
+    if(argc != 1
+       || parse_integer(argv[0], 0, LONG_MAX, &index) == UNSUCCESSFUL) {
+        printf("Error: Invalid arguments...\n");
+        return UNSUCCESSFUL;
+    }
+    if(index >= get_task_cnt(store)) {
+        printf("Error: Specified index exceeds file size...\n");
+        return UNSUCCESSFUL;
+    }
+    
+    return delete_task((long int)index, store);
+}
+
+
+/**
+ * Show the user's index engine, or switch it to ENGINE.
+ * @return 0 if successful, else -1.
+ */
+
+int cli_engine(TaskStore *store, int argc, char *argv[]) {
+    const char *names[] = {"array", "btree"}; // by INDEX_ARRAY, INDEX_BTREE
+    
+    if(argc > 1) {
+        printf("Error: Invalid arguments...\n");
+        return UNSUCCESSFUL;
+    }
+    if(argc == 1) {
+        int engine;
+        if(strcmp(argv[0], names[INDEX_ARRAY]) == 0)
+            engine = INDEX_ARRAY;
+        else if(strcmp(argv[0], names[INDEX_BTREE]) == 0)
+            engine = INDEX_BTREE;
+        else {
+            printf("Error: Invalid arguments...\n");
+            return UNSUCCESSFUL;
+        }
+        if(store_set_engine(store, engine) == UNSUCCESSFUL)
+            return UNSUCCESSFUL;
+    }
+    printf("{\"engine\":\"%s\"}\n", names[store->index.engine]);
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Show the task of ID ID.
+ * @return 0 if there is one, else -1.
+ */
+
+int cli_get(TaskStore *store, int argc, char *argv[]) {
+    long long id;
+    Task task;
+    
+    if(argc != 1
+       || parse_integer(argv[0], 1, LLONG_MAX, &id) == UNSUCCESSFUL) {
+        printf("Error: Invalid arguments...\n");
+        return UNSUCCESSFUL;
+    }
+    if(read_task_id(&task, (uint64_t)id, store) == UNSUCCESSFUL)
+        return UNSUCCESSFUL;
+    print_task_json(&task, store_index(store, store_find_id(store, task.t_id)),
+                    NULL);
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * List the tasks named NAME exactly, in file order.
+ * @return 0 if successful, else -1.
+ */
+
+int cli_find(TaskStore *store, int argc, char *argv[]) {
+    uint64_t ids[TASK_FIND_MAX];
+    long int slots[TASK_FIND_MAX];
+    int found_cnt;
+    
+    if(argc != 1) {
+        printf("Error: Invalid arguments...\n");
+        return UNSUCCESSFUL;
+    }
+    found_cnt = find_tasks_by_name(ids, TASK_FIND_MAX, argv[0], store);
+    if(found_cnt == UNSUCCESSFUL) return UNSUCCESSFUL;
+    if(found_cnt > TASK_FIND_MAX) found_cnt = TASK_FIND_MAX;
+    
+    for(int i = 0; i < found_cnt; i++)
+        slots[i] = store_find_id(store, ids[i]);
+    qsort(slots, found_cnt, sizeof(long int), compare_slots);
+    for(int i = 0; i < found_cnt; i++)
+        print_task_json(store->tasks + slots[i], store_index(store, slots[i]),
+                        NULL);
+    
+    return SUCCESSFUL;
+}
@@ -0,0 +1,298 @@
+#include "collision.h"
+
+#include <stdlib.h>
+
+#define CANDIDATE_BUFFER_SIZE 64
+
+// ---------------------------------------------------------------------------
+// Helpers
+
+/**
+ * Remainder of a division, always in [0, m).
+ */
+
+static int64_t floor_mod(int64_t a, int64_t m) {
+    int64_t r = a%m;
+    return r < 0 ? r + m : r;
+}
+
+
+/**
+ * Check whether any real occurrence of a task overlaps [low, high).
+ * @param task the task in question.
+ * @param low start of the time range.
+ * @param high end of the time range, excluded.
+ * @return 1 if they overlap, else 0.
+ */
+
+static int occurs_within(const Task *task, int64_t low, int64_t high) {
+    int64_t start = task->t_time;
+    int64_t duration = (int64_t)task->t_duration_in_mins*SECS_PER_MIN;
+    int64_t period = get_period(task);
+    
+    // Skip to the first occurrence not ended by low:
+    if(period && start + duration <= low)
+        start += ((low - start - duration)/period + 1)*period;
+    
+    return start < high && low < start + duration;
+}
+
+
+/**
+ * Fold a real time range into the week.
+ * @param low start of the time range.
+ * @param high end of the time range, excluded.
+ * @param pieces place-holder for the folded ranges, room for 2 needed.
+ * @return number of folded ranges.
+ */
+
+static int fold_range(int64_t low, int64_t high, int64_t (*pieces)[2]) {
+    int64_t folded_low;
+    
+    if(high - low >= COLLISION_PERIOD) { // covers the whole week
+        pieces[0][0] = 0;
+        pieces[0][1] = COLLISION_PERIOD;
+        return 1;
+    }
+    
+    folded_low = floor_mod(low, COLLISION_PERIOD);
+    pieces[0][0] = folded_low;
+    if(folded_low + high - low <= COLLISION_PERIOD) {
+        pieces[0][1] = folded_low + high - low;
+        return 1;
+    }
+    
+    // Wraps around the end of the week:
+    pieces[0][1] = COLLISION_PERIOD;
+    pieces[1][0] = 0;
+    pieces[1][1] = folded_low + high - low - COLLISION_PERIOD;
+    return 2;
+}
+
+
+/**
+ * Fold all occurrences of a task into the week.
+ * @param task the task in question.
+ * @param pieces place-holder for the folded ranges, room for
+ *               MAX_FOLDED_PIECES needed.
+ * @return number of folded ranges.
+ */
+
+static int fold_task(const Task *task, int64_t (*pieces)[2]) {
+    int64_t duration = (int64_t)task->t_duration_in_mins*SECS_PER_MIN;
+    int64_t period = get_period(task);
+    int64_t low, high;
+    int piece_cnt = 0;
+    
+    if(!period) return fold_range(task->t_time,
+                                  task->t_time + duration,
+                                  pieces);
+    
+    if(duration >= period) // always on going
+        return fold_range(0, COLLISION_PERIOD, pieces);
+    
+    // Occurrences starting in the week, and the one wrapping into it:
+    for(low = floor_mod(task->t_time, period) - period;
+        low < COLLISION_PERIOD;
+        low += period) {
+        high = low + duration;
+        if(high > COLLISION_PERIOD) high = COLLISION_PERIOD;
+        if(low < 0) {
+            if(high <= 0) continue; // ends before the week
+            pieces[piece_cnt][0] = 0;
+        } else
+            pieces[piece_cnt][0] = low;
+        pieces[piece_cnt][1] = high;
+        piece_cnt++;
+    }
+    
+    return piece_cnt;
+}
+
+
+/**
+ * Collect candidate slots overlapping a range into a growable buffer.
+ * @return new number of candidates, -1 if out of memory.
+ */
+
+static long int collect(const IntervalTree *tree,
+                        int64_t low,
+                        int64_t high,
+                        int64_t **candidates,
+                        long int *capacity,
+                        long int candidate_cnt) {
+    long int found_cnt;
+    
+    found_cnt = itree_overlaps(tree, low, high,
+                               *candidates + candidate_cnt,
+                               *capacity - candidate_cnt);
+    if(candidate_cnt + found_cnt > *capacity) { // grow and search again
+        int64_t *grown = (*capacity == CANDIDATE_BUFFER_SIZE)
+                         ? malloc(2*(candidate_cnt + found_cnt)
+                                  *sizeof(int64_t))
+                         : realloc(*candidates,
+                                   2*(candidate_cnt + found_cnt)
+                                   *sizeof(int64_t));
+        if(grown == NULL) return UNSUCCESSFUL;
+        if(*capacity == CANDIDATE_BUFFER_SIZE)
+            memcpy(grown, *candidates, candidate_cnt*sizeof(int64_t));
+        *candidates = grown;
+        *capacity = 2*(candidate_cnt + found_cnt);
+        itree_overlaps(tree, low, high,
+                       *candidates + candidate_cnt,
+                       *capacity - candidate_cnt);
+    }
+    
+    return candidate_cnt + found_cnt;
+}
+
+// ---------------------------------------------------------------------------
+// Collision index functions
+
+/**
+ * Make an empty collision index.
+ * @param ci index to initialize.
+ */
+
+void collision_init(CollisionIndex *ci) {
+    itree_init(&ci->once);
+    itree_init(&ci->once_folded);
+    itree_init(&ci->recurrent);
+}
+
+
+/**
+ * Release the trees of a collision index, leaving it empty.
+ * @param ci index to free.
+ */
+
+void collision_free(CollisionIndex *ci) {
+    itree_free(&ci->once);
+    itree_free(&ci->once_folded);
+    itree_free(&ci->recurrent);
+}
+
+
+/**
+ * Add a task to a collision index.
+ * @param ci index to add to.
+ * @param task the task, ignored if it is not active.
+ * @param slot position of the task in the data file.
+ * @return 0 if successful, else -1.
+ */
+
+int collision_add(CollisionIndex *ci, const Task *task, long int slot) {
+    int64_t pieces[MAX_FOLDED_PIECES][2];
+    int piece_cnt;
+    IntervalTree *folded_tree;
+    
+    if(!(task->flags & FLAG_ACTIVE)) return SUCCESSFUL;
+    
+    if(get_period(task)) {
+        folded_tree = &ci->recurrent;
+    } else {
+        folded_tree = &ci->once_folded;
+        if(itree_insert(&ci->once, task->t_time, get_end_time(task), slot)
+           == UNSUCCESSFUL)
+            return UNSUCCESSFUL;
+    }
+    
+    piece_cnt = fold_task(task, pieces);
+    for(int i = 0; i < piece_cnt; i++)
+        if(itree_insert(folded_tree, pieces[i][0], pieces[i][1], slot)
+           == UNSUCCESSFUL)
+            return UNSUCCESSFUL;
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Build a collision index from all active tasks of a data file.
+ * @param ci empty index to fill.
+ * @param tasks records of the data file.
+ * @param task_cnt number of records of the data file.
+ * @return 0 if successful, else -1.
+ */
+
+int collision_build(CollisionIndex *ci, const Task *tasks, long int task_cnt) {
+    for(long int i = 0; i < task_cnt; i++)
+        if(collision_add(ci, tasks + i, i) == UNSUCCESSFUL)
+            return UNSUCCESSFUL;
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Find the active tasks colliding with a task.
+ * Tasks which are both recurrent collide if their occurrences overlap in
+ * the week, since they will eventually meet. Otherwise the recurrent one
+ * (if any) is checked against the other's real time.
+ * @param ci index of the data file.
+ * @param tasks records of the data file.
+ * @param task the task in question, usually not saved yet.
+ * @param warn_all report all collisions if not 0, else only those with
+ *                 tasks carrying FLAG_COLLISION_WARNING.
+ * @param slots place-holder for the colliding tasks' positions.
+ * @param max_slots capacity of slots.
+ * @return number of colliding tasks found, at most max_slots.
+ */
+
+long int collision_find(const CollisionIndex *ci,
+                        const Task *tasks,
+                        const Task *task,
+                        int warn_all,
+                        int64_t *slots,
+                        long int max_slots) {
+    int64_t buffer[CANDIDATE_BUFFER_SIZE];
+    int64_t *candidates = buffer;
+    long int capacity = CANDIDATE_BUFFER_SIZE;
+    long int candidate_cnt = 0;
+    long int found_cnt = 0;
+    int64_t pieces[MAX_FOLDED_PIECES][2];
+    int piece_cnt;
+    int is_recurrent = get_period(task) != 0;
+    int64_t start = task->t_time;
+    int64_t end = get_end_time(task);
+    
+    // Collect candidates, which may repeat:
+    if(!is_recurrent)
+        candidate_cnt = collect(&ci->once, start, end,
+                                &candidates, &capacity, candidate_cnt);
+    piece_cnt = fold_task(task, pieces);
+    for(int i = 0; i < piece_cnt && candidate_cnt >= 0; i++) {
+        if(is_recurrent)
+            candidate_cnt = collect(&ci->once_folded,
+                                    pieces[i][0], pieces[i][1],
+                                    &candidates, &capacity, candidate_cnt);
+        if(candidate_cnt >= 0)
+            candidate_cnt = collect(&ci->recurrent,
+                                    pieces[i][0], pieces[i][1],
+                                    &candidates, &capacity, candidate_cnt);
+    }
+    
+    // Check candidates exactly, keep distinct ones:
+    for(long int i = 0; i < candidate_cnt && found_cnt < max_slots; i++) {
+        const Task *other = tasks + candidates[i];
+        int collides;
+        int is_new = 1;
+        
+        if(!(other->flags & FLAG_ACTIVE)) continue;
+        if(!warn_all && !(other->flags & FLAG_COLLISION_WARNING)) continue;
+        
+        if(get_period(other))
+            collides = is_recurrent || occurs_within(other, start, end);
+        else
+            collides = occurs_within(task, other->t_time,
+                                     get_end_time(other));
+        
+        for(long int j = 0; j < found_cnt && is_new; j++)
+            if(slots[j] == candidates[i]) is_new = 0;
+        if(collides && is_new) slots[found_cnt++] = candidates[i];
+    }
+    
+    if(candidates != buffer) free(candidates);
+    
+    return found_cnt;
+}
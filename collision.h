@@ -0,0 +1,55 @@
+/**
+ * Collision detection between tasks.
+ * Daily and weekly tasks repeat forever, but every recurrence repeats within
+ * a week, so their occurrences are folded into a single week. One-time tasks
+ * are kept at their real time, and folded as well for comparing them with
+ * new recurrent tasks. Interval trees over these give O(log n + k) lookups;
+ * each candidate is then checked exactly against the tasks' real times.
+ */
+
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include <stdint.h>
+
+#include "task.h"
+#include "itree.h"
+
+// ---------------------------------------------------------------------------
+// Module constants
+
+/**
+ * Length of the folded week, every recurrence period divides it.
+ */
+#define COLLISION_PERIOD SECS_PER_WEEK
+
+/**
+ * Most pieces a task folds into: a daily task's 7 occurrences plus the one
+ * wrapping around from the previous day.
+ */
+#define MAX_FOLDED_PIECES (COLLISION_PERIOD/SECS_PER_DAY + 2)
+
+// ---------------------------------------------------------------------------
+// CollisionIndex struct
+
+typedef struct {
+    IntervalTree once; // one-time tasks at their real time
+    IntervalTree once_folded; // one-time tasks folded into the week
+    IntervalTree recurrent; // recurrent tasks' occurrences in the week
+} CollisionIndex;
+
+// ---------------------------------------------------------------------------
+// Functions Prototypes
+
+void collision_init(CollisionIndex *ci);
+void collision_free(CollisionIndex *ci);
+int collision_add(CollisionIndex *ci, const Task *task, long int slot);
+int collision_build(CollisionIndex *ci, const Task *tasks, long int task_cnt);
+long int collision_find(const CollisionIndex *ci,
+                        const Task *tasks,
+                        const Task *task,
+                        int warn_all,
+                        int64_t *slots,
+                        long int max_slots);
+
+#endif
@@ -0,0 +1,96 @@
+#include "columns.h"
+
+#include <stdlib.h>
+
+// ---------------------------------------------------------------------------
+// Columns functions
+
+/**
+ * Initialize empty columns.
+ * @param cols columns to initialize.
+ */
+
+void columns_init(TaskColumns *cols) {
+    memset(cols, 0, sizeof(TaskColumns));
+}
+
+
+/**
+ * Free the memory held by columns.
+ * @param cols columns to free.
+ */
+
+void columns_free(TaskColumns *cols) {
+    free(cols->t_time);
+    free(cols->t_duration_in_mins);
+    free(cols->t_importance_rtn);
+    free(cols->flags);
+    columns_init(cols);
+}
+
+
+/**
+ * Make room in every column for a number of slots.
+ * @param cols columns to grow.
+ * @param slot_cnt number of slots needed.
+ * @return 0 if successful, else -1.
+ */
+
+int columns_reserve(TaskColumns *cols, long int slot_cnt) {
+    long int new_cap;
+    void *column;
+    
+    if(slot_cnt <= cols->cap) return SUCCESSFUL;
+    
+    new_cap = cols->cap ? cols->cap : 64;
+    while(new_cap < slot_cnt) new_cap *= 2;
+    
+    column = realloc(cols->t_time, new_cap*sizeof(int64_t));
+    if(column == NULL) return UNSUCCESSFUL;
+    cols->t_time = column;
+    column = realloc(cols->t_duration_in_mins, new_cap*sizeof(uint16_t));
+    if(column == NULL) return UNSUCCESSFUL;
+    cols->t_duration_in_mins = column;
+    column = realloc(cols->t_importance_rtn, new_cap);
+    if(column == NULL) return UNSUCCESSFUL;
+    cols->t_importance_rtn = column;
+    column = realloc(cols->flags, new_cap);
+    if(column == NULL) return UNSUCCESSFUL;
+    cols->flags = column;
+    cols->cap = new_cap;
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Copy a task's hot fields into its slot, which must be reserved.
+ * @param cols columns to write to.
+ * @param slot slot of the task.
+ * @param task the task in question.
+ */
+
+void columns_set(TaskColumns *cols, long int slot, const Task *task) {
+    cols->t_time[slot] = task->t_time;
+    cols->t_duration_in_mins[slot] = task->t_duration_in_mins;
+    cols->t_importance_rtn[slot] = task->t_importance_rtn;
+    cols->flags[slot] = task->flags;
+}
+
+
+/**
+ * Fill the columns from the records of a data file.
+ * @param cols columns to fill.
+ * @param tasks records of the data file.
+ * @param task_cnt number of records.
+ * @return 0 if successful, else -1.
+ */
+
+int columns_build(TaskColumns *cols, const Task *tasks, long int task_cnt) {
+    if(columns_reserve(cols, task_cnt) == UNSUCCESSFUL) return UNSUCCESSFUL;
+    
+    for(long int i = 0; i < task_cnt; i++)
+        columns_set(cols, i, tasks + i);
+    
+    return SUCCESSFUL;
+}
@@ -0,0 +1,36 @@
+/**
+ * Hot columns of the task store.
+ * Queries only filter on a task's time, duration, importance and flags, so
+ * those fields are mirrored in one array each, by slot. Scanning them reads
+ * 12 bytes per task instead of a whole record; records (and their names)
+ * are only read for the rows a query returns.
+ */
+
+#ifndef COLUMNS_H
+#define COLUMNS_H
+
+#include <stdint.h>
+
+#include "task.h"
+
+// ---------------------------------------------------------------------------
+// TaskColumns struct
+
+typedef struct {
+    int64_t *t_time; // start times
+    uint16_t *t_duration_in_mins; // durations
+    uint8_t *t_importance_rtn; // importance ratings
+    uint8_t *flags; // flags
+    long int cap; // capacity of every array, in slots
+} TaskColumns;
+
+// ---------------------------------------------------------------------------
+// Functions Prototypes
+
+void columns_init(TaskColumns *cols);
+void columns_free(TaskColumns *cols);
+int columns_reserve(TaskColumns *cols, long int slot_cnt);
+void columns_set(TaskColumns *cols, long int slot, const Task *task);
+int columns_build(TaskColumns *cols, const Task *tasks, long int task_cnt);
+
+#endif
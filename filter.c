@@ -0,0 +1,266 @@
+#include "filter.h"
+
+#include <stdatomic.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FILTER_X86
+#include <immintrin.h>
+#endif
+
+// Kernel used by filters, -1 until picked. Filters may run on any thread.
+static _Atomic int selected_level = -1;
+
+// ---------------------------------------------------------------------------
+// Kernels
+// Each one fills the bitmap words of slots [first, last), first being a
+// multiple of 64. Bits past last are cleared.
+
+/**
+ * Scalar kernel, used for tails and on any processor.
+ */
+
+static void kernel_scalar(const TaskColumns *cols,
+                          long int first,
+                          long int last,
+                          int64_t after,
+                          int64_t before,
+                          uint8_t min_importance,
+                          uint64_t *bitmap) {
+    for(long int w = first/64; w*64 < last; w++) {
+        uint64_t word = 0;
+        for(long int i = w*64, b = 0; b < 64 && i < last; i++, b++)
+            word |= (uint64_t)(cols->flags[i] & FLAG_ACTIVE
+                               && cols->t_time[i] > after
+                               && cols->t_time[i] < before
+                               && cols->t_importance_rtn[i] >= min_importance)
+                    << b;
+        bitmap[w] = word;
+    }
+}
+
+#ifdef FILTER_X86
+
+/**
+ * SSE4.2 kernel, 2 tasks per step.
+ */
+
+__attribute__((target("sse4.2")))
+static void kernel_sse4(const TaskColumns *cols,
+                        long int first,
+                        long int last,
+                        int64_t after,
+                        int64_t before,
+                        uint8_t min_importance,
+                        uint64_t *bitmap) {
+    const __m128i v_after = _mm_set1_epi64x(after);
+    const __m128i v_before = _mm_set1_epi64x(before);
+    const __m128i v_importance = _mm_set1_epi64x((int64_t)min_importance - 1);
+    const __m128i v_active = _mm_set1_epi64x(FLAG_ACTIVE);
+    long int full = first + (last - first)/64*64;
+    
+    for(long int i = first; i < full; i += 64) {
+        uint64_t word = 0;
+        for(int b = 0; b < 64; b += 2) {
+            uint16_t flags, importance;
+            __m128i t, f, imp, m;
+            memcpy(&flags, cols->flags + i + b, 2);
+            memcpy(&importance, cols->t_importance_rtn + i + b, 2);
+            t = _mm_loadu_si128((const __m128i *)(cols->t_time + i + b));
+            f = _mm_cvtepu8_epi64(_mm_cvtsi32_si128(flags));
+            imp = _mm_cvtepu8_epi64(_mm_cvtsi32_si128(importance));
+            m = _mm_and_si128(_mm_cmpgt_epi64(t, v_after),
+                              _mm_cmpgt_epi64(v_before, t));
+            m = _mm_and_si128(m, _mm_cmpgt_epi64(imp, v_importance));
+            m = _mm_and_si128(m, _mm_cmpeq_epi64(_mm_and_si128(f, v_active),
+                                                 v_active));
+            word |= (uint64_t)_mm_movemask_pd(_mm_castsi128_pd(m)) << b;
+        }
+        bitmap[i/64] = word;
+    }
+    
+    if(full < last)
+        kernel_scalar(cols, full, last, after, before, min_importance, bitmap);
+}
+
+
+/**
+ * AVX2 kernel, 4 tasks per step.
+ */
+
+__attribute__((target("avx2")))
+static void kernel_avx2(const TaskColumns *cols,
+                        long int first,
+                        long int last,
+                        int64_t after,
+                        int64_t before,
+                        uint8_t min_importance,
+                        uint64_t *bitmap) {
+    const __m256i v_after = _mm256_set1_epi64x(after);
+    const __m256i v_before = _mm256_set1_epi64x(before);
+    const __m256i v_importance =
+        _mm256_set1_epi64x((int64_t)min_importance - 1);
+    const __m256i v_active = _mm256_set1_epi64x(FLAG_ACTIVE);
+    long int full = first + (last - first)/64*64;
+    
+    for(long int i = first; i < full; i += 64) {
+        uint64_t word = 0;
+        for(int b = 0; b < 64; b += 4) {
+            uint32_t flags, importance;
+            __m256i t, f, imp, m;
+            memcpy(&flags, cols->flags + i + b, 4);
+            memcpy(&importance, cols->t_importance_rtn + i + b, 4);
+            t = _mm256_loadu_si256((const __m256i *)(cols->t_time + i + b));
+            f = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(flags));
+            imp = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(importance));
+            m = _mm256_and_si256(_mm256_cmpgt_epi64(t, v_after),
+                                 _mm256_cmpgt_epi64(v_before, t));
+            m = _mm256_and_si256(m, _mm256_cmpgt_epi64(imp, v_importance));
+            m = _mm256_and_si256(m, _mm256_cmpeq_epi64(
+                                        _mm256_and_si256(f, v_active),
+                                        v_active));
+            word |= (uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(m)) << b;
+        }
+        bitmap[i/64] = word;
+    }
+    
+    if(full < last)
+        kernel_scalar(cols, full, last, after, before, min_importance, bitmap);
+}
+
+#endif
+
+// ---------------------------------------------------------------------------
+// Filter functions
+
+/**
+ * Tell whether the processor supports a kernel.
+ * @param kernel FILTER_SCALAR, FILTER_SSE4 or FILTER_AVX2.
+ * @return 1 if it does, else 0.
+ */
+
+static int kernel_supported(int kernel) {
+    switch(kernel) {
+        case FILTER_SCALAR:
+            return 1;
+#ifdef FILTER_X86
+        case FILTER_SSE4:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse4.2") != 0;
+        case FILTER_AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") != 0;
+#endif
+        default:
+            return 0;
+    }
+}
+
+
+/**
+ * Choose the kernel used by filters.
+ * @param kernel FILTER_SCALAR, FILTER_SSE4 or FILTER_AVX2.
+ * @return 0 if successful, -1 if the processor does not support it.
+ */
+
+int filter_use_kernel(int kernel) {
+    if(!kernel_supported(kernel)) return UNSUCCESSFUL;
+    
+    atomic_store(&selected_level, kernel);
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Get the kernel used by filters, picking the fastest one supported on
+ * first use. Threads racing to pick one pick the same, and a kernel chosen
+ * with filter_use_kernel meanwhile is kept.
+ * @return FILTER_SCALAR, FILTER_SSE4 or FILTER_AVX2.
+ */
+
+int filter_get_kernel(void) {
+    int level = atomic_load(&selected_level);
+    int unset = -1;
+    
+    if(level >= 0) return level;
+    
+    for(level = FILTER_AVX2; !kernel_supported(level); level--);
+    if(!atomic_compare_exchange_strong(&selected_level, &unset, level))
+        level = unset; // picked by another thread
+    
+    return level;
+}
+
+
+/**
+ * Select active tasks starting within (after, before), rated at least
+ * min_importance.
+ * @param cols columns of the store.
+ * @param task_cnt number of slots to check.
+ * @param after start of the time range, excluded.
+ * @param before end of the time range, excluded.
+ * @param min_importance lowest importance selected.
+ * @param bitmap place-holder for the selection, BITMAP_WORDS(task_cnt)
+ *               words; bit i%64 of word i/64 is set if slot i is selected.
+ * @return number of selected tasks.
+ */
+
+long int filter_upcoming(const TaskColumns *cols,
+                         long int task_cnt,
+                         int64_t after,
+                         int64_t before,
+                         uint8_t min_importance,
+                         uint64_t *bitmap) {
+    long int selected_cnt = 0;
+    
+    switch(filter_get_kernel()) {
+#ifdef FILTER_X86
+        case FILTER_AVX2:
+            kernel_avx2(cols, 0, task_cnt, after, before, min_importance,
+                        bitmap);
+            break;
+        case FILTER_SSE4:
+            kernel_sse4(cols, 0, task_cnt, after, before, min_importance,
+                        bitmap);
+            break;
+#endif
+        default:
+            kernel_scalar(cols, 0, task_cnt, after, before, min_importance,
+                          bitmap);
+            break;
+    }
+    
+    for(long int w = 0; w < BITMAP_WORDS(task_cnt); w++)
+        for(uint64_t word = bitmap[w]; word; word &= word - 1)
+            selected_cnt++;
+    
+    return selected_cnt;
+}
+
+
+/**
+ * Find the next selected slot of a bitmap.
+ * @param bitmap the selection.
+ * @param bit_cnt number of slots in the bitmap.
+ * @param from first slot to check.
+ * @return next selected slot from the given one on, -1 if there is none.
+ */
+
+long int filter_next(const uint64_t *bitmap, long int bit_cnt, long int from) {
+    long int w = from/64;
+    uint64_t word;
+    
+    if(from < 0 || from >= bit_cnt) return UNSUCCESSFUL;
+    
+    word = bitmap[w] & (~(uint64_t)0 << from%64);
+    while(word == 0) {
+        if(++w >= BITMAP_WORDS(bit_cnt)) return UNSUCCESSFUL;
+        word = bitmap[w];
+    }
+    
+#ifdef __GNUC__
+    return w*64 + __builtin_ctzll(word);
+#else
+    for(int b = 0; ; b++)
+        if(word >> b & 1) return w*64 + b;
+#endif
+}
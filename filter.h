@@ -0,0 +1,44 @@
+/**
+ * Vectorized filters over the store's columns.
+ * A filter selects the active tasks starting in a time range and rated at
+ * least some importance, writing one bit per slot into a selection bitmap.
+ * AVX2 and SSE4.2 kernels are used when the processor supports them,
+ * checked once at run time; a scalar kernel is used otherwise.
+ */
+
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <stdint.h>
+
+#include "columns.h"
+
+// ---------------------------------------------------------------------------
+// Module constants
+
+/**
+ * Number of 64-bit words of a bitmap holding n bits.
+ */
+#define BITMAP_WORDS(n) (((n) + 63)/64)
+
+/**
+ * Kernels, from slowest to fastest.
+ */
+#define FILTER_SCALAR 0
+#define FILTER_SSE4 1
+#define FILTER_AVX2 2
+
+// ---------------------------------------------------------------------------
+// Functions Prototypes
+
+int filter_use_kernel(int kernel);
+int filter_get_kernel(void);
+long int filter_upcoming(const TaskColumns *cols,
+                         long int task_cnt,
+                         int64_t after,
+                         int64_t before,
+                         uint8_t min_importance,
+                         uint64_t *bitmap);
+long int filter_next(const uint64_t *bitmap, long int bit_cnt, long int from);
+
+#endif
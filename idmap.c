@@ -0,0 +1,297 @@
+#include "idmap.h"
+
+#include <stdlib.h>
+
+#define IDMAP_MIN_CAP 64
+
+// ---------------------------------------------------------------------------
+// Helpers
+
+/**
+ * Spread a key over the bits of a table position, IDs being sequential.
+ */
+
+static long int home(const IdMap *map, uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDull;
+    key ^= key >> 33;
+    return (long int)(key & (uint64_t)(map->cap - 1));
+}
+
+
+/**
+ * Check whether an entry at position j, which belongs at position k, may
+ * fill the hole at position i: k must not lie cyclically in (i, j].
+ */
+
+static int may_fill(long int i, long int j, long int k) {
+    return i <= j ? k <= i || k > j : k <= i && k > j;
+}
+
+
+/**
+ * Add a task to both tables, which have room for it.
+ */
+
+static void insert(IdMap *map, uint64_t id, uint64_t hash, long int slot) {
+    long int mask = map->cap - 1;
+    long int i;
+    
+    for(i = home(map, id); map->ids[i].id != 0; i = (i + 1) & mask);
+    map->ids[i].id = id;
+    map->ids[i].slot = slot;
+    for(i = home(map, hash); map->names[i].slot >= 0; i = (i + 1) & mask);
+    map->names[i].hash = hash;
+    map->names[i].slot = slot;
+    map->cnt++;
+}
+
+
+/**
+ * Remove a task from both tables, shifting the entries probed past it back.
+ */
+
+static void erase(IdMap *map, uint64_t id, uint64_t hash, long int slot) {
+    long int mask = map->cap - 1;
+    long int i, j;
+    
+    for(i = home(map, id); map->ids[i].id != 0; i = (i + 1) & mask)
+        if(map->ids[i].id == id && map->ids[i].slot == slot) break;
+    if(map->ids[i].id == 0) return; // not there
+    for(j = (i + 1) & mask; map->ids[j].id != 0; j = (j + 1) & mask)
+        if(may_fill(i, j, home(map, map->ids[j].id))) {
+            map->ids[i] = map->ids[j];
+            i = j;
+        }
+    map->ids[i].id = 0;
+    
+    for(i = home(map, hash); map->names[i].slot >= 0; i = (i + 1) & mask)
+        if(map->names[i].slot == slot) break;
+    if(map->names[i].slot < 0) return; // not there
+    for(j = (i + 1) & mask; map->names[j].slot >= 0; j = (j + 1) & mask)
+        if(may_fill(i, j, home(map, map->names[j].hash))) {
+            map->names[i] = map->names[j];
+            i = j;
+        }
+    map->names[i].slot = -1;
+    map->cnt--;
+}
+
+
+/**
+ * Resize both tables to a number of entries, moving the tasks over.
+ * @param cap new number of entries, a power of 2 above twice the tasks.
+ * @return 0 if successful, else -1.
+ */
+
+static int rehash(IdMap *map, long int cap) {
+    IdMapEntry *ids = (IdMapEntry *)malloc(cap*sizeof(IdMapEntry));
+    NameMapEntry *names = (NameMapEntry *)malloc(cap*sizeof(NameMapEntry));
+    IdMapEntry *old_ids = map->ids;
+    long int old_cap = map->cap;
+    
+    if(ids == NULL || names == NULL) {
+        free(ids);
+        free(names);
+        return UNSUCCESSFUL;
+    }
+    for(long int i = 0; i < cap; i++) {
+        ids[i].id = 0;
+        names[i].slot = -1;
+    }
+    
+    free(map->names);
+    map->ids = ids;
+    map->names = names;
+    map->cap = cap;
+    map->cnt = 0;
+    for(long int i = 0; i < old_cap; i++)
+        if(old_ids[i].id != 0)
+            insert(map, old_ids[i].id, map->slot_hashes[old_ids[i].slot],
+                   old_ids[i].slot);
+    free(old_ids);
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Make room in the mirrored IDs and name hashes for a number of slots.
+ * @return 0 if successful, else -1.
+ */
+
+static int reserve_slots(IdMap *map, long int slot_cnt) {
+    long int new_cap;
+    uint64_t *column;
+    
+    if(slot_cnt <= map->slot_cap) return SUCCESSFUL;
+    
+    new_cap = map->slot_cap ? map->slot_cap : IDMAP_MIN_CAP;
+    while(new_cap < slot_cnt) new_cap *= 2;
+    
+    column = realloc(map->slot_ids, new_cap*sizeof(uint64_t));
+    if(column == NULL) return UNSUCCESSFUL;
+    map->slot_ids = column;
+    column = realloc(map->slot_hashes, new_cap*sizeof(uint64_t));
+    if(column == NULL) return UNSUCCESSFUL;
+    map->slot_hashes = column;
+    for(long int i = map->slot_cap; i < new_cap; i++)
+        map->slot_ids[i] = 0;
+    map->slot_cap = new_cap;
+    
+    return SUCCESSFUL;
+}
+
+// ---------------------------------------------------------------------------
+// IdMap functions
+
+/**
+ * Initialize an empty map.
+ * @param map map to initialize.
+ */
+
+void idmap_init(IdMap *map) {
+    memset(map, 0, sizeof(IdMap));
+}
+
+
+/**
+ * Free the memory held by a map.
+ * @param map map to free.
+ */
+
+void idmap_free(IdMap *map) {
+    free(map->ids);
+    free(map->names);
+    free(map->slot_ids);
+    free(map->slot_hashes);
+    idmap_init(map);
+}
+
+
+/**
+ * Fill an empty map with the live tasks of a data file.
+ * @param map map to fill.
+ * @param tasks records of the data file.
+ * @param task_cnt number of records of the data file.
+ * @return 0 if successful, else -1.
+ */
+
+int idmap_build(IdMap *map, const Task *tasks, long int task_cnt) {
+    long int cap = IDMAP_MIN_CAP;
+    
+    while(cap < 2*task_cnt) cap *= 2;
+    if(reserve_slots(map, task_cnt) == UNSUCCESSFUL
+       || rehash(map, cap) == UNSUCCESSFUL)
+        return UNSUCCESSFUL;
+    
+    for(long int i = 0; i < task_cnt; i++)
+        if(idmap_set(map, i, tasks + i) == UNSUCCESSFUL) return UNSUCCESSFUL;
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Update a map for a slot which has just been written: its previous task
+ * is removed, the new one added unless it is deleted or has no ID.
+ * @param map map to update.
+ * @param slot slot written.
+ * @param task the slot's new record.
+ * @return 0 if successful, else -1.
+ */
+
+int idmap_set(IdMap *map, long int slot, const Task *task) {
+    uint64_t hash = idmap_hash_name(task->t_name);
+    
+    if(reserve_slots(map, slot + 1) == UNSUCCESSFUL) return UNSUCCESSFUL;
+    
+    // Tasks only moved in time, as most writes do, are where they were:
+    if(map->slot_ids[slot] == task->t_id && map->slot_hashes[slot] == hash
+       && !(task->flags & FLAG_DELETED))
+        return SUCCESSFUL;
+    
+    if(map->slot_ids[slot] != 0) {
+        erase(map, map->slot_ids[slot], map->slot_hashes[slot], slot);
+        map->slot_ids[slot] = 0;
+    }
+    if(task->flags & FLAG_DELETED || task->t_id == 0) return SUCCESSFUL;
+    
+    if(2*(map->cnt + 1) > map->cap
+       && rehash(map, map->cap ? 2*map->cap : IDMAP_MIN_CAP) == UNSUCCESSFUL)
+        return UNSUCCESSFUL;
+    map->slot_ids[slot] = task->t_id;
+    map->slot_hashes[slot] = hash;
+    insert(map, task->t_id, map->slot_hashes[slot], slot);
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Find the slot of a task from its ID.
+ * @param map map to search.
+ * @param id ID of the task.
+ * @return slot of the task, -1 if there is no such task.
+ */
+
+long int idmap_find(const IdMap *map, uint64_t id) {
+    long int mask = map->cap - 1;
+    
+    if(map->cap == 0 || id == 0) return UNSUCCESSFUL;
+    for(long int i = home(map, id); map->ids[i].id != 0; i = (i + 1) & mask)
+        if(map->ids[i].id == id) return map->ids[i].slot;
+    
+    return UNSUCCESSFUL;
+}
+
+
+/**
+ * Find the slots of the tasks named exactly so, in no particular order.
+ * @param map map to search.
+ * @param tasks records of the data file, to tell names sharing a hash
+ *        apart.
+ * @param name name in question.
+ * @param slots place-holder for the slots found, room for max_cnt.
+ * @param max_cnt most slots to write.
+ * @return number of such tasks, which may exceed max_cnt.
+ */
+
+int idmap_find_name(const IdMap *map,
+                    const Task *tasks,
+                    const char *name,
+                    long int *slots,
+                    int max_cnt) {
+    uint64_t hash = idmap_hash_name(name);
+    long int mask = map->cap - 1;
+    int found_cnt = 0;
+    
+    if(map->cap == 0) return 0;
+    for(long int i = home(map, hash); map->names[i].slot >= 0;
+        i = (i + 1) & mask) {
+        long int slot = map->names[i].slot;
+        if(map->names[i].hash != hash
+           || strncmp(tasks[slot].t_name, name, TASK_NAME_MAXLEN) != 0)
+            continue;
+        if(found_cnt < max_cnt) slots[found_cnt] = slot;
+        found_cnt++;
+    }
+    
+    return found_cnt;
+}
+
+
+/**
+ * Hash a task name, FNV-1a over its characters.
+ * @param name name to hash, at most TASK_NAME_MAXLEN characters are read.
+ * @return the hash.
+ */
+
+uint64_t idmap_hash_name(const char *name) {
+    uint64_t hash = 14695981039346656037ull;
+    
+    for(int i = 0; i < TASK_NAME_MAXLEN && name[i]; i++)
+        hash = (hash ^ (uint8_t)name[i])*1099511628211ull;
+    
+    return hash;
+}
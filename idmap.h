@@ -0,0 +1,56 @@
+/**
+ * Hash indexes of a store's tasks by ID and by name.
+ * Both are open-addressing tables with linear probing, kept at most half
+ * full so a lookup probes O(1) entries on average. Removed entries are
+ * filled by shifting the following ones back, so no tombstones build up.
+ * Tasks with the same name share a name hash and are found by probing past
+ * each other. Each slot's ID and name hash are mirrored, so its entries can
+ * be found once its record has been overwritten.
+ */
+
+#ifndef IDMAP_H
+#define IDMAP_H
+
+#include <stdint.h>
+
+#include "task.h"
+
+// ---------------------------------------------------------------------------
+// IdMap struct
+
+typedef struct {
+    uint64_t id; // task's ID, 0 for empty entries
+    int64_t slot; // task's position in the data file
+} IdMapEntry;
+
+typedef struct {
+    uint64_t hash; // hash of the task's name
+    int64_t slot; // task's position in the data file, -1 for empty entries
+} NameMapEntry;
+
+typedef struct {
+    IdMapEntry *ids; // tasks by ID
+    NameMapEntry *names; // tasks by name hash
+    long int cap; // entries of each table, a power of 2
+    long int cnt; // number of tasks in the tables
+    uint64_t *slot_ids; // ID of each slot in the tables, 0 if none
+    uint64_t *slot_hashes; // name hash of each slot in the tables
+    long int slot_cap; // capacity of slot_ids and slot_hashes
+} IdMap;
+
+// ---------------------------------------------------------------------------
+// Functions Prototypes
+
+void idmap_init(IdMap *map);
+void idmap_free(IdMap *map);
+int idmap_build(IdMap *map, const Task *tasks, long int task_cnt);
+int idmap_set(IdMap *map, long int slot, const Task *task);
+long int idmap_find(const IdMap *map, uint64_t id);
+int idmap_find_name(const IdMap *map,
+                    const Task *tasks,
+                    const char *name,
+                    long int *slots,
+                    int max_cnt);
+uint64_t idmap_hash_name(const char *name);
+
+#endif
@@ -0,0 +1,326 @@
+#include "index.h"
+
+#include <stdlib.h>
+
+// ---------------------------------------------------------------------------
+// Helpers
+
+/**
+ * Point header and entries into the index file's mapping.
+ * @param idx index whose file has just been (re)mapped.
+ */
+
+static void attach(TaskIndex *idx) {
+    idx->header = (IndexHeader *)idx->file.data;
+    idx->entries = idx->header ? (IndexEntry *)(idx->header + 1) : NULL;
+}
+
+
+/**
+ * Resize the index file to hold a number of entries.
+ * @param idx index to resize.
+ * @param entry_cnt number of entries after resizing.
+ * @return 0 if successful, else -1.
+ */
+
+static int resize(TaskIndex *idx, long int entry_cnt) {
+    if(mapfile_resize(&idx->file,
+                      sizeof(IndexHeader) + entry_cnt*sizeof(IndexEntry))
+       == UNSUCCESSFUL) {
+        attach(idx);
+        return UNSUCCESSFUL;
+    }
+    attach(idx);
+    idx->header->entry_cnt = entry_cnt;
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Order entries by start time, then by position in the data file.
+ */
+
+static int compare_entries(const void *a, const void *b) {
+    const IndexEntry *ea = (const IndexEntry *)a;
+    const IndexEntry *eb = (const IndexEntry *)b;
+    
+    if(ea->t_time != eb->t_time) return ea->t_time < eb->t_time ? -1 : 1;
+    if(ea->slot != eb->slot) return ea->slot < eb->slot ? -1 : 1;
+    return 0;
+}
+
+
+/**
+ * Binary search for the first entry not ordered before a given entry.
+ * @param idx index to search.
+ * @param entry entry to look for.
+ * @return position of the first entry >= entry, entry_cnt if none.
+ */
+
+static long int find_position(const TaskIndex *idx, const IndexEntry *entry) {
+    long int low = 0;
+    long int high = idx->header->entry_cnt;
+    
+    while(low < high) {
+        long int mid = low + (high - low)/2;
+        if(compare_entries(idx->entries + mid, entry) < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    
+    return low;
+}
+
+// ---------------------------------------------------------------------------
+// Index functions
+
+/**
+ * Open the index of a data file, rebuild it if it is missing or stale.
+ * Read-only indexes cannot be rebuilt, opening them fails instead.
+ * @param idx place-holder for the opened index.
+ * @param file_name name of the data file (not of the index itself).
+ * @param tasks records of the data file.
+ * @param task_cnt number of records of the data file.
+ * @param engine INDEX_ARRAY or INDEX_BTREE.
+ * @param writable 0 to map the index read-only, else read-write.
+ * @return 0 if successful, else -1.
+ */
+
+int index_open(TaskIndex *idx,
+               const char *file_name,
+               const Task *tasks,
+               long int task_cnt,
+               int engine,
+               int writable) {
+    char *idx_file_name;
+    int result;
+    
+    memset(idx, 0, sizeof(TaskIndex));
+    mapfile_clear(&idx->file);
+    idx->engine = engine;
+    idx_file_name = datafilename2sidecar(file_name, engine == INDEX_BTREE
+                                                    ? BTREE_POSTFIX
+                                                    : INDEX_POSTFIX);
+    if(engine == INDEX_BTREE)
+        result = btree_open(&idx->tree, idx_file_name, writable);
+    else
+        result = mapfile_open(&idx->file, idx_file_name, writable);
+    free(idx_file_name);
+    if(result == UNSUCCESSFUL) return UNSUCCESSFUL;
+    attach(idx);
+    
+    // Trust the file only if it was synced with the same data file:
+    if(engine == INDEX_BTREE
+       ? idx->tree.meta.task_cnt != task_cnt
+       : idx->file.size < sizeof(IndexHeader)
+         || idx->header->task_cnt != task_cnt
+         || idx->file.size != sizeof(IndexHeader)
+                              + idx->header->entry_cnt*sizeof(IndexEntry)) {
+        if(!writable) {
+            index_close(idx);
+            return UNSUCCESSFUL;
+        }
+        return index_rebuild(idx, tasks, task_cnt);
+    }
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Unmap and close an index.
+ * @param idx index to close.
+ */
+
+void index_close(TaskIndex *idx) {
+    if(idx->engine == INDEX_BTREE)
+        btree_close(&idx->tree);
+    else
+        mapfile_close(&idx->file);
+    attach(idx);
+}
+
+
+/**
+ * Flush an index to disk.
+ * @param idx index to sync.
+ * @return 0 if successful, else -1.
+ */
+
+int index_sync(TaskIndex *idx) {
+    if(idx->engine == INDEX_BTREE) return btree_sync(&idx->tree);
+    return mapfile_sync(&idx->file);
+}
+
+
+/**
+ * Rebuild an index from all active tasks of a data file.
+ * @param idx index to rebuild.
+ * @param tasks records of the data file.
+ * @param task_cnt number of records of the data file.
+ * @return 0 if successful, else -1.
+ */
+
+int index_rebuild(TaskIndex *idx, const Task *tasks, long int task_cnt) {
+    IndexEntry *entries;
+    long int entry_cnt = 0;
+    int result;
+    
+    for(long int i = 0; i < task_cnt; i++)
+        if(tasks[i].flags & FLAG_ACTIVE) entry_cnt++;
+    
+    // The B+-tree is bulk-loaded from the entries sorted aside:
+    if(idx->engine == INDEX_BTREE) {
+        entries = (IndexEntry *)malloc((entry_cnt ? entry_cnt : 1)
+                                       *sizeof(IndexEntry));
+        if(entries == NULL) return UNSUCCESSFUL;
+    }
+    else {
+        if(resize(idx, entry_cnt) == UNSUCCESSFUL) return UNSUCCESSFUL;
+        entries = idx->entries;
+    }
+    
+    entry_cnt = 0;
+    for(long int i = 0; i < task_cnt; i++)
+        if(tasks[i].flags & FLAG_ACTIVE) {
+            entries[entry_cnt].t_time = tasks[i].t_time;
+            entries[entry_cnt].slot = i;
+            entry_cnt++;
+        }
+    qsort(entries, entry_cnt, sizeof(IndexEntry), compare_entries);
+    
+    if(idx->engine == INDEX_BTREE) {
+        result = btree_build(&idx->tree, entries, entry_cnt, task_cnt);
+        free(entries);
+        return result;
+    }
+    idx->header->task_cnt = task_cnt;
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Add a task which has just been added to the data file.
+ * @param idx index to insert into.
+ * @param task the new task, ignored if it is not active.
+ * @param slot position of the task in the data file.
+ * @param task_cnt number of records of the data file.
+ * @return 0 if successful, else -1.
+ */
+
+int index_insert(TaskIndex *idx,
+                 const Task *task,
+                 long int slot,
+                 long int task_cnt) {
+    IndexEntry entry;
+    long int entry_cnt;
+    long int pos;
+    
+    entry.t_time = task->t_time;
+    entry.slot = slot;
+    if(idx->engine == INDEX_BTREE) {
+        idx->tree.meta.task_cnt = task_cnt;
+        return task->flags & FLAG_ACTIVE ? btree_insert(&idx->tree, &entry)
+                                         : SUCCESSFUL;
+    }
+    
+    if(task->flags & FLAG_ACTIVE) {
+        entry_cnt = idx->header->entry_cnt;
+        pos = find_position(idx, &entry);
+        
+        if(resize(idx, entry_cnt + 1) == UNSUCCESSFUL) return UNSUCCESSFUL;
+        memmove(idx->entries + pos + 1,
+                idx->entries + pos,
+                (entry_cnt - pos)*sizeof(IndexEntry));
+        idx->entries[pos] = entry;
+    }
+    idx->header->task_cnt = task_cnt;
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Drop a task which is being deleted from the data file.
+ * @param idx index to remove from.
+ * @param task the deleted task, as it is still in the index.
+ * @param slot position of the task in the data file.
+ * @param task_cnt number of records of the data file.
+ * @return 0 if successful, else -1.
+ */
+
+int index_remove(TaskIndex *idx,
+                 const Task *task,
+                 long int slot,
+                 long int task_cnt) {
+    IndexEntry entry;
+    long int entry_cnt;
+    long int pos;
+    
+    entry.t_time = task->t_time;
+    entry.slot = slot;
+    if(idx->engine == INDEX_BTREE) {
+        idx->tree.meta.task_cnt = task_cnt;
+        return btree_remove(&idx->tree, &entry);
+    }
+    
+    entry_cnt = idx->header->entry_cnt;
+    pos = find_position(idx, &entry);
+    
+    if(pos < entry_cnt && compare_entries(idx->entries + pos, &entry) == 0) {
+        memmove(idx->entries + pos,
+                idx->entries + pos + 1,
+                (entry_cnt - pos - 1)*sizeof(IndexEntry));
+        if(resize(idx, entry_cnt - 1) == UNSUCCESSFUL) return UNSUCCESSFUL;
+    }
+    idx->header->task_cnt = task_cnt;
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Position a cursor on the first task starting at or after a given time.
+ * @param idx index to search.
+ * @param t time in question.
+ * @param cursor place-holder for the cursor, past the last task if none.
+ */
+
+void index_seek(const TaskIndex *idx, time_t t, IndexCursor *cursor) {
+    IndexEntry entry;
+    
+    entry.t_time = t;
+    entry.slot = INT64_MIN;
+    cursor->idx = idx;
+    cursor->pos = 0;
+    cursor->leaf.page = 0;
+    cursor->leaf.pos = 0;
+    
+    if(idx->engine == INDEX_BTREE)
+        btree_seek(&idx->tree, &entry, &cursor->leaf);
+    else
+        cursor->pos = find_position(idx, &entry);
+}
+
+
+/**
+ * Read the entry under a cursor and move it to the next one, in order of
+ * start time.
+ * @param cursor cursor to move.
+ * @param entry place-holder for the entry read.
+ * @return 1 if an entry was read, 0 past the last one.
+ */
+
+int index_next(IndexCursor *cursor, IndexEntry *entry) {
+    const TaskIndex *idx = cursor->idx;
+    
+    if(idx->engine == INDEX_BTREE)
+        return btree_next(&idx->tree, &cursor->leaf, entry);
+    if(cursor->pos >= idx->header->entry_cnt) return 0;
+    *entry = idx->entries[cursor->pos++];
+    
+    return 1;
+}
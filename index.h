@@ -0,0 +1,82 @@
+/**
+ * Time-ordered index of active tasks.
+ * Kept in a sidecar file next to the data file by one of two engines: a
+ * sorted array mapped like the data file itself, e.g. "user_idx.dat", or a
+ * B+-tree, e.g. "user_bpt.dat". Entries are sorted by start time so the
+ * next task is a search and current tasks are a bounded range scan. The
+ * array is the fastest to scan, the B+-tree keeps adding and deleting tasks
+ * O(log n) when there are many of them.
+ */
+
+#ifndef INDEX_H
+#define INDEX_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include "task.h"
+#include "mapfile.h"
+#include "btree.h"
+
+// ---------------------------------------------------------------------------
+// Module constants
+
+#define INDEX_POSTFIX "_idx"
+#define BTREE_POSTFIX "_bpt"
+
+#define INDEX_ARRAY 0 /* sorted array engine */
+#define INDEX_BTREE 1 /* B+-tree engine */
+
+/**
+ * Longest possible task, current tasks started at most this long ago.
+ */
+#define MAX_DURATION_SECS ((time_t)UINT16_MAX*SECS_PER_MIN)
+
+// ---------------------------------------------------------------------------
+// Index structs
+
+typedef struct {
+    int64_t task_cnt; // number of tasks in the data file when last synced
+    int64_t entry_cnt; // number of entries following the header
+} IndexHeader;
+
+typedef BTreeKey IndexEntry; // a task's start time and slot
+
+typedef struct {
+    int engine; // INDEX_ARRAY or INDEX_BTREE
+    MappedFile file; // array engine only
+    IndexHeader *header; // start of the mapping
+    IndexEntry *entries; // sorted by (t_time, slot)
+    BTree tree; // B+-tree engine only
+} TaskIndex;
+
+typedef struct {
+    const TaskIndex *idx; // index iterated
+    long int pos; // next entry, array engine only
+    BTreeCursor leaf; // next entry, B+-tree engine only
+} IndexCursor;
+
+// ---------------------------------------------------------------------------
+// Functions Prototypes
+
+int index_open(TaskIndex *idx,
+               const char *file_name,
+               const Task *tasks,
+               long int task_cnt,
+               int engine,
+               int writable);
+void index_close(TaskIndex *idx);
+int index_rebuild(TaskIndex *idx, const Task *tasks, long int task_cnt);
+int index_insert(TaskIndex *idx,
+                 const Task *task,
+                 long int slot,
+                 long int task_cnt);
+int index_remove(TaskIndex *idx,
+                 const Task *task,
+                 long int slot,
+                 long int task_cnt);
+int index_sync(TaskIndex *idx);
+void index_seek(const TaskIndex *idx, time_t t, IndexCursor *cursor);
+int index_next(IndexCursor *cursor, IndexEntry *entry);
+
+#endif
@@ -0,0 +1,190 @@
+#include "itree.h"
+
+#include <stdlib.h>
+
+// ---------------------------------------------------------------------------
+// Helpers
+
+/**
+ * Next pseudo-random node priority (xorshift32).
+ */
+
+static uint32_t next_priority(IntervalTree *tree) {
+    uint32_t x = tree->seed;
+    
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    tree->seed = x;
+    
+    return x;
+}
+
+
+/**
+ * Recompute a node's max_high from itself and its children.
+ */
+
+static void update_max(IntervalTree *tree, int32_t n) {
+    IntervalNode *node = tree->nodes + n;
+    
+    node->max_high = node->high;
+    if(node->left >= 0 && tree->nodes[node->left].max_high > node->max_high)
+        node->max_high = tree->nodes[node->left].max_high;
+    if(node->right >= 0 && tree->nodes[node->right].max_high > node->max_high)
+        node->max_high = tree->nodes[node->right].max_high;
+}
+
+
+/**
+ * Insert an allocated node into the subtree rooted at n, ordered by low.
+ * @return new root of the subtree.
+ */
+
+static int32_t insert_node(IntervalTree *tree, int32_t n, int32_t new_node) {
+    IntervalNode *nodes = tree->nodes;
+    int32_t child;
+    
+    if(n < 0) return new_node;
+    
+    if(nodes[new_node].low < nodes[n].low) {
+        child = insert_node(tree, nodes[n].left, new_node);
+        nodes[n].left = child;
+        if(nodes[child].priority > nodes[n].priority) { // rotate right
+            nodes[n].left = nodes[child].right;
+            nodes[child].right = n;
+            update_max(tree, n);
+            n = child;
+        }
+    } else {
+        child = insert_node(tree, nodes[n].right, new_node);
+        nodes[n].right = child;
+        if(nodes[child].priority > nodes[n].priority) { // rotate left
+            nodes[n].right = nodes[child].left;
+            nodes[child].left = n;
+            update_max(tree, n);
+            n = child;
+        }
+    }
+    update_max(tree, n);
+    
+    return n;
+}
+
+
+/**
+ * Collect intervals of the subtree rooted at n overlapping [low, high).
+ * @return number of overlapping intervals, including those not stored.
+ */
+
+static long int query_node(const IntervalTree *tree,
+                           int32_t n,
+                           int64_t low,
+                           int64_t high,
+                           int64_t *slots,
+                           long int max_slots,
+                           long int found_cnt) {
+    const IntervalNode *node;
+    
+    // Walk down the right spine iteratively, recurse on the left:
+    while(n >= 0) {
+        node = tree->nodes + n;
+        if(node->max_high <= low) break; // everything here ends too early
+        
+        found_cnt = query_node(tree, node->left, low, high,
+                               slots, max_slots, found_cnt);
+        if(node->low >= high) break; // this and the right start too late
+        
+        if(low < node->high) {
+            if(found_cnt < max_slots) slots[found_cnt] = node->slot;
+            found_cnt++;
+        }
+        n = node->right;
+    }
+    
+    return found_cnt;
+}
+
+// ---------------------------------------------------------------------------
+// Interval tree functions
+
+/**
+ * Make an empty tree.
+ * @param tree tree to initialize.
+ */
+
+void itree_init(IntervalTree *tree) {
+    tree->nodes = NULL;
+    tree->node_cnt = 0;
+    tree->node_cap = 0;
+    tree->root = -1;
+    tree->seed = 2463534242u;
+}
+
+
+/**
+ * Release all nodes of a tree, leaving it empty.
+ * @param tree tree to free.
+ */
+
+void itree_free(IntervalTree *tree) {
+    free(tree->nodes);
+    itree_init(tree);
+}
+
+
+/**
+ * Add an interval to a tree.
+ * @param tree tree to insert into.
+ * @param low start of the interval.
+ * @param high end of the interval, excluded.
+ * @param slot position of the interval's task in the data file.
+ * @return 0 if successful, else -1.
+ */
+
+int itree_insert(IntervalTree *tree, int64_t low, int64_t high, int64_t slot) {
+    IntervalNode *node;
+    
+    if(tree->node_cnt == tree->node_cap) {
+        long int new_cap = tree->node_cap ? 2*tree->node_cap : 64;
+        IntervalNode *nodes;
+        
+        if(new_cap > INT32_MAX) return UNSUCCESSFUL;
+        nodes = realloc(tree->nodes, new_cap*sizeof(IntervalNode));
+        if(nodes == NULL) return UNSUCCESSFUL;
+        tree->nodes = nodes;
+        tree->node_cap = new_cap;
+    }
+    
+    node = tree->nodes + tree->node_cnt;
+    node->low = low;
+    node->high = high;
+    node->max_high = high;
+    node->slot = slot;
+    node->left = -1;
+    node->right = -1;
+    node->priority = next_priority(tree);
+    
+    tree->root = insert_node(tree, tree->root, (int32_t)tree->node_cnt++);
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Find the intervals of a tree overlapping [low, high).
+ * @param tree tree to search.
+ * @param low start of the query.
+ * @param high end of the query, excluded.
+ * @param slots place-holder for the slots of overlapping intervals.
+ * @param max_slots capacity of slots, further overlaps are only counted.
+ * @return number of overlapping intervals.
+ */
+
+long int itree_overlaps(const IntervalTree *tree,
+                        int64_t low,
+                        int64_t high,
+                        int64_t *slots,
+                        long int max_slots) {
+    return query_node(tree, tree->root, low, high, slots, max_slots, 0);
+}
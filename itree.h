@@ -0,0 +1,50 @@
+/**
+ * Interval tree.
+ * Treap of half-open intervals [low, high), each node augmented with the
+ * largest high of its subtree. Insertion is O(log n) expected, finding the
+ * k intervals overlapping a query is O(log n + k).
+ */
+
+#ifndef ITREE_H
+#define ITREE_H
+
+#include <stdint.h>
+
+#include "utils.h"
+
+// ---------------------------------------------------------------------------
+// IntervalTree struct
+// Nodes live in one growing array and link to each other by position, so
+// the whole tree is freed at once and survives reallocation.
+
+typedef struct {
+    int64_t low; // start of the interval
+    int64_t high; // end of the interval, excluded
+    int64_t max_high; // largest high in this subtree
+    int64_t slot; // position of the interval's task in the data file
+    int32_t left; // left child, -1 if none
+    int32_t right; // right child, -1 if none
+    uint32_t priority; // heap key keeping the treap balanced
+} IntervalNode;
+
+typedef struct {
+    IntervalNode *nodes;
+    long int node_cnt;
+    long int node_cap;
+    int32_t root; // -1 if the tree is empty
+    uint32_t seed; // state of the priority generator
+} IntervalTree;
+
+// ---------------------------------------------------------------------------
+// Functions Prototypes
+
+void itree_init(IntervalTree *tree);
+void itree_free(IntervalTree *tree);
+int itree_insert(IntervalTree *tree, int64_t low, int64_t high, int64_t slot);
+long int itree_overlaps(const IntervalTree *tree,
+                        int64_t low,
+                        int64_t high,
+                        int64_t *slots,
+                        long int max_slots);
+
+#endif
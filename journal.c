@@ -0,0 +1,202 @@
+#include "journal.h"
+#include "mapfile.h"
+
+#include <stdlib.h>
+
+#define REPLAY_BATCH_SIZE 64
+
+// ---------------------------------------------------------------------------
+// Helpers
+
+/**
+ * Checksum of a journal record.
+ */
+
+static uint32_t checksum(const JournalRecord *record) {
+    return journal_checksum(record->slot, &record->task, sizeof(Task));
+}
+
+// ---------------------------------------------------------------------------
+// Journal functions
+
+/**
+ * Open the journal of a data file, creating it if needed. Records left in
+ * it are kept, to be replayed.
+ * @param journal place-holder for the opened journal.
+ * @param data_file_name name of the data file.
+ * @return 0 if successful, else -1.
+ */
+
+int journal_open(Journal *journal, const char *data_file_name) {
+    memset(journal, 0, sizeof(Journal));
+    
+    journal->file_name = datafilename2sidecar(data_file_name,
+                                              JOURNAL_POSTFIX);
+    journal->fp = fopen(journal->file_name, "ab+");
+    if(journal->fp == NULL) {
+        free(journal->file_name);
+        journal->file_name = NULL;
+        return UNSUCCESSFUL;
+    }
+    
+    fseek(journal->fp, 0, SEEK_END);
+    journal->record_cnt = ftell(journal->fp)/sizeof(JournalRecord);
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Count the records left in the journal of a data file, without opening
+ * it for writing.
+ * @param data_file_name name of the data file.
+ * @return number of records, 0 if there is no journal.
+ */
+
+long int journal_pending(const char *data_file_name) {
+    char *file_name = datafilename2sidecar(data_file_name, JOURNAL_POSTFIX);
+    FILE *fp = fopen(file_name, "rb");
+    long int record_cnt = 0;
+    
+    free(file_name);
+    if(fp == NULL) return 0;
+    if(fseek(fp, 0, SEEK_END) == 0)
+        record_cnt = ftell(fp)/sizeof(JournalRecord);
+    fclose(fp);
+    
+    return record_cnt;
+}
+
+
+/**
+ * Flush and close a journal, its records are kept.
+ * @param journal journal to close.
+ */
+
+void journal_close(Journal *journal) {
+    if(journal->fp != NULL) {
+        journal_commit(journal);
+        fclose(journal->fp);
+    }
+    free(journal->file_name);
+    memset(journal, 0, sizeof(Journal));
+}
+
+
+/**
+ * Append the new contents of a slot to a journal. The record is only
+ * durable once journal_commit has flushed it to disk.
+ * @param journal journal to append to.
+ * @param slot slot written.
+ * @param task new contents of the slot.
+ * @return 0 if successful, else -1.
+ */
+
+int journal_append(Journal *journal, long int slot, const Task *task) {
+    JournalRecord record;
+    
+    memset(&record, 0, sizeof(JournalRecord));
+    record.slot = slot;
+    record.task = *task;
+    record.checksum = checksum(&record);
+    
+    if(fwrite(&record, sizeof(JournalRecord), 1, journal->fp) != 1)
+        return UNSUCCESSFUL;
+    journal->record_cnt++;
+    journal->pending_cnt++;
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Flush the records appended to a journal down to the disk.
+ * @param journal journal to flush.
+ * @return 0 if successful, else -1.
+ */
+
+int journal_commit(Journal *journal) {
+    if(journal->pending_cnt == 0) return SUCCESSFUL;
+    
+    if(mapfile_sync_stream(journal->fp) == UNSUCCESSFUL)
+        return UNSUCCESSFUL;
+    journal->pending_cnt = 0;
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Empty a journal, once the data file holds all of its records.
+ * @param journal journal to empty.
+ * @return 0 if successful, else -1.
+ */
+
+int journal_reset(Journal *journal) {
+    fclose(journal->fp);
+    journal->fp = fopen(journal->file_name, "wb"); // truncate
+    if(journal->fp != NULL) {
+        fclose(journal->fp);
+        journal->fp = fopen(journal->file_name, "ab+");
+    }
+    journal->record_cnt = 0;
+    journal->pending_cnt = 0;
+    
+    return journal->fp != NULL ? SUCCESSFUL : UNSUCCESSFUL;
+}
+
+
+/**
+ * Replay the records of a journal, in the order they were appended.
+ * Replay stops at the first incomplete or corrupted record, which was
+ * being written during a crash.
+ * @param journal journal to replay.
+ * @param apply function writing a record back, returning 0 if successful.
+ * @param context passed to apply.
+ * @return number of records replayed if successful, else -1.
+ */
+
+long int journal_replay(const Journal *journal,
+                        int (*apply)(void *, const JournalRecord *),
+                        void *context) {
+    JournalRecord records[REPLAY_BATCH_SIZE];
+    size_t read_cnt;
+    long int replay_cnt = 0;
+    
+    fseek(journal->fp, 0, SEEK_SET);
+    while((read_cnt = fread(records, sizeof(JournalRecord),
+                            REPLAY_BATCH_SIZE, journal->fp)) > 0) {
+        for(size_t i = 0; i < read_cnt; i++) {
+            if(records[i].checksum != checksum(records + i))
+                return replay_cnt;
+            if((*apply)(context, records + i) == UNSUCCESSFUL)
+                return UNSUCCESSFUL;
+            replay_cnt++;
+        }
+    }
+    
+    return replay_cnt;
+}
+
+
+/**
+ * Checksum of a journal record's slot and task, FNV-1a over their bytes.
+ * Tasks are passed with their size, so records of older versions, whose
+ * tasks were smaller, can be checked when converting their data file.
+ * @param slot slot of the record.
+ * @param task task of the record.
+ * @param task_size size of the task, in bytes.
+ * @return the checksum.
+ */
+
+uint32_t journal_checksum(int64_t slot, const void *task, size_t task_size) {
+    const uint8_t *bytes[] = {(const uint8_t *)&slot, (const uint8_t *)task};
+    const size_t sizes[] = {sizeof(slot), task_size};
+    uint32_t hash = 2166136261u;
+    
+    for(int i = 0; i < 2; i++)
+        for(size_t j = 0; j < sizes[i]; j++)
+            hash = (hash ^ bytes[i][j])*16777619u;
+    
+    return hash;
+}
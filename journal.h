@@ -0,0 +1,59 @@
+/**
+ * Write-ahead journal of a data file.
+ * Every record written to the mapped data file is first appended to a
+ * sidecar file, e.g. "user_wal.dat", as its slot and new contents, and the
+ * journal is flushed to disk before the mapping changes: the system may
+ * write mapped pages back at any time. Bulk updates append up to
+ * JOURNAL_GROUP_SIZE records per flush (group commit). The journal is
+ * emptied at checkpoints, once the data file itself has been flushed.
+ * After a crash, replaying the journal redoes every write the data file
+ * may have missed or torn; replaying twice is harmless.
+ */
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "task.h"
+
+// ---------------------------------------------------------------------------
+// Module constants
+
+#define JOURNAL_POSTFIX "_wal"
+#define JOURNAL_GROUP_SIZE 16 /* most records per flush to disk */
+#define JOURNAL_CHECKPOINT_SIZE 4096 /* records before a checkpoint */
+
+// ---------------------------------------------------------------------------
+// Journal structs
+
+typedef struct {
+    int64_t slot; // slot written
+    uint32_t checksum; // of slot and task, detects torn writes
+    uint32_t reserved; // must be zero
+    Task task; // new contents of the slot
+} JournalRecord;
+
+typedef struct {
+    char *file_name; // name of the journal file
+    FILE *fp; // opened for appending
+    long int record_cnt; // records since the last checkpoint
+    long int pending_cnt; // records not flushed to disk yet
+} Journal;
+
+// ---------------------------------------------------------------------------
+// Functions Prototypes
+
+int journal_open(Journal *journal, const char *data_file_name);
+void journal_close(Journal *journal);
+long int journal_pending(const char *data_file_name);
+int journal_append(Journal *journal, long int slot, const Task *task);
+int journal_commit(Journal *journal);
+int journal_reset(Journal *journal);
+long int journal_replay(const Journal *journal,
+                        int (*apply)(void *, const JournalRecord *),
+                        void *context);
+uint32_t journal_checksum(int64_t slot, const void *task, size_t task_size);
+
+#endif
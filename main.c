@@ -46,15 +46,17 @@ int log_in(char *usrn) {
             fp = fopen(file_name, "wb");
             if(fp == NULL) {
                 display_error("Unable to create file", "exit");
+                free(file_name);
                 return UNSUCCESSFUL;
             }
-            fclose(fp);
         } else {
             display_error("Log in cancelled", "exit");
+            free(file_name);
             return UNSUCCESSFUL;
         }
     }
     fclose(fp);
+    free(file_name);
     return SUCCESSFUL;
 }
 
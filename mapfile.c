@@ -0,0 +1,318 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "mapfile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// ---------------------------------------------------------------------------
+// Platform helpers
+
+/**
+ * Map the opened file into memory.
+ * @param mf file to be mapped.
+ * @param size current size of the file in bytes.
+ * @return 0 if successful, else -1.
+ */
+
+static int map(MappedFile *mf, size_t size) {
+    mf->data = NULL;
+    mf->size = size;
+    if(size == 0) return SUCCESSFUL; // nothing to map
+    
+#ifdef _WIN32
+    mf->h_map = CreateFileMappingA((HANDLE)mf->h_file, NULL,
+                                   mf->writable ? PAGE_READWRITE
+                                                : PAGE_READONLY,
+                                   (DWORD)((uint64_t)size>>32),
+                                   (DWORD)size, NULL);
+    if(mf->h_map == NULL) return UNSUCCESSFUL;
+    mf->data = MapViewOfFile((HANDLE)mf->h_map,
+                             mf->writable ? FILE_MAP_ALL_ACCESS
+                                          : FILE_MAP_READ,
+                             0, 0, size);
+    if(mf->data == NULL) {
+        CloseHandle((HANDLE)mf->h_map);
+        mf->h_map = NULL;
+        return UNSUCCESSFUL;
+    }
+#else
+    void *data = mmap(NULL, size,
+                      mf->writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                      MAP_SHARED, mf->fd, 0);
+    if(data == MAP_FAILED) return UNSUCCESSFUL;
+    mf->data = data;
+#endif
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Release the mapping of a file, if any.
+ * @param mf file whose mapping is to be released.
+ */
+
+static void unmap(MappedFile *mf) {
+    if(mf->data == NULL) return;
+    
+#ifdef _WIN32
+    UnmapViewOfFile(mf->data);
+    CloseHandle((HANDLE)mf->h_map);
+    mf->h_map = NULL;
+#else
+    munmap(mf->data, mf->size);
+#endif
+    
+    mf->data = NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Mapped file functions
+
+/**
+ * Mark a file as not opened, so mapfile_close does nothing. Zeroing is not
+ * enough: descriptor 0 is the standard input.
+ * @param mf file in question.
+ */
+
+void mapfile_clear(MappedFile *mf) {
+    memset(mf, 0, sizeof(MappedFile));
+#ifndef _WIN32
+    mf->fd = -1;
+#endif
+}
+
+
+/**
+ * Open a file and map it. Files opened for writing are created if needed,
+ * files opened read-only must exist and cannot be resized.
+ * @param mf place-holder for the opened file.
+ * @param file_name name of the file to open.
+ * @param writable 0 to map the file read-only, else read-write.
+ * @return 0 if successful, else -1.
+ */
+
+int mapfile_open(MappedFile *mf, const char *file_name, int writable) {
+    size_t file_size;
+    
+    mapfile_clear(mf);
+    mf->writable = writable;
+    
+#ifdef _WIN32
+    LARGE_INTEGER size;
+    HANDLE h_file = CreateFileA(file_name,
+                                writable ? GENERIC_READ | GENERIC_WRITE
+                                         : GENERIC_READ,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                                writable ? OPEN_ALWAYS : OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL, NULL);
+    if(h_file == INVALID_HANDLE_VALUE) return UNSUCCESSFUL;
+    mf->h_file = (void *)h_file;
+    if(!GetFileSizeEx(h_file, &size)) {
+        mapfile_close(mf);
+        return UNSUCCESSFUL;
+    }
+    file_size = (size_t)size.QuadPart;
+#else
+    struct stat st;
+    mf->fd = writable ? open(file_name, O_RDWR | O_CREAT, 0644)
+                      : open(file_name, O_RDONLY);
+    if(mf->fd < 0) return UNSUCCESSFUL;
+    if(fstat(mf->fd, &st) != 0) {
+        mapfile_close(mf);
+        return UNSUCCESSFUL;
+    }
+    file_size = (size_t)st.st_size;
+#endif
+    
+    if(map(mf, file_size) == UNSUCCESSFUL) {
+        mapfile_close(mf);
+        return UNSUCCESSFUL;
+    }
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Unmap and close a file, changes are written back by the OS.
+ * @param mf file to close.
+ */
+
+void mapfile_close(MappedFile *mf) {
+    unmap(mf);
+    
+#ifdef _WIN32
+    if(mf->h_file != NULL) CloseHandle((HANDLE)mf->h_file);
+    mf->h_file = NULL;
+#else
+    if(mf->fd >= 0) close(mf->fd);
+    mf->fd = -1;
+#endif
+    
+    mf->size = 0;
+}
+
+
+/**
+ * Change the file's size, then map it again.
+ * @param mf file to be resized.
+ * @param size new size of the file in bytes.
+ * @return 0 if successful, else -1.
+ */
+
+int mapfile_resize(MappedFile *mf, size_t size) {
+    if(!mf->writable) return UNSUCCESSFUL;
+    unmap(mf);
+    
+#ifdef _WIN32
+    LARGE_INTEGER new_size;
+    new_size.QuadPart = (LONGLONG)size;
+    if(!SetFilePointerEx((HANDLE)mf->h_file, new_size, NULL, FILE_BEGIN)
+       || !SetEndOfFile((HANDLE)mf->h_file))
+        return UNSUCCESSFUL;
+#else
+    if(ftruncate(mf->fd, (off_t)size) != 0)
+        return UNSUCCESSFUL;
+#endif
+    
+    return map(mf, size);
+}
+
+
+/**
+ * Flush the mapped bytes to disk.
+ * @param mf file to flush.
+ * @return 0 if successful, else -1.
+ */
+
+int mapfile_sync(MappedFile *mf) {
+    if(mf->data == NULL || !mf->writable) return SUCCESSFUL;
+    
+#ifdef _WIN32
+    if(!FlushViewOfFile(mf->data, mf->size)
+       || !FlushFileBuffers((HANDLE)mf->h_file))
+        return UNSUCCESSFUL;
+#else
+    if(msync(mf->data, mf->size, MS_SYNC) != 0) return UNSUCCESSFUL;
+#endif
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Flush a stdio stream down to the disk.
+ * @param fp stream to flush.
+ * @return 0 if successful, else -1.
+ */
+
+int mapfile_sync_stream(FILE *fp) {
+    if(fflush(fp) != 0) return UNSUCCESSFUL;
+    
+#ifdef _WIN32
+    if(_commit(_fileno(fp)) != 0) return UNSUCCESSFUL;
+#else
+    if(fsync(fileno(fp)) != 0) return UNSUCCESSFUL;
+#endif
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Lock a file, creating it if needed. Any number of shared locks may be
+ * held at once, an exclusive lock only while no other lock is.
+ * @param lock place-holder for the lock.
+ * @param file_name name of the file to lock.
+ * @param exclusive 0 for a shared lock, else an exclusive one.
+ * @param wait 0 to fail at once if the file is locked by another process,
+ *        else wait for it to be unlocked.
+ * @return 0 if successful, else -1.
+ */
+
+int mapfile_lock(FileLock *lock,
+                 const char *file_name,
+                 int exclusive,
+                 int wait) {
+#ifdef _WIN32
+    OVERLAPPED overlapped;
+    DWORD flags = 0;
+    HANDLE h_file = CreateFileA(file_name, GENERIC_READ | GENERIC_WRITE,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                                OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    lock->h_file = NULL;
+    if(h_file == INVALID_HANDLE_VALUE) return UNSUCCESSFUL;
+    
+    if(exclusive) flags |= LOCKFILE_EXCLUSIVE_LOCK;
+    if(!wait) flags |= LOCKFILE_FAIL_IMMEDIATELY;
+    memset(&overlapped, 0, sizeof(OVERLAPPED));
+    if(!LockFileEx(h_file, flags, 0, 1, 0, &overlapped)) {
+        CloseHandle(h_file);
+        return UNSUCCESSFUL;
+    }
+    lock->h_file = (void *)h_file;
+#else
+    struct flock fl;
+    int result;
+    
+    lock->fd = open(file_name, O_RDWR | O_CREAT, 0644);
+    if(lock->fd < 0) return UNSUCCESSFUL;
+    
+    memset(&fl, 0, sizeof(struct flock));
+    fl.l_type = exclusive ? F_WRLCK : F_RDLCK;
+    fl.l_whence = SEEK_SET; // l_start and l_len of 0 lock the whole file
+    do
+        result = fcntl(lock->fd, wait ? F_SETLKW : F_SETLK, &fl);
+    while(result != 0 && wait && errno == EINTR);
+    if(result != 0) {
+        close(lock->fd);
+        lock->fd = -1;
+        return UNSUCCESSFUL;
+    }
+#endif
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Mark a lock as not taken, so mapfile_unlock does nothing.
+ * @param lock lock in question.
+ */
+
+void mapfile_clear_lock(FileLock *lock) {
+#ifdef _WIN32
+    lock->h_file = NULL;
+#else
+    lock->fd = -1;
+#endif
+}
+
+
+/**
+ * Release a lock taken with mapfile_lock.
+ * @param lock lock to release, cleared by mapfile_clear_lock if never
+ *             taken.
+ */
+
+void mapfile_unlock(FileLock *lock) {
+#ifdef _WIN32
+    if(lock->h_file != NULL) CloseHandle((HANDLE)lock->h_file);
+    lock->h_file = NULL;
+#else
+    if(lock->fd >= 0) close(lock->fd); // closing releases the lock
+    lock->fd = -1;
+#endif
+}
@@ -0,0 +1,63 @@
+/**
+ * Memory-mapped files.
+ * Thin platform layer (mmap on POSIX, file mappings on Windows) shared by
+ * the task store and its sidecar files.
+ */
+
+#ifndef MAPFILE_H
+#define MAPFILE_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "utils.h"
+
+// ---------------------------------------------------------------------------
+// MappedFile struct
+// An opened file mapped into memory, read-write unless opened read-only.
+// data is NULL while the file is empty, and moves whenever the file is
+// resized.
+
+typedef struct {
+    void *data; // start of the mapping, NULL if the file is empty
+    size_t size; // size of the file (and mapping) in bytes
+#ifdef _WIN32
+    void *h_file; // file handle
+    void *h_map; // file mapping handle
+#else
+    int fd; // file descriptor
+#endif
+    int writable; // 0 if mapped read-only
+} MappedFile;
+
+// ---------------------------------------------------------------------------
+// FileLock struct
+// Advisory lock on a file, shared between readers or held by one writer.
+// Locks are held by processes: they keep sessions of different processes
+// apart, not two opens of the same file within one process.
+
+typedef struct {
+#ifdef _WIN32
+    void *h_file; // file handle, NULL if not locked
+#else
+    int fd; // file descriptor, -1 if not locked
+#endif
+} FileLock;
+
+// ---------------------------------------------------------------------------
+// Functions Prototypes
+
+void mapfile_clear(MappedFile *mf);
+int mapfile_open(MappedFile *mf, const char *file_name, int writable);
+void mapfile_close(MappedFile *mf);
+int mapfile_resize(MappedFile *mf, size_t size);
+int mapfile_sync(MappedFile *mf);
+int mapfile_sync_stream(FILE *fp);
+int mapfile_lock(FileLock *lock,
+                 const char *file_name,
+                 int exclusive,
+                 int wait);
+void mapfile_clear_lock(FileLock *lock);
+void mapfile_unlock(FileLock *lock);
+
+#endif
@@ -0,0 +1,240 @@
+#include "occur.h"
+
+#include <stdlib.h>
+
+// ---------------------------------------------------------------------------
+// Helpers
+
+/**
+ * Get the first start of a task at or after a time.
+ * @param t_time task's start time.
+ * @param period time between two starts, 0 for one-time tasks.
+ * @param from time in question.
+ * @return the first start, t_time if it is not before from.
+ */
+
+static int64_t first_start(int64_t t_time, int64_t period, int64_t from) {
+    if(t_time >= from || !period) return t_time;
+    return t_time + (from - t_time + period - 1)/period*period;
+}
+
+
+/**
+ * Tell whether a stream's next occurrence comes before another's.
+ * Occurrences starting at once are ordered by slot, like the index.
+ */
+
+static int stream_before(const OccurrenceStream *a,
+                         const OccurrenceStream *b) {
+    return a->t_start < b->t_start
+           || (a->t_start == b->t_start && a->slot < b->slot);
+}
+
+
+/**
+ * Move a stream down the heap until neither of its children comes first.
+ * @param heap streams, a heap but for the one at position i.
+ * @param heap_cnt number of streams.
+ * @param i position of the stream to move.
+ */
+
+static void sift_down(OccurrenceStream *heap, long int heap_cnt, long int i) {
+    OccurrenceStream stream = heap[i];
+    
+    for(;;) {
+        long int child = 2*i + 1;
+        if(child >= heap_cnt) break;
+        if(child + 1 < heap_cnt && stream_before(heap + child + 1,
+                                                 heap + child))
+            child++;
+        if(!stream_before(heap + child, &stream)) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = stream;
+}
+
+// ---------------------------------------------------------------------------
+// Iterator functions
+
+/**
+ * Start reading the occurrences of a store's active tasks starting within
+ * [from, to). Recurrent tasks occur every period from their start time on;
+ * the recurrent tasks occurring in the range are found by a scan of the
+ * store's columns, one-time tasks are read from the index as needed.
+ * @param iter place-holder for the iterator, free with occur_free.
+ * @param store opened data file.
+ * @param from start of the time range.
+ * @param to end of the time range, excluded.
+ * @param min_importance lowest importance read.
+ * @return 0 if successful, else -1.
+ */
+
+int occur_init(OccurrenceIter *iter,
+               const TaskStore *store,
+               time_t from,
+               time_t to,
+               uint8_t min_importance) {
+    const TaskColumns *cols = &store->cols;
+    long int heap_cap = 0;
+    
+    iter->store = store;
+    iter->to = to;
+    iter->min_importance = min_importance;
+    iter->heap = NULL;
+    iter->heap_cnt = 0;
+    iter->entry_found = 0;
+    iter->index_left = 0;
+    if(store->task_cnt < 1 || from >= to) return SUCCESSFUL;
+    
+    index_seek(&store->index, from, &iter->cursor);
+    iter->index_left = 1;
+    
+    for(long int i = 0; i < store->task_cnt; i++) {
+        OccurrenceStream *stream;
+        
+        if(!(cols->flags[i] & FLAG_ACTIVE)
+           || !(cols->flags[i] & (FLAG_DAILY | FLAG_WEEKLY))
+           || cols->t_importance_rtn[i] < min_importance)
+            continue;
+        
+        if(iter->heap_cnt == heap_cap) {
+            long int cap = heap_cap ? 2*heap_cap : 64;
+            OccurrenceStream *grown = (OccurrenceStream *)realloc(
+                iter->heap, cap*sizeof(OccurrenceStream));
+            if(grown == NULL) {
+                occur_free(iter);
+                return UNSUCCESSFUL;
+            }
+            iter->heap = grown;
+            heap_cap = cap;
+        }
+        stream = iter->heap + iter->heap_cnt;
+        stream->period = cols->flags[i] & FLAG_DAILY ? SECS_PER_DAY
+                                                     : SECS_PER_WEEK;
+        stream->t_start = first_start(cols->t_time[i], stream->period, from);
+        stream->slot = i;
+        if(stream->t_start < to) iter->heap_cnt++;
+    }
+    
+    for(long int i = iter->heap_cnt/2 - 1; i >= 0; i--)
+        sift_down(iter->heap, iter->heap_cnt, i);
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Read the next occurrences of an iterator, in time order.
+ * @param iter iterator, moved past the occurrences read.
+ * @param buffer place-holder for the occurrences.
+ * @param buffer_size most occurrences to read.
+ * @return number of occurrences read, 0 once all have been.
+ */
+
+int occur_read(OccurrenceIter *iter, Occurrence *buffer, int buffer_size) {
+    const TaskColumns *cols = &iter->store->cols;
+    int read_cnt = 0;
+    
+    while(read_cnt < buffer_size) {
+        const IndexEntry *entry = NULL;
+        OccurrenceStream *top = iter->heap;
+        
+        // Next one-time task, recurrent ones are read from their streams:
+        while(!iter->entry_found && iter->index_left) {
+            long int slot;
+            if(!index_next(&iter->cursor, &iter->entry)
+               || iter->entry.t_time >= iter->to) {
+                iter->index_left = 0;
+                break;
+            }
+            slot = iter->entry.slot;
+            if(!(cols->flags[slot] & (FLAG_DAILY | FLAG_WEEKLY))
+               && cols->t_importance_rtn[slot] >= iter->min_importance)
+                iter->entry_found = 1;
+        }
+        if(iter->entry_found) entry = &iter->entry;
+        
+        if(iter->heap_cnt > 0
+           && (entry == NULL
+               || top->t_start < entry->t_time
+               || (top->t_start == entry->t_time
+                   && top->slot < entry->slot))) {
+            buffer[read_cnt].t_start = top->t_start;
+            buffer[read_cnt].slot = top->slot;
+            top->t_start += top->period;
+            if(top->t_start >= iter->to) // the stream is over
+                *top = iter->heap[--iter->heap_cnt];
+            if(iter->heap_cnt > 0) sift_down(iter->heap, iter->heap_cnt, 0);
+        } else if(entry != NULL) {
+            buffer[read_cnt].t_start = entry->t_time;
+            buffer[read_cnt].slot = entry->slot;
+            iter->entry_found = 0;
+        } else break;
+        read_cnt++;
+    }
+    
+    return read_cnt;
+}
+
+
+/**
+ * Free an iterator's memory, it then reads nothing.
+ * @param iter iterator to free.
+ */
+
+void occur_free(OccurrenceIter *iter) {
+    free(iter->heap);
+    iter->heap = NULL;
+    iter->heap_cnt = 0;
+    iter->entry_found = 0;
+    iter->index_left = 0;
+}
+
+
+/**
+ * Count the occurrences of a store's active tasks starting within
+ * [from, to), without reading them: those of a recurrent task are counted
+ * from its first start in the range.
+ * @param store opened data file.
+ * @param from start of the time range.
+ * @param to end of the time range, excluded.
+ * @param min_importance lowest importance counted.
+ * @return number of occurrences.
+ */
+
+long int occur_count(const TaskStore *store,
+                     time_t from,
+                     time_t to,
+                     uint8_t min_importance) {
+    const TaskColumns *cols = &store->cols;
+    IndexCursor cursor;
+    IndexEntry entry;
+    long int occurrence_cnt = 0;
+    
+    if(store->task_cnt < 1 || from >= to) return 0;
+    
+    // One-time tasks:
+    index_seek(&store->index, from, &cursor);
+    while(index_next(&cursor, &entry) && entry.t_time < to) {
+        long int slot = entry.slot;
+        if(!(cols->flags[slot] & (FLAG_DAILY | FLAG_WEEKLY))
+           && cols->t_importance_rtn[slot] >= min_importance)
+            occurrence_cnt++;
+    }
+    
+    // Recurrent tasks:
+    for(long int i = 0; i < store->task_cnt; i++) {
+        int64_t period, t_start;
+        
+        if(!(cols->flags[i] & FLAG_ACTIVE)
+           || !(cols->flags[i] & (FLAG_DAILY | FLAG_WEEKLY))
+           || cols->t_importance_rtn[i] < min_importance)
+            continue;
+        period = cols->flags[i] & FLAG_DAILY ? SECS_PER_DAY : SECS_PER_WEEK;
+        t_start = first_start(cols->t_time[i], period, from);
+        if(t_start < to) occurrence_cnt += (to - 1 - t_start)/period + 1;
+    }
+    
+    return occurrence_cnt;
+}
@@ -0,0 +1,68 @@
+/**
+ * Occurrences of tasks over a time range.
+ * Daily and weekly tasks happen again every period from their start time
+ * on, so a week holds seven occurrences of a daily task. An OccurrenceIter
+ * reads the occurrences starting within [from, to) in time order without
+ * storing them: one-time tasks come in order from the store's index, each
+ * recurrent task is a stream of its own, and a binary heap keyed by the
+ * streams' next start times merges them. Reading k occurrences of r
+ * recurrent tasks costs O(k log r).
+ */
+
+#ifndef OCCUR_H
+#define OCCUR_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include "task.h"
+#include "store.h"
+
+// ---------------------------------------------------------------------------
+// Occurrence struct
+// A task happening once, its record is the store's tasks[slot].
+
+typedef struct {
+    int64_t t_start; // start time of this occurrence
+    int64_t slot; // position of the task in the data file
+} Occurrence;
+
+// ---------------------------------------------------------------------------
+// OccurrenceIter struct
+// Position in the occurrences of a store's tasks over a time range. Like
+// views, iterators are only valid until the store is next mutated.
+
+typedef struct {
+    int64_t t_start; // next start time of the task
+    int64_t period; // time between two starts
+    int64_t slot; // position of the task in the data file
+} OccurrenceStream;
+
+typedef struct {
+    const TaskStore *store; // store the tasks are in
+    time_t to; // end of the time range, excluded
+    uint8_t min_importance; // lowest importance read
+    IndexCursor cursor; // next index entry, for one-time tasks
+    IndexEntry entry; // next one-time task, if found
+    int entry_found; // 1 if entry is the next one-time task
+    int index_left; // 0 once the index is past the range
+    OccurrenceStream *heap; // recurrent tasks by next start, then slot
+    long int heap_cnt; // number of recurrent tasks left in the range
+} OccurrenceIter;
+
+// ---------------------------------------------------------------------------
+// Functions Prototypes
+
+int occur_init(OccurrenceIter *iter,
+               const TaskStore *store,
+               time_t from,
+               time_t to,
+               uint8_t min_importance);
+int occur_read(OccurrenceIter *iter, Occurrence *buffer, int buffer_size);
+void occur_free(OccurrenceIter *iter);
+long int occur_count(const TaskStore *store,
+                     time_t from,
+                     time_t to,
+                     uint8_t min_importance);
+
+#endif
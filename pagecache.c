@@ -0,0 +1,112 @@
+#include "pagecache.h"
+
+#include <stdlib.h>
+
+// ---------------------------------------------------------------------------
+// Page cache functions
+
+/**
+ * Initialize an empty cache.
+ * @param cache cache to initialize.
+ */
+
+void page_cache_init(PageCache *cache) {
+    memset(cache, 0, sizeof(PageCache));
+}
+
+
+/**
+ * Free the memory held by a cache, it is then empty.
+ * @param cache cache to free.
+ */
+
+void page_cache_free(PageCache *cache) {
+    for(int i = 0; i < PAGE_CACHE_SIZE; i++) {
+        free(cache->pages[i].file_name);
+        free(cache->pages[i].text);
+    }
+    page_cache_init(cache);
+}
+
+
+/**
+ * Look a page up.
+ * @param cache cache to search.
+ * @param file_name data file of the page.
+ * @param generation generation of the store.
+ * @param view_generation generation of the view.
+ * @param page page number.
+ * @return the cached page, NULL if there is none.
+ */
+
+const CachedPage *page_cache_find(PageCache *cache,
+                                  const char *file_name,
+                                  uint64_t generation,
+                                  uint64_t view_generation,
+                                  long int page) {
+    cache->clock++;
+    
+    for(int i = 0; i < PAGE_CACHE_SIZE; i++) {
+        CachedPage *cached = cache->pages + i;
+        if(cached->file_name != NULL
+           && cached->generation == generation
+           && cached->view_generation == view_generation
+           && cached->page == page
+           && strcmp(cached->file_name, file_name) == 0) {
+            cached->last_used = cache->clock;
+            return cached;
+        }
+    }
+    
+    return NULL;
+}
+
+
+/**
+ * Add a page, in place of the least recently used one.
+ * @param cache cache to add to.
+ * @param file_name data file of the page.
+ * @param generation generation of the store.
+ * @param view_generation generation of the view.
+ * @param page page number.
+ * @param row_cnt number of rows.
+ * @param text rows, each ended by '\n'.
+ * @return the cached page, NULL if out of memory.
+ */
+
+const CachedPage *page_cache_insert(PageCache *cache,
+                                    const char *file_name,
+                                    uint64_t generation,
+                                    uint64_t view_generation,
+                                    long int page,
+                                    int row_cnt,
+                                    const char *text) {
+    CachedPage *victim = cache->pages;
+    
+    for(int i = 1; i < PAGE_CACHE_SIZE && victim->file_name != NULL; i++)
+        if(cache->pages[i].file_name == NULL
+           || cache->pages[i].last_used < victim->last_used)
+            victim = cache->pages + i;
+    
+    free(victim->file_name);
+    free(victim->text);
+    memset(victim, 0, sizeof(CachedPage));
+    
+    victim->file_name = (char *)malloc(strlen(file_name) + 1);
+    victim->text = (char *)malloc(strlen(text) + 1);
+    if(victim->file_name == NULL || victim->text == NULL) {
+        free(victim->file_name);
+        free(victim->text);
+        memset(victim, 0, sizeof(CachedPage));
+        return NULL;
+    }
+    strcpy(victim->file_name, file_name);
+    strcpy(victim->text, text);
+    victim->generation = generation;
+    victim->view_generation = view_generation;
+    victim->page = page;
+    victim->row_cnt = row_cnt;
+    victim->last_used = ++cache->clock;
+    
+    return victim;
+}
@@ -0,0 +1,57 @@
+/**
+ * Cache of formatted pages for display_tasks.
+ * Pages are keyed by data file, page number and the generation of the
+ * store and view they were formatted from. Any mutation of a store gives
+ * it a new generation, so pages of older generations are never hit again
+ * and are evicted as least recently used.
+ */
+
+#ifndef PAGECACHE_H
+#define PAGECACHE_H
+
+#include <stdint.h>
+
+#include "utils.h"
+
+// ---------------------------------------------------------------------------
+// Module constants
+
+#define PAGE_CACHE_SIZE 16 /* pages kept */
+
+// ---------------------------------------------------------------------------
+// PageCache structs
+
+typedef struct {
+    char *file_name; // data file of the page, NULL if the entry is unused
+    uint64_t generation; // store's generation
+    uint64_t view_generation; // view's generation
+    long int page; // page number
+    int row_cnt; // number of rows
+    char *text; // rows, each ended by '\n'
+    uint64_t last_used; // value of the cache's clock when last used
+} CachedPage;
+
+typedef struct {
+    CachedPage pages[PAGE_CACHE_SIZE];
+    uint64_t clock; // incremented on every lookup
+} PageCache;
+
+// ---------------------------------------------------------------------------
+// Functions Prototypes
+
+void page_cache_init(PageCache *cache);
+void page_cache_free(PageCache *cache);
+const CachedPage *page_cache_find(PageCache *cache,
+                                  const char *file_name,
+                                  uint64_t generation,
+                                  uint64_t view_generation,
+                                  long int page);
+const CachedPage *page_cache_insert(PageCache *cache,
+                                    const char *file_name,
+                                    uint64_t generation,
+                                    uint64_t view_generation,
+                                    long int page,
+                                    int row_cnt,
+                                    const char *text);
+
+#endif
@@ -0,0 +1,156 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "pool.h"
+
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+// ---------------------------------------------------------------------------
+// Helpers
+
+typedef struct {
+    ThreadPool *pool;
+    int worker; // number of the worker
+} WorkerArgs;
+
+
+/**
+ * Take the next job of a worker's own queue.
+ * @return number of the job, -1 if the queue is empty.
+ */
+
+static long int take_job(JobQueue *queue) {
+    long int job = UNSUCCESSFUL;
+    
+    pthread_mutex_lock(&queue->mutex);
+    if(queue->first < queue->last) job = --queue->last;
+    pthread_mutex_unlock(&queue->mutex);
+    
+    return job;
+}
+
+
+/**
+ * Steal the oldest job of another worker's queue.
+ * @return number of the job, -1 if the queue is empty.
+ */
+
+static long int steal_job(JobQueue *queue) {
+    long int job = UNSUCCESSFUL;
+    
+    pthread_mutex_lock(&queue->mutex);
+    if(queue->first < queue->last) job = queue->first++;
+    pthread_mutex_unlock(&queue->mutex);
+    
+    return job;
+}
+
+
+/**
+ * Body of a worker thread: run its own jobs, then steal from the others
+ * until every queue is empty. No job is added once the pool runs, so an
+ * empty round means all jobs are taken.
+ */
+
+static void *work(void *arg) {
+    WorkerArgs *args = (WorkerArgs *)arg;
+    ThreadPool *pool = args->pool;
+    long int job;
+    
+    for(;;) {
+        job = take_job(pool->queues + args->worker);
+        for(int i = 1; job == UNSUCCESSFUL && i < pool->worker_cnt; i++)
+            job = steal_job(pool->queues
+                            + (args->worker + i)%pool->worker_cnt);
+        if(job == UNSUCCESSFUL) break;
+        pool->run(pool->context, job, args->worker);
+    }
+    
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Pool functions
+
+/**
+ * Run jobs on worker threads, and wait for all of them to finish.
+ * The calling thread runs as worker 0.
+ * @param worker_cnt number of workers, at most POOL_MAX_WORKERS.
+ * @param job_cnt number of jobs, numbered from 0.
+ * @param run function running a job, given context, the job's number and
+ *        the number of the worker running it. It may run on any thread.
+ * @param context passed to run.
+ * @return 0 if successful, else -1.
+ */
+
+int pool_run(int worker_cnt,
+             long int job_cnt,
+             void (*run)(void *, long int, int),
+             void *context) {
+    ThreadPool pool;
+    WorkerArgs args[POOL_MAX_WORKERS];
+    pthread_t threads[POOL_MAX_WORKERS];
+    int started_cnt = 1;
+    
+    if(worker_cnt < 1 || worker_cnt > POOL_MAX_WORKERS || job_cnt < 0)
+        return UNSUCCESSFUL;
+    if(worker_cnt > job_cnt) worker_cnt = job_cnt ? (int)job_cnt : 1;
+    
+    pool.queues = (JobQueue *)malloc(worker_cnt*sizeof(JobQueue));
+    if(pool.queues == NULL) return UNSUCCESSFUL;
+    pool.worker_cnt = worker_cnt;
+    pool.run = run;
+    pool.context = context;
+    
+    // Deal out the jobs in contiguous blocks:
+    for(int i = 0; i < worker_cnt; i++) {
+        pool.queues[i].first = job_cnt*i/worker_cnt;
+        pool.queues[i].last = job_cnt*(i + 1)/worker_cnt;
+        pthread_mutex_init(&pool.queues[i].mutex, NULL);
+        args[i].pool = &pool;
+        args[i].worker = i;
+    }
+    
+    for(int i = 1; i < worker_cnt; i++) {
+        if(pthread_create(threads + i, NULL, work, args + i) != 0)
+            break; // its jobs are stolen by the others
+        started_cnt++;
+    }
+    work(args);
+    for(int i = 1; i < started_cnt; i++)
+        pthread_join(threads[i], NULL);
+    
+    for(int i = 0; i < worker_cnt; i++)
+        pthread_mutex_destroy(&pool.queues[i].mutex);
+    free(pool.queues);
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Get the number of processors available, the usual number of workers.
+ * @return number of processors, at least 1.
+ */
+
+int pool_cpu_cnt(void) {
+    long int cpu_cnt;
+    
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    cpu_cnt = (long int)info.dwNumberOfProcessors;
+#else
+    cpu_cnt = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    
+    if(cpu_cnt < 1) return 1;
+    return cpu_cnt > POOL_MAX_WORKERS ? POOL_MAX_WORKERS : (int)cpu_cnt;
+}
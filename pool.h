@@ -0,0 +1,52 @@
+/**
+ * Work-stealing thread pool.
+ * Runs a fixed set of jobs on worker threads. Jobs are dealt out to the
+ * workers up front, each worker taking its own from the back of its queue;
+ * idle workers steal from the front of the others' queues, so a few slow
+ * jobs do not leave the other workers waiting.
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <pthread.h>
+
+#include "utils.h"
+
+// ---------------------------------------------------------------------------
+// Module constants
+
+#define POOL_MAX_WORKERS 256
+
+// ---------------------------------------------------------------------------
+// JobQueue struct
+// Jobs dealt to one worker, numbers first to last - 1. The owner takes
+// jobs from last, thieves from first.
+
+typedef struct {
+    long int first; // next job to be stolen
+    long int last; // one past the owner's next job
+    pthread_mutex_t mutex; // guards first and last
+} JobQueue;
+
+// ---------------------------------------------------------------------------
+// ThreadPool struct
+// Shared by the workers while jobs run.
+
+typedef struct {
+    JobQueue *queues; // one per worker
+    int worker_cnt; // number of worker threads
+    void (*run)(void *, long int, int); // runs a job on a worker
+    void *context; // passed to run
+} ThreadPool;
+
+// ---------------------------------------------------------------------------
+// Functions Prototypes
+
+int pool_run(int worker_cnt,
+             long int job_cnt,
+             void (*run)(void *, long int, int),
+             void *context);
+int pool_cpu_cnt(void);
+
+#endif
@@ -0,0 +1,187 @@
+#include "rank.h"
+
+#include <stdlib.h>
+
+// ---------------------------------------------------------------------------
+// Helpers
+
+/**
+ * Tell whether a task ranks before another. Tasks with the same key are
+ * ordered by slot, so rankings do not depend on the order of the scan.
+ */
+
+static int ranks_before(const RankedTask *a, const RankedTask *b) {
+    return a->key < b->key || (a->key == b->key && a->slot < b->slot);
+}
+
+
+/**
+ * Move a task down the heap until none of its children ranks after it.
+ * The heap holds the worst ranked task at its root.
+ * @param heap tasks, a heap but for the one at position i.
+ * @param heap_cnt number of tasks.
+ * @param i position of the task to move.
+ */
+
+static void sift_down(RankedTask *heap, int heap_cnt, int i) {
+    RankedTask task = heap[i];
+    
+    for(;;) {
+        int child = 2*i + 1;
+        if(child >= heap_cnt) break;
+        if(child + 1 < heap_cnt && ranks_before(heap + child,
+                                                heap + child + 1))
+            child++;
+        if(!ranks_before(&task, heap + child)) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = task;
+}
+
+
+/**
+ * Move a task up the heap until its parent does not rank before it.
+ * @param heap tasks, a heap but for the one at position i.
+ * @param i position of the task to move.
+ */
+
+static void sift_up(RankedTask *heap, int i) {
+    RankedTask task = heap[i];
+    
+    while(i > 0 && ranks_before(heap + (i - 1)/2, &task)) {
+        heap[i] = heap[(i - 1)/2];
+        i = (i - 1)/2;
+    }
+    heap[i] = task;
+}
+
+// ---------------------------------------------------------------------------
+// Ranking functions
+
+/**
+ * Get the rank key of a task, lower keys rank first.
+ * @param t_time task's start time.
+ * @param importance task's importance.
+ * @return the key.
+ */
+
+int64_t rank_key(int64_t t_time, uint8_t importance) {
+    return t_time - (int64_t)importance*RANK_SECS_PER_POINT;
+}
+
+
+/**
+ * Initialize a ranking, to be filled by rank_scan or rank_refresh.
+ * @param ranking place-holder for the ranking, free with rank_free.
+ * @param k number of tasks asked for, at most RANK_MAX.
+ * @return 0 if successful, else -1.
+ */
+
+int rank_init(Ranking *ranking, int k) {
+    if(k < 1 || k > RANK_MAX) return UNSUCCESSFUL;
+    
+    ranking->store = NULL;
+    ranking->cnt = 0;
+    ranking->cap = 2*k;
+    ranking->k = k;
+    ranking->complete = 0;
+    ranking->generation = 0;
+    ranking->tasks = malloc(ranking->cap*sizeof(RankedTask));
+    if(ranking->tasks == NULL) return UNSUCCESSFUL;
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Free the candidates of a ranking.
+ * @param ranking initialized ranking.
+ */
+
+void rank_free(Ranking *ranking) {
+    free(ranking->tasks);
+    ranking->tasks = NULL;
+    ranking->store = NULL;
+    ranking->cnt = 0;
+}
+
+
+/**
+ * Rank the active tasks of a store starting after a time, in a single pass
+ * over its columns. The best candidates are kept in a heap bounded to the
+ * ranking's capacity, worst first, so a task ranking after all of them
+ * costs one comparison and ranking n tasks costs O(n log k).
+ * @param ranking initialized ranking.
+ * @param store opened data file.
+ * @param now tasks starting at or before this are left out.
+ * @return number of tasks ranked, at most k.
+ */
+
+int rank_scan(Ranking *ranking, const TaskStore *store, time_t now) {
+    const TaskColumns *cols = &store->cols;
+    RankedTask *heap = ranking->tasks;
+    RankedTask task;
+    long int upcoming_cnt = 0;
+    int heap_cnt = 0;
+    
+    for(long int i = 0; i < store->task_cnt; i++) {
+        if(!(cols->flags[i] & FLAG_ACTIVE) || cols->t_time[i] <= now)
+            continue;
+        upcoming_cnt++;
+        task.key = rank_key(cols->t_time[i], cols->t_importance_rtn[i]);
+        task.slot = i;
+        if(heap_cnt < ranking->cap) {
+            heap[heap_cnt] = task;
+            sift_up(heap, heap_cnt++);
+        } else if(ranks_before(&task, heap)) {
+            heap[0] = task;
+            sift_down(heap, heap_cnt, 0);
+        }
+    }
+    
+    // Popping the worst task to the end of the heap leaves them best first:
+    for(int i = heap_cnt - 1; i > 0; i--) {
+        task = heap[0];
+        heap[0] = heap[i];
+        heap[i] = task;
+        sift_down(heap, i, 0);
+    }
+    
+    ranking->store = store;
+    ranking->generation = store->generation;
+    ranking->cnt = heap_cnt;
+    ranking->complete = upcoming_cnt <= ranking->cap;
+    
+    return heap_cnt < ranking->k ? heap_cnt : ranking->k;
+}
+
+
+/**
+ * Bring a ranking up to date. If the store has not been written since it
+ * was ranked, keys are unchanged: the candidates that have started are
+ * dropped, and the store is only scanned again once fewer than k are left
+ * while some upcoming tasks are not candidates.
+ * @param ranking initialized ranking.
+ * @param store opened data file.
+ * @param now tasks starting at or before this are left out.
+ * @return number of tasks ranked, at most k.
+ */
+
+int rank_refresh(Ranking *ranking, const TaskStore *store, time_t now) {
+    const int64_t *t_time = store->cols.t_time;
+    int cnt = 0;
+    
+    if(ranking->store != store || ranking->generation != store->generation)
+        return rank_scan(ranking, store, now);
+    
+    for(int i = 0; i < ranking->cnt; i++)
+        if(t_time[ranking->tasks[i].slot] > now)
+            ranking->tasks[cnt++] = ranking->tasks[i];
+    ranking->cnt = cnt;
+    
+    if(cnt < ranking->k && !ranking->complete)
+        return rank_scan(ranking, store, now);
+    
+    return cnt < ranking->k ? cnt : ranking->k;
+}
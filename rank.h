@@ -0,0 +1,58 @@
+/**
+ * Top upcoming tasks by importance and time until start.
+ * A task's rank key is its start time less RANK_SECS_PER_POINT for each
+ * point of importance, so a task rated one point higher ranks like one
+ * starting RANK_SECS_PER_POINT sooner. Keys do not depend on the current
+ * time, so the order of two upcoming tasks never changes as time passes.
+ * A Ranking keeps the best 2k candidates found by a single pass over the
+ * store's columns, with a bounded heap; refreshing it while the store is
+ * unchanged only drops the candidates that have started, and scans again
+ * once fewer than k are left.
+ */
+
+#ifndef RANK_H
+#define RANK_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include "task.h"
+#include "store.h"
+
+// ---------------------------------------------------------------------------
+// Module constants
+
+#define RANK_SECS_PER_POINT (MINS_PER_HOUR*SECS_PER_MIN) /* per importance */
+#define RANK_MAX 64 /* most tasks ranked */
+
+// ---------------------------------------------------------------------------
+// Ranking struct
+// Best upcoming tasks of a store, valid while the store's generation is the
+// one they were ranked at. Candidates past the first k are kept so that
+// tasks starting do not force a new scan.
+
+typedef struct {
+    int64_t key; // rank key, lower ranks first
+    int64_t slot; // position of the task in the data file
+} RankedTask;
+
+typedef struct Ranking {
+    const TaskStore *store; // store the tasks are in, NULL if not ranked
+    RankedTask *tasks; // candidates, best first
+    int cnt; // number of candidates
+    int cap; // most candidates kept
+    int k; // number of tasks asked for
+    int complete; // 1 if every upcoming task is a candidate
+    uint64_t generation; // generation of the store when ranked
+} Ranking;
+
+// ---------------------------------------------------------------------------
+// Functions Prototypes
+
+int64_t rank_key(int64_t t_time, uint8_t importance);
+int rank_init(Ranking *ranking, int k);
+void rank_free(Ranking *ranking);
+int rank_scan(Ranking *ranking, const TaskStore *store, time_t now);
+int rank_refresh(Ranking *ranking, const TaskStore *store, time_t now);
+
+#endif
@@ -0,0 +1,98 @@
+/**
+ * Ez Task reminders - notify a user's tasks as they start, in the
+ * background. The data file is read again every reload_secs seconds to
+ * pick up changes, and only locked while being read, so interactive
+ * sessions can still open it for writing.
+ */
+
+#include <stdlib.h>
+
+#include "task.h"
+#include "store.h"
+#include "reminder.h"
+
+#define RELOAD_SECS 60
+
+void notify(void *context, const Task *task, int64_t lateness);
+
+int main(int argc, char *argv[]) {
+    const char *usage = "Usage: %s user_name [reload_secs]\n";
+    ReminderClock clock;
+    Reminder reminder;
+    char *file_name;
+    FILE *fp;
+    int reload_secs;
+    int result = SUCCESSFUL;
+    
+    if(argc < 2 || argc > 3) {
+        printf(usage, argv[0]);
+        return -1;
+    }
+    if(!valid_username(argv[1])) {
+        printf("Error: Invalid username...\n");
+        return -1;
+    }
+    reload_secs = argc > 2 ? atoi(argv[2]) : RELOAD_SECS;
+    if(reload_secs < 1) {
+        printf(usage, argv[0]);
+        return -1;
+    }
+    
+    file_name = username2datafilename(argv[1], "");
+    fp = fopen(file_name, "rb");
+    if(fp == NULL) {
+        printf("Error: Account %s does not exist...\n", argv[1]);
+        free(file_name);
+        return -1;
+    }
+    fclose(fp);
+    if(reminder_clock_system(&clock) == UNSUCCESSFUL) {
+        printf("Error: Unable to create a timer...\n");
+        free(file_name);
+        return -1;
+    }
+    reminder_init(&reminder, &clock, notify, NULL);
+    
+    while(result == SUCCESSFUL) {
+        TaskStore store;
+        
+        // Keep the tasks loaded before while a session writes the file:
+        if(store_open(&store, file_name, STORE_READ) == SUCCESSFUL) {
+            result = reminder_load(&reminder, &store);
+            store_close(&store);
+            if(result == UNSUCCESSFUL) {
+                printf("Error: Out of memory...\n");
+                break;
+            }
+        }
+        result = reminder_run(&reminder, time(NULL) + reload_secs);
+        if(result == UNSUCCESSFUL) printf("Error: Unable to wait...\n");
+    }
+    
+    reminder_free(&reminder);
+    reminder_clock_close(&clock);
+    free(file_name);
+    
+    return -1;
+}
+
+// ---------------------------------------------------------------------------
+// Helpers
+
+/**
+ * Print a reminder of a starting task.
+ * @param context unused.
+ * @param task the task.
+ * @param lateness time since the task started, in nanoseconds.
+ */
+
+void notify(void *context, const Task *task, int64_t lateness) {
+    time_t t_start = task->t_time;
+    char time_str[TIME_STR_LEN];
+    
+    (void)context;
+    printf("%s  %.*s (importance %u, notified %.3f ms late)\n",
+           time2str(&t_start, time_str), TASK_NAME_MAXLEN - 1, task->t_name,
+           task->t_importance_rtn, lateness/1e6);
+    fflush(stdout);
+}
@@ -0,0 +1,327 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "reminder.h"
+
+#include <stdlib.h>
+
+#ifdef _WIN32
+#define _WIN32_WINNT 0x0602 /* GetSystemTimePreciseAsFileTime */
+#include <windows.h>
+#else
+#include <errno.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/timerfd.h>
+#endif
+#endif
+
+// Windows file times count 100 ns from 1601, 11644473600 s before 1970:
+#define FILETIME_EPOCH 116444736000000000LL
+
+// ---------------------------------------------------------------------------
+// Clock functions
+
+/**
+ * Current time of the system clock.
+ */
+
+static int64_t system_now(ReminderClock *clock) {
+#ifdef _WIN32
+    FILETIME ft;
+    ULARGE_INTEGER t;
+    
+    (void)clock;
+    GetSystemTimePreciseAsFileTime(&ft);
+    t.LowPart = ft.dwLowDateTime;
+    t.HighPart = ft.dwHighDateTime;
+    return ((int64_t)t.QuadPart - FILETIME_EPOCH)*100;
+#else
+    struct timespec ts;
+    
+    (void)clock;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec*NSECS_PER_SEC + ts.tv_nsec;
+#endif
+}
+
+
+/**
+ * Sleep on the system clock until a time, or a signal.
+ * Timers are set to absolute times of the realtime clock, so changes of
+ * the system's date move the wake-up along with the tasks' times.
+ * @return 0 if successful, else -1.
+ */
+
+static int system_sleep_until(ReminderClock *clock, int64_t t) {
+#ifdef _WIN32
+    LARGE_INTEGER due;
+    
+    due.QuadPart = t/100 + FILETIME_EPOCH; // positive: absolute time
+    if(!SetWaitableTimer((HANDLE)clock->timer, &due, 0, NULL, NULL, FALSE))
+        return UNSUCCESSFUL;
+    return WaitForSingleObject((HANDLE)clock->timer, INFINITE)
+           == WAIT_OBJECT_0 ? SUCCESSFUL : UNSUCCESSFUL;
+#elif defined(__linux__)
+    struct itimerspec spec;
+    uint64_t expirations;
+    
+    spec.it_interval.tv_sec = 0;
+    spec.it_interval.tv_nsec = 0;
+    spec.it_value.tv_sec = (time_t)(t/NSECS_PER_SEC);
+    spec.it_value.tv_nsec = (long)(t%NSECS_PER_SEC);
+    if(timerfd_settime((int)clock->timer, TFD_TIMER_ABSTIME, &spec, NULL)
+       == -1)
+        return UNSUCCESSFUL;
+    if(read((int)clock->timer, &expirations, sizeof(expirations)) == -1
+       && errno != EINTR)
+        return UNSUCCESSFUL;
+    return SUCCESSFUL;
+#else
+    struct timespec ts;
+    int result;
+    
+    (void)clock;
+    ts.tv_sec = (time_t)(t/NSECS_PER_SEC);
+    ts.tv_nsec = (long)(t%NSECS_PER_SEC);
+    result = clock_nanosleep(CLOCK_REALTIME, TIMER_ABSTIME, &ts, NULL);
+    return result == 0 || result == EINTR ? SUCCESSFUL : UNSUCCESSFUL;
+#endif
+}
+
+
+/**
+ * Current time of a manual clock.
+ */
+
+static int64_t manual_now(ReminderClock *clock) {
+    return clock->time;
+}
+
+
+/**
+ * Move a manual clock forward to a time, at once.
+ * @return 0.
+ */
+
+static int manual_sleep_until(ReminderClock *clock, int64_t t) {
+    if(t > clock->time) clock->time = t;
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Set up a clock following the system's time.
+ * @param clock place-holder for the clock, close with reminder_clock_close.
+ * @return 0 if successful, else -1.
+ */
+
+int reminder_clock_system(ReminderClock *clock) {
+    clock->now = system_now;
+    clock->sleep_until = system_sleep_until;
+    clock->time = 0;
+#ifdef _WIN32
+    clock->timer = (intptr_t)CreateWaitableTimerA(NULL, TRUE, NULL);
+    if(clock->timer == 0) {
+        clock->timer = -1;
+        return UNSUCCESSFUL;
+    }
+#elif defined(__linux__)
+    clock->timer = timerfd_create(CLOCK_REALTIME, TFD_CLOEXEC);
+    if(clock->timer == -1) return UNSUCCESSFUL;
+#else
+    clock->timer = -1; // clock_nanosleep needs none
+#endif
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Set up a clock standing still until slept on.
+ * @param clock place-holder for the clock.
+ * @param start time the clock starts at, in nanoseconds since the epoch.
+ */
+
+void reminder_clock_manual(ReminderClock *clock, int64_t start) {
+    clock->now = manual_now;
+    clock->sleep_until = manual_sleep_until;
+    clock->time = start;
+    clock->timer = -1;
+}
+
+
+/**
+ * Release the timer of a clock.
+ * @param clock clock to close.
+ */
+
+void reminder_clock_close(ReminderClock *clock) {
+    if(clock->timer == -1) return;
+#ifdef _WIN32
+    CloseHandle((HANDLE)clock->timer);
+#else
+    close((int)clock->timer);
+#endif
+    clock->timer = -1;
+}
+
+// ---------------------------------------------------------------------------
+// Helpers
+
+/**
+ * Schedule a copied task at its next start from the wheel's current
+ * second on, moving it as update_task_at does. Tasks on going are moved
+ * past their current occurrences; one-time tasks which have started are
+ * not scheduled.
+ * @param reminder scheduler the task was copied to.
+ * @param slot position of the copy.
+ * @return 0 if successful, else -1.
+ */
+
+static int arm(Reminder *reminder, long int slot) {
+    Task *task = reminder->tasks + slot;
+    time_t from = (time_t)reminder->wheel.current;
+    
+    if(task->t_time < from) update_task_at(task, from);
+    while(task->flags & FLAG_ACTIVE && task->t_time < from)
+        update_task_at(task, get_end_time(task)); // one period at a time
+    if(!(task->flags & FLAG_ACTIVE)) return SUCCESSFUL;
+    
+    return wheel_add(&reminder->wheel, task->t_time, slot);
+}
+
+
+/**
+ * Notify a starting task, then re-arm it for its next start, run by the
+ * wheel.
+ * @param context the scheduler.
+ * @param slot position of the task's copy.
+ * @param expires the task's start time.
+ */
+
+static void fire(void *context, int64_t slot, int64_t expires) {
+    Reminder *reminder = (Reminder *)context;
+    Task *task = reminder->tasks + slot;
+    int64_t lateness = reminder->clock->now(reminder->clock)
+                       - expires*NSECS_PER_SEC;
+    
+    reminder->notify(reminder->context, task, lateness);
+    update_task_at(task, get_end_time(task)); // next period, if any
+    if(task->flags & FLAG_ACTIVE)
+        wheel_add(&reminder->wheel, task->t_time, slot);
+}
+
+// ---------------------------------------------------------------------------
+// Scheduler functions
+
+/**
+ * Initialize a scheduler without tasks, starting at its clock's time.
+ * @param reminder scheduler to initialize, free with reminder_free.
+ * @param clock clock to run on.
+ * @param notify called with context, a task starting and how late it is
+ *        notified, in nanoseconds. The task is only valid during the call.
+ * @param context passed to notify.
+ */
+
+void reminder_init(Reminder *reminder,
+                   ReminderClock *clock,
+                   void (*notify)(void *, const Task *, int64_t),
+                   void *context) {
+    wheel_init(&reminder->wheel, clock->now(clock)/NSECS_PER_SEC);
+    reminder->tasks = NULL;
+    reminder->task_cnt = 0;
+    reminder->task_cap = 0;
+    reminder->clock = clock;
+    reminder->notify = notify;
+    reminder->context = context;
+}
+
+
+/**
+ * Free a scheduler's memory, it then has no tasks.
+ * @param reminder scheduler to free.
+ */
+
+void reminder_free(Reminder *reminder) {
+    wheel_free(&reminder->wheel);
+    free(reminder->tasks);
+    reminder->tasks = NULL;
+    reminder->task_cnt = 0;
+    reminder->task_cap = 0;
+}
+
+
+/**
+ * Schedule a copy of a task at its next start.
+ * @param reminder scheduler to add to.
+ * @param task task to copy.
+ * @return 0 if successful, else -1.
+ */
+
+int reminder_add(Reminder *reminder, const Task *task) {
+    if(reminder->task_cnt == reminder->task_cap) {
+        long int cap = reminder->task_cap ? 2*reminder->task_cap : 1024;
+        Task *grown = (Task *)realloc(reminder->tasks, cap*sizeof(Task));
+        if(grown == NULL) return UNSUCCESSFUL;
+        reminder->tasks = grown;
+        reminder->task_cap = cap;
+    }
+    reminder->tasks[reminder->task_cnt] = *task;
+    
+    return arm(reminder, reminder->task_cnt++);
+}
+
+
+/**
+ * Replace a scheduler's tasks by the active tasks of a store. They are
+ * scheduled from the first second not run yet, so reloading the store
+ * neither misses starts nor notifies them twice. The store may be closed
+ * afterwards.
+ * @param reminder scheduler to load.
+ * @param store opened data file.
+ * @return 0 if successful, else -1.
+ */
+
+int reminder_load(Reminder *reminder, const TaskStore *store) {
+    const TaskColumns *cols = &store->cols;
+    
+    wheel_reset(&reminder->wheel, reminder->wheel.current);
+    reminder->task_cnt = 0;
+    for(long int i = 0; i < store->task_cnt; i++)
+        if(cols->flags[i] & FLAG_ACTIVE
+           && reminder_add(reminder, store->tasks + i) == UNSUCCESSFUL)
+            return UNSUCCESSFUL;
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Notify tasks as they start, until a time. The scheduler sleeps until the
+ * wheel's next timer, or until the time, whichever comes first.
+ * @param reminder scheduler to run.
+ * @param until time to return at; tasks starting before it are notified.
+ * @return 0 if successful, else -1.
+ */
+
+int reminder_run(Reminder *reminder, time_t until) {
+    ReminderClock *clock = reminder->clock;
+    
+    while(reminder->wheel.current < until) {
+        int64_t next = wheel_next(&reminder->wheel);
+        int64_t now;
+        
+        if(next > until) next = until;
+        if(clock->now(clock) < next*NSECS_PER_SEC
+           && clock->sleep_until(clock, next*NSECS_PER_SEC) == UNSUCCESSFUL)
+            return UNSUCCESSFUL;
+        
+        now = clock->now(clock)/NSECS_PER_SEC;
+        wheel_advance(&reminder->wheel, now < until ? now : until - 1,
+                      fire, reminder);
+    }
+    
+    return SUCCESSFUL;
+}
@@ -0,0 +1,67 @@
+/**
+ * Reminders of starting tasks.
+ * Active tasks of a store are copied into a timing wheel, each timer
+ * firing when its task starts. Fired recurrent tasks are re-armed for
+ * their next start the way update_task moves them. Between firings the
+ * scheduler sleeps on a clock until the next one, rather than polling.
+ * Timers fire at whole seconds: tasks starting in the same second are
+ * notified one after the other, each one later than the last by the time
+ * notify takes plus a reading of the clock.
+ */
+
+#ifndef REMINDER_H
+#define REMINDER_H
+
+#include <stdint.h>
+
+#include "task.h"
+#include "store.h"
+#include "wheel.h"
+
+// ---------------------------------------------------------------------------
+// Module constants
+
+#define NSECS_PER_SEC 1000000000LL
+
+// ---------------------------------------------------------------------------
+// ReminderClock struct
+// Source of time of a scheduler. The system clock sleeps on a single timer
+// (a timerfd on Linux); a manual clock jumps to the time slept until, so
+// runs over days of tasks take no time and can be checked exactly.
+
+typedef struct ReminderClock {
+    int64_t (*now)(struct ReminderClock *clock); // nanoseconds since epoch
+    int (*sleep_until)(struct ReminderClock *clock, int64_t t); // same unit
+    int64_t time; // time of a manual clock
+    intptr_t timer; // timer the system clock sleeps on, -1 if none
+} ReminderClock;
+
+// ---------------------------------------------------------------------------
+// Reminder struct
+
+typedef struct {
+    TimerWheel wheel; // timers by start time, their slots index tasks
+    Task *tasks; // copies of the scheduled tasks, at their next start
+    long int task_cnt; // number of copied tasks
+    long int task_cap; // capacity of tasks
+    ReminderClock *clock; // clock the scheduler runs on
+    void (*notify)(void *, const Task *, int64_t); // see reminder_init
+    void *context; // passed to notify
+} Reminder;
+
+// ---------------------------------------------------------------------------
+// Functions Prototypes
+
+int reminder_clock_system(ReminderClock *clock);
+void reminder_clock_manual(ReminderClock *clock, int64_t start);
+void reminder_clock_close(ReminderClock *clock);
+void reminder_init(Reminder *reminder,
+                   ReminderClock *clock,
+                   void (*notify)(void *, const Task *, int64_t),
+                   void *context);
+void reminder_free(Reminder *reminder);
+int reminder_add(Reminder *reminder, const Task *task);
+int reminder_load(Reminder *reminder, const TaskStore *store);
+int reminder_run(Reminder *reminder, time_t until);
+
+#endif
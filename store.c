@@ -0,0 +1,1171 @@
+#include "store.h"
+
+#include <stdlib.h>
+#include <stdatomic.h>
+
+#define NEEDS_WRITING -2 /* returned by open_store */
+
+// ---------------------------------------------------------------------------
+// Helpers
+
+/**
+ * Point header and records into the data file's mapping.
+ * @param store store whose file has just been (re)mapped.
+ */
+
+static void attach(TaskStore *store) {
+    store->header = (FileHeader *)store->file.data;
+    store->tasks = store->header ? (Task *)(store->header + 1) : NULL;
+}
+
+
+/**
+ * Resize the data file to hold a number of records.
+ * @param store store to resize.
+ * @param task_cnt number of records after resizing.
+ * @return 0 if successful, else -1.
+ */
+
+static int resize(TaskStore *store, long int task_cnt) {
+    int result = mapfile_resize(&store->file,
+                                sizeof(FileHeader) + task_cnt*sizeof(Task));
+    attach(store);
+    return result;
+}
+
+
+/**
+ * Convert a data file from before the header existed.
+ * Those files hold raw Task structs as laid out by the compiler then: the
+ * name first, then a 64-bit time_t, padded to 80 bytes. Tasks are given
+ * IDs in file order.
+ * @param file_name name of the data file.
+ * @return 0 if successful, else -1.
+ */
+
+static int convert_legacy_file(const char *file_name) {
+    typedef struct {
+        char t_name[TASK_NAME_MAXLEN];
+        int64_t t_time;
+        uint16_t t_duration_in_mins;
+        uint16_t t_repeat_cnt;
+        uint8_t t_importance_rtn;
+        uint8_t flags;
+        uint8_t padding[2];
+    } LegacyTask;
+    FILE *fp;
+    FILE *fp_tmp;
+    FileHeader header;
+    LegacyTask legacy[CONVERT_BATCH_SIZE];
+    Task tasks[CONVERT_BATCH_SIZE];
+    size_t read_cnt;
+    char *tmp_file_name;
+    int result = SUCCESSFUL;
+    
+    fp = fopen(file_name, "rb");
+    if(fp == NULL) return UNSUCCESSFUL;
+    tmp_file_name = datafilename2sidecar(file_name, TMP_POSTFIX);
+    fp_tmp = fopen(tmp_file_name, "wb");
+    if(fp_tmp == NULL) {
+        fclose(fp);
+        free(tmp_file_name);
+        return UNSUCCESSFUL;
+    }
+    
+    store_init_header(&header);
+    fwrite(&header, sizeof(FileHeader), 1, fp_tmp);
+    while((read_cnt = fread(legacy, sizeof(LegacyTask),
+                            CONVERT_BATCH_SIZE, fp)) > 0) {
+        memset(tasks, 0, read_cnt*sizeof(Task));
+        for(size_t i = 0; i < read_cnt; i++) {
+            tasks[i].t_id = header.next_id++;
+            memcpy(tasks[i].t_name, legacy[i].t_name, TASK_NAME_MAXLEN);
+            tasks[i].t_time = legacy[i].t_time;
+            tasks[i].t_duration_in_mins = legacy[i].t_duration_in_mins;
+            tasks[i].t_repeat_cnt = legacy[i].t_repeat_cnt;
+            tasks[i].t_importance_rtn = legacy[i].t_importance_rtn;
+            tasks[i].flags = legacy[i].flags;
+        }
+        if(fwrite(tasks, sizeof(Task), read_cnt, fp_tmp) != read_cnt)
+            result = UNSUCCESSFUL;
+    }
+    
+    fclose(fp);
+    if(fseek(fp_tmp, 0, SEEK_SET) != 0
+       || fwrite(&header, sizeof(FileHeader), 1, fp_tmp) != 1)
+        result = UNSUCCESSFUL; // with the next ID
+    if(mapfile_sync_stream(fp_tmp) == UNSUCCESSFUL) result = UNSUCCESSFUL;
+    if(fclose(fp_tmp) != 0) result = UNSUCCESSFUL;
+    
+    if(result == SUCCESSFUL)
+        result = replace_file(tmp_file_name, file_name);
+    else
+        remove(tmp_file_name);
+    free(tmp_file_name);
+    
+    return result;
+}
+
+
+/**
+ * Convert a data file of version 1, from before tasks had IDs.
+ * Those records are laid out like Task without t_id, 80 bytes. Tasks are
+ * given IDs in file order. The records of the file's journal are in that
+ * layout too, so they are applied here, then the journal is emptied; the
+ * file is left marked dirty for its index to be rebuilt.
+ * @param file_name name of the data file.
+ * @return 0 if successful, else -1.
+ */
+
+static int convert_v1_file(const char *file_name) {
+    typedef struct {
+        int64_t t_time;
+        uint16_t t_duration_in_mins;
+        uint16_t t_repeat_cnt;
+        uint8_t t_importance_rtn;
+        uint8_t flags;
+        uint8_t t_reserved[2];
+        char t_name[TASK_NAME_MAXLEN];
+    } V1Task;
+    typedef struct {
+        int64_t slot;
+        uint32_t checksum;
+        uint32_t reserved;
+        V1Task task;
+    } V1Record;
+    FILE *fp;
+    FILE *fp_tmp;
+    FileHeader header;
+    V1Task v1[CONVERT_BATCH_SIZE];
+    Task tasks[CONVERT_BATCH_SIZE];
+    V1Record record;
+    size_t read_cnt;
+    long int task_cnt = 0;
+    char *tmp_file_name;
+    char *journal_file_name;
+    int result = SUCCESSFUL;
+    
+    fp = fopen(file_name, "rb");
+    if(fp == NULL) return UNSUCCESSFUL;
+    if(fread(&header, sizeof(FileHeader), 1, fp) != 1) {
+        fclose(fp);
+        return UNSUCCESSFUL;
+    }
+    tmp_file_name = datafilename2sidecar(file_name, TMP_POSTFIX);
+    fp_tmp = fopen(tmp_file_name, "w+b");
+    if(fp_tmp == NULL) {
+        fclose(fp);
+        free(tmp_file_name);
+        return UNSUCCESSFUL;
+    }
+    
+    fwrite(&header, sizeof(FileHeader), 1, fp_tmp); // rewritten below
+    while((read_cnt = fread(v1, sizeof(V1Task), CONVERT_BATCH_SIZE, fp))
+          > 0) {
+        memset(tasks, 0, read_cnt*sizeof(Task));
+        for(size_t i = 0; i < read_cnt; i++) {
+            memcpy(tasks + i, v1 + i, offsetof(V1Task, t_name));
+            memcpy(tasks[i].t_name, v1[i].t_name, TASK_NAME_MAXLEN);
+            tasks[i].t_id = task_cnt + i + 1;
+        }
+        if(fwrite(tasks, sizeof(Task), read_cnt, fp_tmp) != read_cnt)
+            result = UNSUCCESSFUL;
+        task_cnt += read_cnt;
+    }
+    fclose(fp);
+    
+    // Redo the writes of the journal, up to its first torn record:
+    journal_file_name = datafilename2sidecar(file_name, JOURNAL_POSTFIX);
+    fp = fopen(journal_file_name, "rb");
+    while(fp != NULL && result == SUCCESSFUL
+          && fread(&record, sizeof(V1Record), 1, fp) == 1
+          && record.checksum == journal_checksum(record.slot, &record.task,
+                                                 sizeof(V1Task))
+          && record.slot >= 0) {
+        memset(tasks, 0, sizeof(Task));
+        tasks[0].flags = FLAG_DELETED; // slots never written
+        for(; task_cnt < record.slot; task_cnt++)
+            if(fseek(fp_tmp, sizeof(FileHeader) + task_cnt*sizeof(Task),
+                     SEEK_SET) != 0
+               || fwrite(tasks, sizeof(Task), 1, fp_tmp) != 1)
+                result = UNSUCCESSFUL;
+        memcpy(tasks, &record.task, offsetof(V1Task, t_name));
+        memcpy(tasks[0].t_name, record.task.t_name, TASK_NAME_MAXLEN);
+        tasks[0].t_id = record.slot + 1;
+        if(fseek(fp_tmp, sizeof(FileHeader) + record.slot*sizeof(Task),
+                 SEEK_SET) != 0
+           || fwrite(tasks, sizeof(Task), 1, fp_tmp) != 1)
+            result = UNSUCCESSFUL;
+        if(record.slot >= task_cnt) task_cnt = record.slot + 1;
+    }
+    if(fp != NULL) fclose(fp);
+    
+    header.version = FILE_VERSION;
+    header.record_size = sizeof(Task);
+    header.flags |= HEADER_DIRTY;
+    header.next_id = task_cnt + 1;
+    if(fseek(fp_tmp, 0, SEEK_SET) != 0
+       || fwrite(&header, sizeof(FileHeader), 1, fp_tmp) != 1)
+        result = UNSUCCESSFUL;
+    if(mapfile_sync_stream(fp_tmp) == UNSUCCESSFUL) result = UNSUCCESSFUL;
+    if(fclose(fp_tmp) != 0) result = UNSUCCESSFUL;
+    
+    if(result == SUCCESSFUL)
+        result = replace_file(tmp_file_name, file_name);
+    else
+        remove(tmp_file_name);
+    if(result == SUCCESSFUL) { // the journal is in the file now
+        fp = fopen(journal_file_name, "wb");
+        if(fp != NULL) fclose(fp);
+    }
+    free(tmp_file_name);
+    free(journal_file_name);
+    
+    return result;
+}
+
+
+/**
+ * Add a value to a slot's live count in the Fenwick tree.
+ */
+
+static void live_tree_add(TaskStore *store, long int slot, long int delta) {
+    for(long int i = slot + 1; i <= store->task_cnt; i += i & -i)
+        store->live_tree[i] += delta;
+}
+
+
+/**
+ * Number of live records among the first n slots.
+ */
+
+static long int live_tree_prefix(const TaskStore *store, long int n) {
+    long int sum = 0;
+    
+    for(long int i = n; i > 0; i -= i & -i)
+        sum += store->live_tree[i];
+    
+    return sum;
+}
+
+
+/**
+ * Make room in the Fenwick tree and the free list for a number of slots.
+ * @return 0 if successful, else -1.
+ */
+
+static int reserve_slots(TaskStore *store, long int slot_cnt) {
+    long int new_cap;
+    long int *live_tree, *free_slots;
+    
+    if(slot_cnt <= store->live_tree_cap) return SUCCESSFUL;
+    
+    new_cap = store->live_tree_cap ? store->live_tree_cap : 64;
+    while(new_cap < slot_cnt) new_cap *= 2;
+    
+    live_tree = realloc(store->live_tree, (new_cap + 1)*sizeof(long int));
+    if(live_tree == NULL) return UNSUCCESSFUL;
+    store->live_tree = live_tree;
+    free_slots = realloc(store->free_slots, new_cap*sizeof(long int));
+    if(free_slots == NULL) return UNSUCCESSFUL;
+    store->free_slots = free_slots;
+    store->live_tree_cap = new_cap;
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Count live records and collect free slots by scanning the records.
+ * @return 0 if successful, else -1.
+ */
+
+static int scan_slots(TaskStore *store) {
+    long int n = store->task_cnt;
+    
+    if(reserve_slots(store, n) == UNSUCCESSFUL) return UNSUCCESSFUL;
+    
+    store->live_cnt = 0;
+    store->free_cnt = 0;
+    for(long int i = 1; i <= n; i++)
+        store->live_tree[i] = 0;
+    
+    // Build the Fenwick tree in O(n), each node passing its sum upwards:
+    for(long int i = 1; i <= n; i++) {
+        long int parent = i + (i & -i);
+        if(store->tasks[i - 1].flags & FLAG_DELETED)
+            store->free_slots[store->free_cnt++] = i - 1;
+        else {
+            store->live_tree[i]++;
+            store->live_cnt++;
+        }
+        if(parent <= n) store->live_tree[parent] += store->live_tree[i];
+    }
+    
+    return SUCCESSFUL;
+}
+
+
+
+/**
+ * Build the hash indexes of a store, unless they are built already.
+ * @return 0 if successful, else -1.
+ */
+
+static int build_ids(TaskStore *store) {
+    if(store->ids != NULL) return SUCCESSFUL;
+    
+    store->ids = (IdMap *)malloc(sizeof(IdMap));
+    if(store->ids == NULL) return UNSUCCESSFUL;
+    idmap_init(store->ids);
+    if(idmap_build(store->ids, store->tasks, store->task_cnt)
+       == UNSUCCESSFUL) {
+        store_drop_ids(store);
+        return UNSUCCESSFUL;
+    }
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Write a journal record back to the data file, growing it if needed.
+ * @param context store being recovered.
+ * @param record record to write back.
+ * @return 0 if successful, else -1.
+ */
+
+static int apply_record(void *context, const JournalRecord *record) {
+    TaskStore *store = (TaskStore *)context;
+    long int task_cnt = store->task_cnt;
+    
+    if(record->slot < 0) return UNSUCCESSFUL;
+    if(record->slot >= task_cnt) {
+        if(resize(store, record->slot + 1) == UNSUCCESSFUL)
+            return UNSUCCESSFUL;
+        store->task_cnt = record->slot + 1;
+        for(long int i = task_cnt; i < record->slot; i++)
+            store->tasks[i].flags = FLAG_DELETED; // never written
+    }
+    store->tasks[record->slot] = record->task;
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Zero a store, its data, index and lock files marked as not opened so
+ * that closing it again closes nothing.
+ * @param store store in question.
+ */
+
+static void clear_store(TaskStore *store) {
+    memset(store, 0, sizeof(TaskStore));
+    mapfile_clear(&store->file);
+    mapfile_clear(&store->index.file);
+    mapfile_clear_lock(&store->lock);
+}
+
+
+/**
+ * Open a data file for store_open.
+ * Stores opened for reading cannot write their file, so they fail with
+ * NEEDS_WRITING when it does need writing: if it is new, in the old
+ * format, was not closed properly or has a stale index.
+ * @param store place-holder for the opened store.
+ * @param file_name name of the file containing data of tasks.
+ * @param mode STORE_READ or STORE_WRITE, with STORE_WAIT or not.
+ * @return 0 if successful, NEEDS_WRITING, else -1.
+ */
+
+static int open_store(TaskStore *store, const char *file_name, int mode) {
+    FileHeader *header;
+    char *lock_file_name;
+    long int replay_cnt;
+    int writable = mode & STORE_WRITE;
+    int recovering;
+    int result;
+    
+    clear_store(store);
+    
+    // Held until closing, so no other session writes the file meanwhile:
+    lock_file_name = datafilename2sidecar(file_name, LOCK_POSTFIX);
+    result = mapfile_lock(&store->lock, lock_file_name, writable,
+                          mode & STORE_WAIT);
+    free(lock_file_name);
+    if(result == UNSUCCESSFUL) {
+        printf("Error: Data file is in use by another session...\n");
+        return UNSUCCESSFUL;
+    }
+    store->writable = writable;
+    
+    if(mapfile_open(&store->file, file_name, writable) == UNSUCCESSFUL) {
+        store_close(store);
+        if(!writable) return NEEDS_WRITING; // not created yet
+        printf("Error: Unable to open file...\n");
+        return UNSUCCESSFUL;
+    }
+    header = (FileHeader *)store->file.data;
+    
+    if(store->file.size == 0) { // new file, write a header
+        if(!writable) {
+            store_close(store);
+            return NEEDS_WRITING;
+        }
+        if(resize(store, 0) == UNSUCCESSFUL) {
+            printf("Error: Unable to grow file...\n");
+            store_close(store);
+            return UNSUCCESSFUL;
+        }
+        header = (FileHeader *)store->file.data;
+        store_init_header(header);
+    } else if(store->file.size < sizeof(FileHeader)
+              || memcmp(header->magic, FILE_MAGIC, sizeof(FILE_MAGIC))) {
+        // No header, convert from the old format then open again:
+        if(!writable) {
+            store_close(store);
+            return NEEDS_WRITING;
+        }
+        mapfile_close(&store->file);
+        if(convert_legacy_file(file_name) == UNSUCCESSFUL) {
+            printf("Error: Invalid file structure...\n");
+            store_close(store);
+            return UNSUCCESSFUL;
+        }
+        store_close(store);
+        return open_store(store, file_name, mode);
+    }
+    
+    if(header->version < FILE_VERSION) {
+        // Tasks without IDs, convert them then open again:
+        if(!writable) {
+            store_close(store);
+            return NEEDS_WRITING;
+        }
+        mapfile_close(&store->file);
+        if(convert_v1_file(file_name) == UNSUCCESSFUL) {
+            printf("Error: Unable to convert file...\n");
+            store_close(store);
+            return UNSUCCESSFUL;
+        }
+        store_close(store);
+        return open_store(store, file_name, mode);
+    }
+    
+    if(header->version > FILE_VERSION
+       || header->record_size != sizeof(Task)
+       || (store->file.size - sizeof(FileHeader))%sizeof(Task)) {
+        printf("Error: Invalid file structure...\n");
+        store_close(store);
+        return UNSUCCESSFUL;
+    }
+    
+    attach(store);
+    store->generation = store_next_generation();
+    store->task_cnt = (store->file.size - sizeof(FileHeader))/sizeof(Task);
+    store->file_name = (char *)malloc(strlen(file_name) + 1);
+    strcpy(store->file_name, file_name);
+    
+    if(writable) {
+        // Redo the writes of a previous run which may have been lost:
+        if(journal_open(&store->journal, file_name) == UNSUCCESSFUL) {
+            printf("Error: Unable to open journal file...\n");
+            store_close(store);
+            return UNSUCCESSFUL;
+        }
+        replay_cnt = journal_replay(&store->journal, apply_record, store);
+        if(replay_cnt == UNSUCCESSFUL) {
+            printf("Error: Unable to replay journal file...\n");
+            store_close(store);
+            return UNSUCCESSFUL;
+        }
+        recovering = replay_cnt > 0 || store->header->flags & HEADER_DIRTY;
+        if(recovering) {
+            store->header->next_expiry = 0; // recompute it
+            
+            // IDs given since the last checkpoint may be missing from it:
+            for(long int i = 0; i < store->task_cnt; i++)
+                if(store->tasks[i].t_id >= store->header->next_id)
+                    store->header->next_id = store->tasks[i].t_id + 1;
+        }
+        store->header->flags |= HEADER_DIRTY;
+    } else if(journal_pending(file_name) > 0
+              || store->header->flags & HEADER_DIRTY) {
+        store_close(store);
+        return NEEDS_WRITING;
+    } else
+        recovering = 0;
+    
+    if(scan_slots(store) == UNSUCCESSFUL
+       || columns_build(&store->cols, store->tasks, store->task_cnt)
+          == UNSUCCESSFUL) {
+        printf("Error: Out of memory...\n");
+        store_close(store);
+        return UNSUCCESSFUL;
+    }
+    
+    if(index_open(&store->index, file_name, store->tasks, store->task_cnt,
+                  store->header->flags & HEADER_BTREE ? INDEX_BTREE
+                                                      : INDEX_ARRAY,
+                  writable) == UNSUCCESSFUL) {
+        store_close(store);
+        if(!writable) return NEEDS_WRITING;
+        printf("Error: Unable to open index file...\n");
+        return UNSUCCESSFUL;
+    }
+    
+    if(recovering
+       && (store_reindex(store) == UNSUCCESSFUL
+           || store_sync(store) == UNSUCCESSFUL)) {
+        printf("Error: Unable to recover file...\n");
+        store_close(store);
+        return UNSUCCESSFUL;
+    }
+    
+    return SUCCESSFUL;
+}
+
+// ---------------------------------------------------------------------------
+// Store functions
+
+/**
+ * Open a data file and map its records, creating the file if needed.
+ * The file is locked until the store is closed: shared between sessions
+ * reading it, or held by the only session writing it.
+ * @param store place-holder for the opened store.
+ * @param file_name name of the file containing data of tasks.
+ * @param mode STORE_READ or STORE_WRITE, with STORE_WAIT or not.
+ * @return 0 if successful, else -1.
+ */
+
+int store_open(TaskStore *store, const char *file_name, int mode) {
+    int result = open_store(store, file_name, mode);
+    
+    if(result != NEEDS_WRITING) return result;
+    
+    // Let a writing session bring the file up to date, then read it:
+    if(open_store(store, file_name, STORE_WRITE | (mode & STORE_WAIT))
+       == UNSUCCESSFUL)
+        return UNSUCCESSFUL;
+    store_close(store);
+    if(open_store(store, file_name, mode) != SUCCESSFUL) {
+        printf("Error: Unable to open file...\n");
+        return UNSUCCESSFUL;
+    }
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Flush and close a store.
+ * @param store store to close.
+ */
+
+void store_close(TaskStore *store) {
+    if(store->header != NULL && store->journal.fp != NULL) {
+        store->header->flags &= ~HEADER_DIRTY;
+        store_sync(store);
+    }
+    journal_close(&store->journal);
+    store_drop_collisions(store);
+    store_drop_ids(store);
+    index_close(&store->index);
+    columns_free(&store->cols);
+    mapfile_close(&store->file);
+    mapfile_unlock(&store->lock);
+    free(store->file_name);
+    free(store->live_tree);
+    free(store->free_slots);
+    clear_store(store);
+}
+
+
+/**
+ * Add a task to the store, reusing the slot of a deleted task if any.
+ * @param store store to add to.
+ * @param task task to add.
+ * @return slot of the added task if successful, else -1.
+ */
+
+long int store_add(TaskStore *store, const Task *task) {
+    Task record;
+    long int slot;
+    
+    if(!store->writable) return UNSUCCESSFUL;
+    if(store->free_cnt > 0) {
+        slot = store->free_slots[--store->free_cnt];
+        store_drop_collisions(store); // still holds the deleted task
+    } else {
+        slot = store->task_cnt;
+        if(reserve_slots(store, slot + 1) == UNSUCCESSFUL
+           || columns_reserve(&store->cols, slot + 1) == UNSUCCESSFUL) {
+            printf("Error: Out of memory...\n");
+            return UNSUCCESSFUL;
+        }
+        if(resize(store, slot + 1) == UNSUCCESSFUL) {
+            printf("Error: Unable to grow file...\n");
+            return UNSUCCESSFUL;
+        }
+        store->task_cnt++;
+        
+        // Node of the new slot covers (slot + 1 - lowbit, slot + 1]:
+        store->live_tree[slot + 1] =
+            live_tree_prefix(store, slot)
+            - live_tree_prefix(store, slot + 1 - ((slot + 1) & -(slot + 1)));
+    }
+    
+    record = *task;
+    record.flags &= ~FLAG_DELETED;
+    record.t_id = store->header->next_id++;
+    if(store_put_slot(store, slot, &record) == UNSUCCESSFUL)
+        return UNSUCCESSFUL;
+    live_tree_add(store, slot, 1);
+    store->live_cnt++;
+    
+    if(index_insert(&store->index, store->tasks + slot, slot, store->task_cnt)
+       == UNSUCCESSFUL)
+        return UNSUCCESSFUL;
+    
+    return slot;
+}
+
+
+/**
+ * Mark a task as deleted, its slot will be reused by store_add.
+ * @param store store to delete from.
+ * @param slot slot of the task.
+ * @return 0 if successful, else -1.
+ */
+
+int store_tombstone(TaskStore *store, long int slot) {
+    Task old_task;
+    Task record;
+    
+    if(!store->writable || slot < 0 || slot >= store->task_cnt)
+        return UNSUCCESSFUL;
+    old_task = store->tasks[slot];
+    if(old_task.flags & FLAG_DELETED) return UNSUCCESSFUL;
+    
+    // Deleted tasks are inactive, so every query skips them:
+    record = old_task;
+    record.flags = (record.flags | FLAG_DELETED) & ~FLAG_ACTIVE;
+    if(store_put_slot(store, slot, &record) == UNSUCCESSFUL)
+        return UNSUCCESSFUL;
+    live_tree_add(store, slot, -1);
+    store->live_cnt--;
+    store->free_slots[store->free_cnt++] = slot;
+    
+    // The index is only changed once the tombstone is written, and rebuilt
+    // from the records if removing the task fails:
+    if(index_remove(&store->index, &old_task, slot, store->task_cnt)
+       == UNSUCCESSFUL)
+        return store_reindex(store);
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Drop all deleted tasks from the file, keeping the others in order so
+ * their numbering does not change.
+ * The live tasks are written to a new file which then replaces the data
+ * file, so a crash leaves either file whole.
+ * @param store store to compact.
+ * @return 0 if successful, else -1.
+ */
+
+int store_compact(TaskStore *store) {
+    FILE *fp;
+    char *tmp_file_name;
+    int result = SUCCESSFUL;
+    
+    if(!store->writable) return UNSUCCESSFUL;
+    
+    // The journal refers to slots before compaction, empty it first:
+    if(store_sync(store) == UNSUCCESSFUL) return UNSUCCESSFUL;
+    
+    // Only the session holding the lock writes it, other users have theirs:
+    tmp_file_name = datafilename2sidecar(store->file_name, TMP_POSTFIX);
+    fp = fopen(tmp_file_name, "wb");
+    if(fp == NULL) {
+        free(tmp_file_name);
+        return UNSUCCESSFUL;
+    }
+    if(fwrite(store->header, sizeof(FileHeader), 1, fp) != 1)
+        result = UNSUCCESSFUL;
+    for(long int i = 0; i < store->task_cnt; i++)
+        if(!(store->cols.flags[i] & FLAG_DELETED)
+           && fwrite(store->tasks + i, sizeof(Task), 1, fp) != 1)
+            result = UNSUCCESSFUL;
+    if(mapfile_sync_stream(fp) == UNSUCCESSFUL) result = UNSUCCESSFUL;
+    if(fclose(fp) != 0) result = UNSUCCESSFUL;
+    
+    if(result == UNSUCCESSFUL) {
+        remove(tmp_file_name);
+        free(tmp_file_name);
+        return UNSUCCESSFUL;
+    }
+    
+    // Files are swapped while unmapped, Windows cannot replace mapped ones:
+    mapfile_close(&store->file);
+    if(replace_file(tmp_file_name, store->file_name) == UNSUCCESSFUL) {
+        remove(tmp_file_name);
+        result = UNSUCCESSFUL;
+    }
+    free(tmp_file_name);
+    if(mapfile_open(&store->file, store->file_name, 1) == UNSUCCESSFUL) {
+        printf("Error: Unable to reopen file...\n");
+        store->header = NULL;
+        store->tasks = NULL;
+        store->task_cnt = 0;
+        return UNSUCCESSFUL;
+    }
+    attach(store);
+    store->task_cnt = (store->file.size - sizeof(FileHeader))/sizeof(Task);
+    
+    // Slots have moved:
+    store_drop_collisions(store);
+    store_drop_ids(store);
+    if(scan_slots(store) == UNSUCCESSFUL
+       || columns_build(&store->cols, store->tasks, store->task_cnt)
+          == UNSUCCESSFUL
+       || store_reindex(store) == UNSUCCESSFUL)
+        return UNSUCCESSFUL;
+    
+    return result;
+}
+
+
+/**
+ * Find the slot of a live task from its number.
+ * @param store store to search.
+ * @param index number of live tasks before the task in question.
+ * @return slot of the task, -1 if there is no such task.
+ */
+
+long int store_slot(const TaskStore *store, long int index) {
+    long int slot = 0;
+    long int step = 1;
+    
+    if(index < 0 || index >= store->live_cnt) return UNSUCCESSFUL;
+    
+    // Descend the Fenwick tree for the (index + 1)-th live slot:
+    while(2*step <= store->task_cnt) step *= 2;
+    for(index++; step > 0; step /= 2)
+        if(slot + step <= store->task_cnt
+           && store->live_tree[slot + step] < index) {
+            slot += step;
+            index -= store->live_tree[slot];
+        }
+    
+    return slot;
+}
+
+
+/**
+ * Find the number of a live task from its slot, the inverse of store_slot.
+ * @param store store to search.
+ * @param slot slot of the task.
+ * @return number of live tasks before the slot.
+ */
+
+long int store_index(const TaskStore *store, long int slot) {
+    return live_tree_prefix(store, slot);
+}
+
+
+/**
+ * Write records of the store. Their new contents are appended to the
+ * journal, which is flushed to disk before the mapped records change, so
+ * the data file never holds a write the journal could not redo; the
+ * columns and hash indexes are then updated. A checkpoint is taken once
+ * the journal is long enough.
+ * @param store store written to.
+ * @param slots slots written, each at most once.
+ * @param tasks new contents of the slots.
+ * @param task_cnt number of slots, at most JOURNAL_GROUP_SIZE to keep
+ *                 the journal flushed in groups.
+ * @return 0 if successful, else -1.
+ */
+
+int store_put_slots(TaskStore *store,
+                    const long int *slots,
+                    const Task *tasks,
+                    int task_cnt) {
+    if(!store->writable) return UNSUCCESSFUL;
+    for(int i = 0; i < task_cnt; i++)
+        if(journal_append(&store->journal, slots[i], tasks + i)
+           == UNSUCCESSFUL) {
+            printf("Error: Unable to write journal file...\n");
+            return UNSUCCESSFUL;
+        }
+    if(journal_commit(&store->journal) == UNSUCCESSFUL) {
+        printf("Error: Unable to write journal file...\n");
+        return UNSUCCESSFUL;
+    }
+    
+    for(int i = 0; i < task_cnt; i++) {
+        long int slot = slots[i];
+        store->tasks[slot] = tasks[i];
+        columns_set(&store->cols, slot, store->tasks + slot);
+        if(store->ids != NULL
+           && idmap_set(store->ids, slot, store->tasks + slot)
+              == UNSUCCESSFUL)
+            store_drop_ids(store); // out of memory, rebuilt on next use
+    }
+    store->generation = store_next_generation();
+    
+    if(store->journal.record_cnt >= JOURNAL_CHECKPOINT_SIZE)
+        return store_sync(store);
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Write a record of the store, as store_put_slots.
+ * @param store store written to.
+ * @param slot slot written.
+ * @param task new contents of the slot.
+ * @return 0 if successful, else -1.
+ */
+
+int store_put_slot(TaskStore *store, long int slot, const Task *task) {
+    return store_put_slots(store, &slot, task, 1);
+}
+
+
+/**
+ * Take a checkpoint: flush the mapped records and index to disk, then
+ * empty the journal which they now include.
+ * @param store store to flush.
+ * @return 0 if successful, else -1.
+ */
+
+int store_sync(TaskStore *store) {
+    if(mapfile_sync(&store->file) == UNSUCCESSFUL
+       || index_sync(&store->index) == UNSUCCESSFUL)
+        return UNSUCCESSFUL;
+    return journal_reset(&store->journal);
+}
+
+
+/**
+ * Get a new generation number, never returned before by this process.
+ * Stores and views take one whenever their contents change, so anything
+ * derived from them can tell whether it is stale.
+ * @return the generation number.
+ */
+
+uint64_t store_next_generation(void) {
+    static _Atomic uint64_t generation = 0; // stores may be on any thread
+    return atomic_fetch_add(&generation, 1) + 1;
+}
+
+
+/**
+ * Set the watermark of a store, kept in the file's header.
+ * @param store store whose watermark is to be set.
+ * @param next_expiry earliest end time among the store's active tasks.
+ * @return 0 if successful, else -1.
+ */
+
+int store_set_next_expiry(TaskStore *store, time_t next_expiry) {
+    if(!store->writable) return UNSUCCESSFUL;
+    store->header->next_expiry = next_expiry;
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Fill in the header of an empty data file.
+ * @param header place-holder for the header.
+ */
+
+void store_init_header(FileHeader *header) {
+    memset(header, 0, sizeof(FileHeader));
+    memcpy(header->magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+    header->version = FILE_VERSION;
+    header->record_size = sizeof(Task);
+    header->next_id = 1;
+}
+
+
+/**
+ * Rebuild the index of a store after its tasks changed in place.
+ * @param store store whose index is to be rebuilt.
+ * @return 0 if successful, else -1.
+ */
+
+int store_reindex(TaskStore *store) {
+    if(!store->writable) return UNSUCCESSFUL;
+    store->generation = store_next_generation();
+    return index_rebuild(&store->index, store->tasks, store->task_cnt);
+}
+
+
+/**
+ * Move a task written in place to its new position in the index, after
+ * its start time or activity changed. Cheaper than store_reindex with the
+ * B+-tree engine, O(log n) against O(n).
+ * @param store store whose index is to be updated.
+ * @param slot slot of the task.
+ * @param old_task the task as it was before being written.
+ * @return 0 if successful, else -1.
+ */
+
+int store_reorder(TaskStore *store, long int slot, const Task *old_task) {
+    if(!store->writable || slot < 0 || slot >= store->task_cnt)
+        return UNSUCCESSFUL;
+    store->generation = store_next_generation();
+    if(index_remove(&store->index, old_task, slot, store->task_cnt)
+       == UNSUCCESSFUL)
+        return UNSUCCESSFUL;
+    return index_insert(&store->index, store->tasks + slot, slot,
+                        store->task_cnt);
+}
+
+
+/**
+ * Switch a store's index to another engine, kept for later sessions. The
+ * new index is built from the records, the old one is deleted.
+ * @param store store whose index is to be switched.
+ * @param engine INDEX_ARRAY or INDEX_BTREE.
+ * @return 0 if successful, else -1.
+ */
+
+int store_set_engine(TaskStore *store, int engine) {
+    char *old_file_name, *new_file_name;
+    int result;
+    
+    if(!store->writable) return UNSUCCESSFUL;
+    if(engine == store->index.engine) return SUCCESSFUL;
+    
+    old_file_name = datafilename2sidecar(store->file_name,
+                                         engine == INDEX_BTREE
+                                         ? INDEX_POSTFIX : BTREE_POSTFIX);
+    new_file_name = datafilename2sidecar(store->file_name,
+                                         engine == INDEX_BTREE
+                                         ? BTREE_POSTFIX : INDEX_POSTFIX);
+    
+    // A left over file of the new engine is out of date, start afresh:
+    index_close(&store->index);
+    remove(new_file_name);
+    free(new_file_name);
+    result = index_open(&store->index, store->file_name, store->tasks,
+                        store->task_cnt, engine, 1);
+    if(result == UNSUCCESSFUL) {
+        printf("Error: Unable to build index file...\n");
+        free(old_file_name);
+        return UNSUCCESSFUL;
+    }
+    store->generation = store_next_generation();
+    
+    if(engine == INDEX_BTREE)
+        store->header->flags |= HEADER_BTREE;
+    else
+        store->header->flags &= ~HEADER_BTREE;
+    remove(old_file_name);
+    free(old_file_name);
+    
+    return store_sync(store);
+}
+
+
+/**
+ * Free the collision index of a store, it is rebuilt on next use.
+ * @param store store whose collision index is to be dropped.
+ */
+
+void store_drop_collisions(TaskStore *store) {
+    if(store->collisions == NULL) return;
+    collision_free(store->collisions);
+    free(store->collisions);
+    store->collisions = NULL;
+}
+
+
+/**
+ * Find the slot of a task from its ID, in O(1) through the store's hash
+ * indexes, which are built on first use.
+ * @param store store to search.
+ * @param id ID of the task.
+ * @return slot of the task, -1 if there is no such task.
+ */
+
+long int store_find_id(TaskStore *store, uint64_t id) {
+    if(build_ids(store) == UNSUCCESSFUL) return UNSUCCESSFUL;
+    return idmap_find(store->ids, id);
+}
+
+
+/**
+ * Find the slots of the tasks named exactly so, through the store's hash
+ * indexes, which are built on first use.
+ * @param store store to search.
+ * @param name name in question.
+ * @param slots place-holder for the slots found, in no particular order.
+ * @param max_cnt most slots to write.
+ * @return number of such tasks, which may exceed max_cnt, -1 if
+ *         unsuccessful.
+ */
+
+int store_find_name(TaskStore *store,
+                    const char *name,
+                    long int *slots,
+                    int max_cnt) {
+    if(build_ids(store) == UNSUCCESSFUL) return UNSUCCESSFUL;
+    return idmap_find_name(store->ids, store->tasks, name, slots, max_cnt);
+}
+
+
+/**
+ * Free the hash indexes of a store, they are rebuilt on next use.
+ * @param store store whose hash indexes are to be dropped.
+ */
+
+void store_drop_ids(TaskStore *store) {
+    if(store->ids == NULL) return;
+    idmap_free(store->ids);
+    free(store->ids);
+    store->ids = NULL;
+}
+
+
+/**
+ * Delete a data file together with its sidecar files.
+ * @param file_name name of the data file.
+ */
+
+void store_unlink(const char *file_name) {
+    const char *postfixes[] = {INDEX_POSTFIX, BTREE_POSTFIX, JOURNAL_POSTFIX,
+                               LOCK_POSTFIX};
+    
+    remove(file_name);
+    for(size_t i = 0; i < sizeof(postfixes)/sizeof(postfixes[0]); i++) {
+        char *sidecar = datafilename2sidecar(file_name, postfixes[i]);
+        remove(sidecar);
+        free(sidecar);
+    }
+}
+
+
+/**
+ * Make a view of all live tasks of a store.
+ * @param view place-holder for the view.
+ * @param store opened data file.
+ */
+
+void store_view_all(TaskView *view, const TaskStore *store) {
+    view->store = store;
+    view->slots = NULL;
+    view->slot_cnt = 0;
+    view->generation = 0;
+}
+
+
+/**
+ * Get the number of tasks in a view.
+ * @param view the view in question.
+ * @return number of tasks.
+ */
+
+long int store_view_cnt(const TaskView *view) {
+    return view->slots ? view->slot_cnt : view->store->live_cnt;
+}
+
+
+/**
+ * Find the slot of a task from its number in a view.
+ * @param view view to search.
+ * @param index number of tasks of the view before the task in question.
+ * @return slot of the task, -1 if there is no such task.
+ */
+
+long int store_view_slot(const TaskView *view, long int index) {
+    if(view->slots == NULL) return store_slot(view->store, index);
+    if(index < 0 || index >= view->slot_cnt) return UNSUCCESSFUL;
+    return view->slots[index];
+}
+
+
+/**
+ * Get the generation of a view's selection.
+ * @param view the view in question.
+ * @return the generation, 0 for all live tasks of a store.
+ */
+
+uint64_t store_view_generation(const TaskView *view) {
+    return view->slots ? view->generation : 0;
+}
+
+
+/**
+ * Free the memory held by a view, it then shows all live tasks.
+ * @param view view to free.
+ */
+
+void store_view_free(TaskView *view) {
+    free(view->slots);
+    view->slots = NULL;
+    view->slot_cnt = 0;
+    view->generation = 0;
+}
+
+
+/**
+ * Start reading a view from one of its tasks.
+ * @param cursor place-holder for the cursor.
+ * @param view view to read.
+ * @param index number of the first task read.
+ */
+
+void store_cursor_init(TaskCursor *cursor,
+                       const TaskView *view,
+                       long int index) {
+    cursor->view = view;
+    cursor->index = index;
+    cursor->slot = UNSUCCESSFUL;
+}
+
+
+/**
+ * Read the next tasks of a view into a buffer, and move past them.
+ * @param cursor position in the view.
+ * @param buffer place-holder for the tasks, reused between calls.
+ * @param buffer_size maximum number of tasks to read.
+ * @return number of tasks read, 0 at the end of the view, -1 if the
+ *         cursor is out of the view.
+ */
+
+int store_cursor_read(TaskCursor *cursor, Task *buffer, int buffer_size) {
+    const TaskView *view = cursor->view;
+    const TaskStore *store = view->store;
+    long int task_cnt = store_view_cnt(view);
+    int read_cnt;
+    
+    if(cursor->index < 0 || cursor->index > task_cnt || buffer_size < 0)
+        return UNSUCCESSFUL;
+    
+    read_cnt = task_cnt - cursor->index < buffer_size
+               ? (int)(task_cnt - cursor->index)
+               : buffer_size;
+    if(read_cnt == 0) return 0;
+    
+    if(view->slots != NULL) {
+        for(int i = 0; i < read_cnt; i++)
+            buffer[i] = store->tasks[view->slots[cursor->index + i]];
+    } else {
+        long int slot = cursor->slot;
+        
+        if(slot == UNSUCCESSFUL) slot = store_slot(store, cursor->index);
+        for(int i = 0; i < read_cnt; slot++)
+            if(!(store->cols.flags[slot] & FLAG_DELETED))
+                buffer[i++] = store->tasks[slot];
+        cursor->slot = slot;
+    }
+    cursor->index += read_cnt;
+    
+    return read_cnt;
+}
@@ -0,0 +1,195 @@
+/**
+ * Memory-mapped task store.
+ * Map a user's data file once and expose its records as a Task array, so
+ * every query and mutation in task.c runs against memory instead of
+ * re-opening and re-reading the file.
+ */
+
+#ifndef STORE_H
+#define STORE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "task.h"
+#include "utils.h"
+#include "mapfile.h"
+#include "index.h"
+#include "columns.h"
+#include "collision.h"
+#include "journal.h"
+#include "idmap.h"
+
+// ---------------------------------------------------------------------------
+// Module constants
+
+/**
+ * Data files start with a header identifying their format, followed by the
+ * records. Files without it are from before the header existed, and files
+ * of an older version are from before tasks had IDs; both are converted
+ * when opened.
+ */
+#define FILE_MAGIC "EZTASK"
+#define FILE_VERSION 2 /* 1 had no task IDs */
+
+/**
+ * Header flag set while a store is opened. Found set on opening, it means
+ * the file was not closed properly: the watermark and index sidecar may
+ * then be out of date with the records.
+ */
+#define HEADER_DIRTY 0x01
+
+/**
+ * Header flag selecting the B+-tree engine for the index sidecar, the
+ * sorted array engine is used without it.
+ */
+#define HEADER_BTREE 0x02
+
+/**
+ * Deleted tasks are only marked with FLAG_DELETED. The file is compacted
+ * once tombstones make up half of it, and there are at least this many.
+ */
+#define COMPACT_MIN_TOMBSTONES 64
+
+/**
+ * Records read per call when converting old files.
+ */
+#define CONVERT_BATCH_SIZE 256
+
+/**
+ * Sidecar files of a data file, besides its index and journal. New files
+ * are written to the temporary one, then replace the data file. The lock
+ * file is never replaced, so it can hold the lock of the data file.
+ */
+#define TMP_POSTFIX "_tmp"
+#define LOCK_POSTFIX "_lock"
+
+/**
+ * Modes of store_open, STORE_WAIT may be or-ed with either of the others.
+ * Any number of sessions may read a data file at once, a session writing
+ * it excludes all others. Sessions fail at once if the file is in use,
+ * unless they wait.
+ */
+#define STORE_READ 0x00
+#define STORE_WRITE 0x01
+#define STORE_WAIT 0x02
+
+// ---------------------------------------------------------------------------
+// FileHeader struct
+// First 64 bytes of a data file, so records start on a cache line.
+
+typedef struct {
+    char magic[8]; // FILE_MAGIC, zero padded
+    uint32_t version; // FILE_VERSION of the writer
+    uint32_t record_size; // sizeof(Task) of the writer
+    int64_t next_expiry; // earliest end time of active tasks, 0 if unknown
+    uint32_t flags; // HEADER_DIRTY while opened, HEADER_BTREE
+    uint32_t reserved_flags; // must be zero
+    uint64_t next_id; // ID of the next task added, from 1
+    uint8_t reserved[24]; // must be zero
+} FileHeader;
+
+_Static_assert(sizeof(FileHeader) == 64, "FileHeader must be 64 bytes");
+
+// ---------------------------------------------------------------------------
+// TaskStore struct
+// Handle of an opened data file and its sidecars. tasks points into the
+// mapping and is only valid until the next mutation (adding/compacting may
+// remap the file).
+// Records are addressed by slot, their position in the file, which never
+// changes until compaction. Users see live tasks only, numbered in file
+// order; live_tree (a Fenwick tree over live slots) maps those numbers to
+// slots in O(log n).
+// Records are only written through store_put_slot(s), which journals them
+// before changing the mapping and keeps cols, the fields queries filter
+// on, in sync.
+// Stores opened for reading are mapped read-only, and fail every mutation.
+
+typedef struct TaskStore {
+    char *file_name; // name of the mapped file
+    MappedFile file; // the data file
+    FileHeader *header; // mapped header
+    Task *tasks; // mapped records, following the header
+    long int task_cnt; // number of records (slots) in the file
+    long int live_cnt; // number of records not deleted
+    long int *live_tree; // live counts, 1-based Fenwick tree over slots
+    long int live_tree_cap; // capacity of live_tree, in slots
+    long int *free_slots; // slots of deleted records, to be reused
+    long int free_cnt; // number of free slots
+    TaskColumns cols; // hot fields of the records, by slot
+    TaskIndex index; // active tasks ordered by start time
+    Journal journal; // records written since the last checkpoint
+    CollisionIndex *collisions; // built on first use, NULL until then
+    IdMap *ids; // tasks by ID and name, built on first use, NULL until then
+    uint64_t generation; // changes whenever a record is written
+    FileLock lock; // lock of the data file, held while opened
+    int writable; // 0 if opened for reading only
+} TaskStore;
+
+// ---------------------------------------------------------------------------
+// TaskView struct
+// Tasks of a store selected by a query, numbered like the store's live
+// tasks. Views hold slots, not copies, so they are only valid until the
+// store is next mutated.
+
+typedef struct TaskView {
+    const TaskStore *store; // store the tasks are in
+    long int *slots; // selected slots in file order, NULL for all live tasks
+    long int slot_cnt; // number of selected slots
+    uint64_t generation; // changes whenever the selection does
+} TaskView;
+
+// ---------------------------------------------------------------------------
+// TaskCursor struct
+// Position in a view, for reading its tasks in batches. Tasks of a view of
+// all live tasks are found by walking slots past the tombstones, so reading
+// n tasks costs O(n) rather than n slot lookups.
+
+typedef struct {
+    const TaskView *view; // view being read
+    long int index; // number of the next task in the view
+    long int slot; // slot of the next task, -1 if not found yet
+} TaskCursor;
+
+// ---------------------------------------------------------------------------
+// Functions Prototypes
+
+int store_open(TaskStore *store, const char *file_name, int mode);
+void store_close(TaskStore *store);
+long int store_add(TaskStore *store, const Task *task);
+int store_tombstone(TaskStore *store, long int slot);
+int store_compact(TaskStore *store);
+long int store_slot(const TaskStore *store, long int index);
+long int store_index(const TaskStore *store, long int slot);
+int store_put_slots(TaskStore *store,
+                    const long int *slots,
+                    const Task *tasks,
+                    int task_cnt);
+int store_put_slot(TaskStore *store, long int slot, const Task *task);
+int store_sync(TaskStore *store);
+uint64_t store_next_generation(void);
+int store_set_next_expiry(TaskStore *store, time_t next_expiry);
+void store_init_header(FileHeader *header);
+int store_reindex(TaskStore *store);
+int store_reorder(TaskStore *store, long int slot, const Task *old_task);
+int store_set_engine(TaskStore *store, int engine);
+void store_drop_collisions(TaskStore *store);
+long int store_find_id(TaskStore *store, uint64_t id);
+int store_find_name(TaskStore *store,
+                    const char *name,
+                    long int *slots,
+                    int max_cnt);
+void store_drop_ids(TaskStore *store);
+void store_unlink(const char *file_name);
+void store_view_all(TaskView *view, const TaskStore *store);
+long int store_view_cnt(const TaskView *view);
+long int store_view_slot(const TaskView *view, long int index);
+uint64_t store_view_generation(const TaskView *view);
+void store_view_free(TaskView *view);
+void store_cursor_init(TaskCursor *cursor,
+                       const TaskView *view,
+                       long int index);
+int store_cursor_read(TaskCursor *cursor, Task *buffer, int buffer_size);
+
+#endif
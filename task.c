@@ -1,4 +1,8 @@
 #include "task.h"
+#include "store.h"
+#include "collision.h"
+#include "filter.h"
+#include "rank.h"
 
 // ---------------------------------------------------------------------------
 // Task struct basic functions
@@ -14,6 +18,19 @@ time_t get_end_time(const Task *task) {
 }
 
 
+/**
+ * Get the time between two occurrences of a recurrent task.
+ * @param task the task in question.
+ * @return a day or a week for recurrent tasks, 0 for one-time tasks.
+ */
+ 
+time_t get_period(const Task *task) {
+    if(task->flags & FLAG_DAILY) return SECS_PER_DAY;
+    if(task->flags & FLAG_WEEKLY) return SECS_PER_WEEK;
+    return 0;
+}
+
+
 /**
  * Task struct basic data entry.
  * @param task where entered data reside.
@@ -26,7 +43,8 @@ void input_task(Task *task) {
     task->t_importance_rtn = (uint8_t)temp;
     printf("Repeated: "); scanf("%d", &temp);
     task->t_repeat_cnt = (uint16_t)temp;
-    printf("Time (secs from 1/1/1900): "); scanf("%d", &task->t_time);
+    printf("Time (secs from 1/1/1900): "); scanf("%d", &temp);
+    task->t_time = temp;
     printf("Duration (minutes): "); scanf("%d", &temp);
     task->t_duration_in_mins = (uint16_t)temp;
     printf("Flags: "); scanf("%d", &task->flags);
@@ -39,12 +57,14 @@ void input_task(Task *task) {
  */
 
 void print_task(const Task *task) {
+    time_t t_start = task->t_time;
     time_t t_end = get_end_time(task);
+    char start_str[TIME_STR_LEN], end_str[TIME_STR_LEN];
     
     printf("\nTask: %s\n", task->t_name);
     printf("Importance: %d\n", task->t_importance_rtn);
-    printf("Time: from %s ", time2str(&task->t_time));
-    printf("to %s\n", time2str(&t_end));
+    printf("Time: from %s ", time2str(&t_start, start_str));
+    printf("to %s\n", time2str(&t_end, end_str));
     printf("Repeated %d times\n", task->t_repeat_cnt);
     printf("Active: %s\n", (task->flags & FLAG_ACTIVE)?"Yes":"No");
     printf("Daily: %s\n", (task->flags & FLAG_DAILY)?"Yes":"No");
@@ -56,391 +76,730 @@ void print_task(const Task *task) {
 
 /**
  * Update task based on current time and it's flags.
+ * @param task the task being checked.
+ */
+ 
+void update_task(Task *task) {
+    update_task_at(task, time(NULL));
+}
+
+
+/**
+ * Update task based on a reference time and it's flags.
  * Check if task's time has passed,
  * update it based on whether it's daily, weekly or one-time.
+ * Recurrent tasks skip all passed periods in one step, no matter how long
+ * they have been dormant.
  * @param task the task being checked.
  * @param now time of type time_t used as reference.
  */
  
-void update_task(Task *task) {
-    time_t now;
+void update_task_at(Task *task, time_t now) {
+    time_t period;
+    time_t periods_passed;
     
-    time(&now); // get current time
     if(now<get_end_time(task)) // compare with target date
         return;
-        
+    
     // Task has passed, check if it is recurrent (daily or weekly):
     
-    if(task->flags & FLAG_DAILY)
-        while(now>=get_end_time(task)) { // make next time arrangement
-            task->t_time += SECS_PER_DAY;
-            task->t_repeat_cnt++; // add 1 to repeated times
-        }
-    else if(task->flags & FLAG_WEEKLY)
-        while(now>=get_end_time(task)) {
-            task->t_time += SECS_PER_WEEK;
-            task->t_repeat_cnt++;
-        }
-    else // a one-time job, deactivate it
+    period = get_period(task);
+    if(!period) { // a one-time job, deactivate it
         task->flags &= ~FLAG_ACTIVE; // deactivate task
+        return;
+    }
+    
+    // Make next time arrangement: the first period ending after now.
+    periods_passed = (now - get_end_time(task))/period + 1;
+    task->t_time += periods_passed*period;
+    task->t_repeat_cnt += (uint16_t)periods_passed; // add to repeated times
 }
 
 // ---------------------------------------------------------------------------
 // File manipulation functions
+// All of them work on an opened TaskStore, whose records are mapped once.
 
 /**
- * Open tasks file, return an integer.
- * @param file_name name of the file containing data of tasks.
- * @return number of tasks if successful, else -1.
+ * Get the number of tasks in the store, return an integer.
+ * @param store opened data file.
+ * @return number of tasks, deleted ones excluded.
  */
  
-long int get_task_cnt(const char *file_name) {
-    FILE *fp;
-    long int file_size;
-    
-    fp = fopen(file_name, "rb");
-    if(fp == NULL) return UNSUCCESSFUL;
-    
-    fseek(fp, 0, SEEK_END);
-    file_size = ftell(fp);
-    fclose(fp);
+long int get_task_cnt(const TaskStore *store) {
+    return store->live_cnt;
+}
+
+
+/**
+ * Save task onto hard disk, return an integer.
+ * @param task task to save, given its new ID.
+ * @param store opened data file.
+ * @return 0 is successful, else -1.
+ */
+
+int save_task(Task *task, TaskStore *store) {
+    time_t next_expiry = store->header->next_expiry;
+    long int slot;
     
-    if(file_size%sizeof(Task)) {
-        printf("Error: Invalid file structure...\n");
+    slot = store_add(store, task);
+    if(slot == UNSUCCESSFUL) return UNSUCCESSFUL;
+    task->t_id = store->tasks[slot].t_id;
+    if(store->collisions != NULL
+       && collision_add(store->collisions, task, slot) == UNSUCCESSFUL)
         return UNSUCCESSFUL;
-    }
     
-    return file_size/sizeof(Task);
+    // The new task may expire before the others:
+    if(task->flags & FLAG_ACTIVE && get_end_time(task) < next_expiry)
+        next_expiry = get_end_time(task);
+    
+    return store_set_next_expiry(store, next_expiry);
 }
 
 
 /**
- * Save task onto hard disk, return an integer.
- * @param task task to save.
- * @param file_name name of file to open.
- * @return 0 is successful, else -1.
+ * Read a task from store, return an integer.
+ * @param task place-holder for the task read from store.
+ * @param index number of tasks from the beginning of the file to the task
+ *              in question, deleted ones excluded.
+ * @param store opened data file.
+ * @return 0 if successful, else -1.
  */
 
-int save_task(Task *task, const char *file_name) {
-    FILE *fp = fopen(file_name, "ab");
+int read_task(Task *task, long int index, const TaskStore *store) {
+    long int slot = store_slot(store, index);
     
-    if(fp == NULL) {
-        fp = fopen(file_name, "wb");
-        if(fp == NULL) {
-            printf("Error: Unable to open file...\n");
-            return UNSUCCESSFUL;
-        }
+    if(slot == UNSUCCESSFUL) {
+        printf("Error: Specified index exceeds file size...\n");
+        return UNSUCCESSFUL;
     }
     
-    fwrite(task, sizeof(Task), 1, fp);
-    fclose(fp);
+    *task = store->tasks[slot];
     
     return SUCCESSFUL;
 }
 
 
 /**
- * Read a task from file, return an integer.
- * @param task place-holder for the task read from file.
- * @param index number of tasks from the beginning of the file to the task
- *              in question.
- * @param file_name name of the file containing data of tasks.
+ * Read a task from store by ID, return an integer.
+ * @param task place-holder for the task read from store.
+ * @param id ID of the task in question.
+ * @param store opened data file.
  * @return 0 if successful, else -1.
  */
 
-int read_task(Task *task, long int index, const char *file_name) {
-    FILE *fp;
+int read_task_id(Task *task, uint64_t id, TaskStore *store) {
+    long int slot = store_find_id(store, id);
     
-    fp = fopen(file_name, "rb");
-    if(fp == NULL) return UNSUCCESSFUL;
-    
-    fseek(fp, index*sizeof(Task), SEEK_SET);
-    if(fread(task, sizeof(Task), 1, fp) == NULL) {
-        printf("Error: Specified index exceeds file size...\n");
+    if(slot == UNSUCCESSFUL) {
+        printf("Error: Specified ID does not exist...\n");
         return UNSUCCESSFUL;
     }
-        
-    fclose(fp);
+    
+    *task = store->tasks[slot];
     
     return SUCCESSFUL;
 }
 
 
 /**
- * Read a number of consecutive tasks from file, return an integer.
- * @param task place-holder for the task read from file.
+ * Find the IDs of the tasks named exactly so, return an integer.
+ * @param ids place-holder for the IDs found, in no particular order.
+ * @param max_cnt most IDs to write.
+ * @param name name in question.
+ * @param store opened data file.
+ * @return number of such tasks, which may exceed max_cnt, -1 if
+ *         unsuccessful.
+ */
+
+int find_tasks_by_name(uint64_t *ids,
+                       int max_cnt,
+                       const char *name,
+                       TaskStore *store) {
+    long int slots[TASK_FIND_MAX];
+    int found_cnt;
+    
+    if(max_cnt > TASK_FIND_MAX) max_cnt = TASK_FIND_MAX;
+    found_cnt = store_find_name(store, name, slots, max_cnt);
+    for(int i = 0; i < found_cnt && i < max_cnt; i++)
+        ids[i] = store->tasks[slots[i]].t_id;
+    
+    return found_cnt;
+}
+
+
+/**
+ * Read a number of consecutive tasks from store, return an integer.
+ * @param tasks place-holder for the tasks read from store, room for
+ *              num_to_read tasks; may be reused between calls.
  * @param index number of tasks from the beginning of the file to the first
-                task read.
- * @param file_name name of the file containing data of tasks.
+                task read, deleted ones excluded.
+ * @param num_to_read maximum number of tasks to read.
+ * @param store opened data file.
  * @return number of task read if successful, else -1.
  */
 
-int read_tasks(Task **tasks,
+int read_tasks(Task *tasks,
                long int index,
                int num_to_read,
-               const char *file_name) {
-    FILE *fp;
-    int task_cnt;
+               const TaskStore *store) {
+    TaskView view;
+    TaskCursor cursor;
     
-    fp = fopen(file_name, "rb");
-    if(fp == NULL) return UNSUCCESSFUL;
+    if(index < 0 || num_to_read < 0) return UNSUCCESSFUL;
+    if(index >= store->live_cnt) return 0;
     
-    *tasks = realloc(*tasks, num_to_read*sizeof(Task));
-    fseek(fp, index*sizeof(Task), SEEK_SET);
-    for(task_cnt = 0;
-        fread(*(tasks+task_cnt), sizeof(Task), 1, fp) != NULL
-        && task_cnt < num_to_read;
-        task_cnt++);
-        
-    fclose(fp);
+    store_view_all(&view, store);
+    store_cursor_init(&cursor, &view, index);
     
-    *tasks = realloc(*tasks, task_cnt*sizeof(Task));
-    return task_cnt;
+    return store_cursor_read(&cursor, tasks, num_to_read);
 }
 
 
 /**
- * Get on going tasks from file, return an integer.
- * @param tasks place-holder for tasks read from file.
- * @param file_name name of the file containing data of tasks.
+ * Get on going tasks from store, return an integer.
+ * Only tasks started within the longest possible duration are checked,
+ * found by a search on the store's index. Their end times are
+ * checked on the store's columns, only on going tasks' records are read.
+ * @param tasks place-holder for tasks read from store, valid until the
+ *        arena is reset.
+ * @param arena arena the tasks are allocated from.
+ * @param store opened data file.
  * @return number of on going task if successful, else -1.
  */
-int get_current_tasks(Task **tasks, const char *file_name) {
-    FILE *fp;
+int get_current_tasks(Task **tasks, Arena *arena, const TaskStore *store) {
+    const TaskColumns *cols = &store->cols;
+    IndexCursor cursor;
+    IndexEntry entry;
     time_t now;
     long int task_cnt;
     long int task_cnt_max;
     
-    task_cnt_max = get_task_cnt(file_name);
-    if(task_cnt_max<1) return UNSUCCESSFUL;
-    
-    fp = fopen(file_name, "rb");
-    if(fp == NULL) return UNSUCCESSFUL;
+    if(store->task_cnt<1) return UNSUCCESSFUL;
     
-    *tasks = realloc(*tasks, task_cnt_max*sizeof(Task));
     time(&now); // get current time
     
+    // Tasks started in (now - MAX_DURATION_SECS, now) may be on going:
+    task_cnt_max = 0;
+    index_seek(&store->index, now - MAX_DURATION_SECS + 1, &cursor);
+    while(index_next(&cursor, &entry) && entry.t_time < now) task_cnt_max++;
+    *tasks = (Task *)arena_alloc(
+        arena, (task_cnt_max?task_cnt_max:1)*sizeof(Task));
+    if(*tasks == NULL) return UNSUCCESSFUL;
+    
     task_cnt = 0;
-    while(fread((*tasks+task_cnt), sizeof(Task), 1, fp) != NULL) {
-        if((*tasks+task_cnt)->flags & FLAG_ACTIVE
-           && (*tasks+task_cnt)->t_time < now
-           && get_end_time((*tasks+task_cnt)) > now) {
-            task_cnt++;
-        }
+    index_seek(&store->index, now - MAX_DURATION_SECS + 1, &cursor);
+    while(index_next(&cursor, &entry) && entry.t_time < now) {
+        long int slot = entry.slot;
+        if(cols->t_time[slot] + cols->t_duration_in_mins[slot]*SECS_PER_MIN
+           > now)
+            (*tasks)[task_cnt++] = store->tasks[slot];
     }
     
-    fclose(fp);
-    *tasks = realloc(*tasks, task_cnt*sizeof(Task));
-    
     return task_cnt;
 }
 
 
 /**
- * Get next task from file, return an integer.
- * @param task place-holder for the task read from file.
- * @param file_name name of the file containing data of tasks.
+ * Get next task from store, return an integer.
+ * The index is sorted by start time, so the first important enough task
+ * after now is the next one.
+ * @param task place-holder for the task read from store.
+ * @param importance_threshold only tasks rated above this are considered.
+ * @param store opened data file.
  * @return number of minutes until read task start if successful, else -1.
  */
 
 int get_next_task(Task *task,
                   uint8_t importance_threshold,
-                  const char *file_name) {
-    FILE *fp;
-    Task *buffer;
+                  const TaskStore *store) {
+    const TaskColumns *cols = &store->cols;
+    IndexCursor cursor;
+    IndexEntry entry;
     time_t now;
-    time_t min_time = TIME_T_MAX;
     
-    fp = fopen(file_name, "rb");
-    if(fp == NULL) return UNSUCCESSFUL;
-    
-    buffer = (Task *)malloc(sizeof(Task));
     time(&now); // get current time
     
-    while(fread(buffer, sizeof(Task), 1, fp) != NULL) {
-        if(buffer->flags & FLAG_ACTIVE
-           && buffer->t_importance_rtn > importance_threshold
-           && buffer->t_time > now
-           && buffer->t_time - now < min_time) {
-            *task = *buffer;
-            min_time = task->t_time - now;
+    index_seek(&store->index, now + 1, &cursor);
+    while(index_next(&cursor, &entry)) {
+        long int slot = entry.slot;
+        if(cols->t_importance_rtn[slot] > importance_threshold) {
+            *task = store->tasks[slot];
+            return (task->t_time - now)/SECS_PER_MIN;
         }
     }
     
-    fclose(fp);
-    free(buffer);
-    
-    if(buffer == NULL) return UNSUCCESSFUL;
-    if(min_time == TIME_T_MAX) return UNSUCCESSFUL;
-    
-    return min_time/SECS_PER_MIN;
+    return UNSUCCESSFUL;
 }
 
 
 /**
- * Read tasks to be completed today from file, save to another file.
- * @param dest_file_name name of the file to save to.
- * @param file_name name of the file containing data of tasks.
- * @return number of tasks read if successful, else -1.
+ * Get the top upcoming tasks, ranked by importance and time until start as
+ * rank_key. The ranking is kept between calls, so refreshing it while the
+ * store is unchanged does not scan the store again.
+ * @param tasks place-holder for the tasks, room for ranking->k of them.
+ * @param ranking ranking initialized by rank_init, brought up to date.
+ * @param store opened data file.
+ * @return number of tasks read, best first.
  */
 
-int get_day_tasks(const char *dest_file_name, const char *file_name) {
-    FILE *fp;
-    FILE *fp_out;
-    Task *task;
+int get_top_tasks(Task *tasks, Ranking *ranking, const TaskStore *store) {
     time_t now;
-    time_t midnight;
     int task_cnt;
     
-    fp = fopen(file_name, "rb");
-    if(fp == NULL) return UNSUCCESSFUL;
-    fp_out = fopen(dest_file_name, "wb");
-    if(fp == NULL) {
-        fclose(fp);
+    time(&now); // get current time
+    
+    task_cnt = rank_refresh(ranking, store, now);
+    for(int i = 0; i < task_cnt; i++)
+        tasks[i] = store->tasks[ranking->tasks[i].slot];
+    
+    return task_cnt;
+}
+
+
+/**
+ * Select the active tasks starting within (now, before) and rated at least
+ * min_importance, with a vectorized filter over the store's columns.
+ * @param view place-holder for the selected tasks.
+ * @param store opened data file.
+ * @param now start of the time range, excluded.
+ * @param before end of the time range, excluded.
+ * @param min_importance lowest importance selected.
+ * @return number of tasks selected if successful, else -1.
+ */
+
+static int select_upcoming(TaskView *view,
+                           const TaskStore *store,
+                           time_t now,
+                           time_t before,
+                           uint8_t min_importance) {
+    uint64_t *bitmap;
+    long int *slots;
+    long int slot_cnt;
+    long int task_cnt;
+    
+    bitmap = malloc((BITMAP_WORDS(store->task_cnt) + 1)*sizeof(uint64_t));
+    if(bitmap == NULL) return UNSUCCESSFUL;
+    
+    task_cnt = filter_upcoming(&store->cols, store->task_cnt,
+                               now, before, min_importance, bitmap);
+    slots = malloc((task_cnt + 1)*sizeof(long int));
+    if(slots == NULL) {
+        free(bitmap);
         return UNSUCCESSFUL;
     }
     
-    task = (Task *)malloc(sizeof(Task));
-    time(&now); // get current time
-    midnight = get_midnight(now); // get midnight
-    
-    task_cnt = 0;
-    while(fread(task, sizeof(Task), 1, fp) != NULL) {
-        if(task->flags & FLAG_ACTIVE
-           && task->t_time > now
-           && task->t_time < midnight) {
-            task_cnt++;
-            fwrite(task, sizeof(Task), 1, fp_out);
-        }
+    slot_cnt = 0;
+    for(long int i = filter_next(bitmap, store->task_cnt, 0);
+        i != UNSUCCESSFUL;
+        i = filter_next(bitmap, store->task_cnt, i + 1))
+        slots[slot_cnt++] = i;
+    free(bitmap);
+    
+    // Keep the view's generation if the selection has not changed:
+    if(view->slots != NULL
+       && view->store == store
+       && view->slot_cnt == slot_cnt
+       && memcmp(view->slots, slots, slot_cnt*sizeof(long int)) == 0) {
+        free(slots);
+        return task_cnt;
     }
     
-    fclose(fp);
-    fclose(fp_out);
-    free(task);
+    free(view->slots);
+    view->store = store;
+    view->slots = slots;
+    view->slot_cnt = slot_cnt;
+    view->generation = store_next_generation();
     
     return task_cnt;
 }
 
 
 /**
- * Read important tasks 'til next sunday from file.
- * @param dest_file_name name of the file to save to.
- * @param file_name name of the file containing data of tasks.
- * @return number of tasks read if successful, else -1.
+ * Select tasks to be completed today from store.
+ * @param view place-holder for the tasks, free with store_view_free.
+ * @param store opened data file.
+ * @return number of tasks selected if successful, else -1.
  */
 
-int get_week_tasks(const char *dest_file_name, const char *file_name) {
-    FILE *fp;
-    FILE *fp_out;
-    Task *task;
+int get_day_tasks(TaskView *view, const TaskStore *store) {
     time_t now;
-    time_t weekend;
-    int task_cnt;
     
-    fp = fopen(file_name, "rb");
-    if(fp == NULL) return UNSUCCESSFUL;
-    fp_out = fopen(dest_file_name, "wb");
-    if(fp == NULL) {
-        fclose(fp);
-        return UNSUCCESSFUL;
-    }
+    time(&now); // get current time
+    
+    return select_upcoming(view, store, now, get_midnight(now), 0);
+}
+
+
+/**
+ * Select important tasks 'til next sunday from store.
+ * @param view place-holder for the tasks, free with store_view_free.
+ * @param store opened data file.
+ * @return number of tasks selected if successful, else -1.
+ */
+
+int get_week_tasks(TaskView *view, const TaskStore *store) {
+    time_t now;
     
-    task = (Task *)malloc(sizeof(Task));
     time(&now); // get current time
-    weekend = get_weekend_midnight(now); // get weekend midnight
     
-    task_cnt = 0;
-    while(fread(task, sizeof(Task), 1, fp) != NULL) {
-        if(task->flags & FLAG_ACTIVE
-           && task->t_time > now
-           && task->t_time < weekend
-           && task->t_importance_rtn >= IMPORTANCE_THRESHOLD) {
-            task_cnt++;
-            fwrite(task, sizeof(Task), 1, fp_out);
-        }
+    return select_upcoming(view, store, now,
+                           get_weekend_midnight(now), IMPORTANCE_THRESHOLD);
+}
+
+
+/**
+ * Move a task just updated in place within the store's index. The
+ * B+-tree engine moves it in O(log n), the array engine is rebuilt once
+ * all tasks are updated instead.
+ * @param store opened data file.
+ * @param slot slot of the task.
+ * @param old_task the task before the update.
+ * @return 1 if the index is still to be rebuilt, 0 if not, -1 if
+ *         unsuccessful.
+ */
+
+static int reorder_task(TaskStore *store,
+                        long int slot,
+                        const Task *old_task) {
+    if(store->index.engine != INDEX_BTREE) return 1;
+    return store_reorder(store, slot, old_task);
+}
+
+
+/**
+ * Expired tasks updated by update_all_tasks and get_dashboard. They are
+ * written JOURNAL_GROUP_SIZE at a time, so the journal is flushed to disk
+ * once per group rather than once per task.
+ */
+
+typedef struct {
+    long int slots[JOURNAL_GROUP_SIZE]; // slots of the tasks
+    Task tasks[JOURNAL_GROUP_SIZE]; // updated tasks
+    Task old_tasks[JOURNAL_GROUP_SIZE]; // tasks before the update
+    int cnt; // number of tasks
+} UpdateBatch;
+
+
+/**
+ * Write the expired tasks of a batch to the store, with a single flush of
+ * the journal, and move them within the index.
+ * @param batch updated tasks, emptied.
+ * @param store opened data file.
+ * @return 1 if the index is still to be rebuilt, 0 if not, -1 if
+ *         unsuccessful.
+ */
+
+static int flush_updates(UpdateBatch *batch, TaskStore *store) {
+    int changed = 0;
+    int result;
+    
+    if(store_put_slots(store, batch->slots, batch->tasks, batch->cnt)
+       == UNSUCCESSFUL)
+        return UNSUCCESSFUL;
+    for(int i = 0; i < batch->cnt; i++) {
+        result = reorder_task(store, batch->slots[i], batch->old_tasks + i);
+        if(result == UNSUCCESSFUL) return UNSUCCESSFUL;
+        changed |= result;
     }
+    batch->cnt = 0;
     
-    fclose(fp);
-    fclose(fp_out);
-    free(task);
+    return changed;
+}
+
+
+/**
+ * Update an expired task into a batch, writing the batch first if full.
+ * The store keeps the old task until the batch is written; the updated
+ * one is batch->tasks[batch->cnt - 1].
+ * @param batch updated tasks.
+ * @param slot slot of the task.
+ * @param now current time.
+ * @param store opened data file.
+ * @return as flush_updates.
+ */
+
+static int batch_update(UpdateBatch *batch,
+                        long int slot,
+                        time_t now,
+                        TaskStore *store) {
+    int result = 0;
     
-    return task_cnt;
+    if(batch->cnt == JOURNAL_GROUP_SIZE) {
+        result = flush_updates(batch, store);
+        if(result == UNSUCCESSFUL) return UNSUCCESSFUL;
+    }
+    batch->slots[batch->cnt] = slot;
+    batch->old_tasks[batch->cnt] = store->tasks[slot];
+    batch->tasks[batch->cnt] = store->tasks[slot];
+    update_task_at(batch->tasks + batch->cnt++, now);
+    
+    return result;
 }
 
 
 /**
- * Read and update all tasks from file.
- * @param file_name name of file to open.
+ * Update all tasks of the store in place.
+ * Only records whose state changes are written. Nothing is read nor
+ * written until the store's "next expiry" watermark has passed, nor ever
+ * on stores opened for reading.
+ * @param store opened data file.
  * @return 0 is successful, else -1.
  */
  
-int update_all_tasks(const char *file_name) {
-    FILE *fp;
-    FILE *fp_tmp;
-    Task *task;
-    
-    fp = fopen(file_name, "rb");
-    if(fp == NULL) return UNSUCCESSFUL;
-    
-    fp_tmp = fopen(TMP_FILE_NAME, "wb");
-    if(fp_tmp == NULL) {
-        fclose(fp); // close fp as it has been opened
-        printf("Error: Unable to open file...\n");
-        return UNSUCCESSFUL;
+int update_all_tasks(TaskStore *store) {
+    TaskColumns *cols = &store->cols;
+    UpdateBatch batch;
+    const Task *task;
+    time_t now;
+    time_t t_end;
+    time_t next_expiry = TIME_T_MAX;
+    int changed = 0;
+    int result;
+    
+    time(&now); // get current time
+    if(!store->writable || now < store->header->next_expiry)
+        return SUCCESSFUL; // nothing can or needs to be written
+    
+    batch.cnt = 0;
+    for(long int i = 0; i < store->task_cnt; i++) {
+        if(!(cols->flags[i] & FLAG_ACTIVE)) continue;
+        t_end = cols->t_time[i] + cols->t_duration_in_mins[i]*SECS_PER_MIN;
+        if(now >= t_end) { // only expired tasks are written
+            result = batch_update(&batch, i, now, store);
+            if(result == UNSUCCESSFUL) return UNSUCCESSFUL;
+            changed |= result;
+            task = batch.tasks + batch.cnt - 1;
+            if(!(task->flags & FLAG_ACTIVE)) continue;
+            t_end = get_end_time(task);
+        }
+        if(t_end < next_expiry) next_expiry = t_end;
     }
-    task = (Task *)malloc(sizeof(Task));
+    result = flush_updates(&batch, store);
+    if(result == UNSUCCESSFUL) return UNSUCCESSFUL;
+    changed |= result;
+    
+    // Moved or deactivated tasks change the time order:
+    if(changed && store_reindex(store) == UNSUCCESSFUL) return UNSUCCESSFUL;
     
-    while(fread(task, sizeof(Task), 1, fp) != NULL) {
-        if(task->flags & FLAG_ACTIVE) update_task(task);
-        fwrite(task, sizeof(Task), 1, fp_tmp);
+    return store_set_next_expiry(store, next_expiry);
+}
+
+
+/**
+ * Update all tasks of the store and gather the main menu's dashboard, in a
+ * single pass over the store's columns.
+ * Results match update_all_tasks followed by get_current_tasks,
+ * get_day_tasks and get_week_tasks.
+ * @param dashboard place-holder for the results.
+ * @param arena arena the current tasks are allocated from.
+ * @param store opened data file.
+ * @return 0 if successful, else -1.
+ */
+
+int get_dashboard(Dashboard *dashboard, Arena *arena, TaskStore *store) {
+    TaskColumns *cols = &store->cols;
+    UpdateBatch batch;
+    const Task *task;
+    Task *tasks;
+    time_t now;
+    time_t midnight;
+    time_t weekend;
+    time_t t_start, t_end;
+    time_t next_expiry = TIME_T_MAX;
+    int current_cnt = 0;
+    int current_cap = 0;
+    int update_due;
+    int upcoming;
+    int changed = 0;
+    int result;
+    
+    time(&now); // get current time
+    midnight = get_midnight(now);
+    weekend = get_weekend_midnight(now);
+    update_due = store->writable && now >= store->header->next_expiry;
+    
+    dashboard->current_tasks = NULL;
+    dashboard->day_cnt = 0;
+    dashboard->week_cnt = 0;
+    batch.cnt = 0;
+    
+    for(long int i = 0; i < store->task_cnt; i++) {
+        if(!(cols->flags[i] & FLAG_ACTIVE)) continue;
+        task = store->tasks + i;
+        t_start = cols->t_time[i];
+        t_end = t_start + cols->t_duration_in_mins[i]*SECS_PER_MIN;
+        if(update_due) {
+            if(now >= t_end) { // only expired tasks are written
+                result = batch_update(&batch, i, now, store);
+                if(result == UNSUCCESSFUL) return UNSUCCESSFUL;
+                changed |= result;
+                task = batch.tasks + batch.cnt - 1;
+                if(!(task->flags & FLAG_ACTIVE)) continue;
+                t_start = task->t_time;
+                t_end = get_end_time(task);
+            }
+            if(t_end < next_expiry) next_expiry = t_end;
+        }
+        
+        // Counted without branching, tasks being in no particular order:
+        upcoming = t_start > now;
+        dashboard->day_cnt += upcoming & (t_start < midnight);
+        dashboard->week_cnt +=
+            upcoming & (t_start < weekend)
+            & (cols->t_importance_rtn[i] >= IMPORTANCE_THRESHOLD);
+        
+        if(t_start < now && t_end > now) {
+            if(current_cnt == current_cap) { // moved to a block twice as big
+                current_cap = current_cap ? 2*current_cap : 8;
+                tasks = (Task *)arena_alloc(arena, current_cap*sizeof(Task));
+                if(tasks == NULL) return UNSUCCESSFUL;
+                for(int j = 0; j < current_cnt; j++)
+                    tasks[j] = dashboard->current_tasks[j];
+                dashboard->current_tasks = tasks;
+            }
+            dashboard->current_tasks[current_cnt++] = *task;
+        }
     }
     
-    fclose(fp);
-    fclose(fp_tmp);
-    free(task);
+    dashboard->current_cnt = current_cnt;
+    if(!update_due) return SUCCESSFUL;
     
-    remove(file_name);
-    rename(TMP_FILE_NAME, file_name);
+    result = flush_updates(&batch, store);
+    if(result == UNSUCCESSFUL) return UNSUCCESSFUL;
+    changed |= result;
     
-    return SUCCESSFUL;
+    // Moved or deactivated tasks change the time order:
+    if(changed && store_reindex(store) == UNSUCCESSFUL) return UNSUCCESSFUL;
+    
+    return store_set_next_expiry(store, next_expiry);
 }
 
 
 /**
- * Remove a task on file, return an integer.
- * @param index number of tasks from the beginning of the file to the task
- *              in question.
- * @param file_name name of the file containing data of tasks.
+ * Change a task of the store by ID, return an integer.
+ * Every field but the ID is replaced, the task keeps its ID.
+ * @param id ID of the task in question.
+ * @param task new contents of the task.
+ * @param store opened data file.
  * @return 0 if successful, else -1.
  */
 
-int delete_task(long int index, const char *file_name) {
-    FILE *fp;
-    FILE *fp_tmp;
-    Task *task;
+int update_task_id(uint64_t id, const Task *task, TaskStore *store) {
+    long int slot = store_find_id(store, id);
+    time_t next_expiry;
+    Task old_task;
+    Task record;
     
-    fp = fopen(file_name, "rb");
-    if(fp == NULL) return UNSUCCESSFUL;
+    if(slot == UNSUCCESSFUL || !store->writable) return UNSUCCESSFUL;
     
-    fp_tmp = fopen(TMP_FILE_NAME, "wb");
-    if(fp_tmp == NULL) {
-        fclose(fp); // close fp as it has been opened
-        printf("Error: Unable to open file...\n");
+    old_task = store->tasks[slot];
+    record = *task;
+    record.t_id = id;
+    record.flags &= ~FLAG_DELETED;
+    if(store_put_slot(store, slot, &record) == UNSUCCESSFUL
+       || store_reorder(store, slot, &old_task) == UNSUCCESSFUL)
         return UNSUCCESSFUL;
-    }
-    task = (Task *)malloc(sizeof(Task));
+    store_drop_collisions(store); // still holds the old task
+    
+    // The task may now expire before the others:
+    next_expiry = store->header->next_expiry;
+    if(task->flags & FLAG_ACTIVE && get_end_time(task) < next_expiry)
+        next_expiry = get_end_time(task);
     
-    for(long int i = 0;
-        fread(task, sizeof(Task), 1, fp) != NULL;
-        i++)
-        if(i != index) fwrite(task, sizeof(Task), 1, fp_tmp);
+    return store_set_next_expiry(store, next_expiry);
+}
+
+
+/**
+ * Mark a task as deleted, compacting the file once deleted tasks make up
+ * half of it.
+ * @param slot slot of the task, -1 to fail.
+ * @param store opened data file.
+ * @return 0 if successful, else -1.
+ */
+
+static int delete_slot(long int slot, TaskStore *store) {
+    long int tombstone_cnt;
     
-    fclose(fp);
-    fclose(fp_tmp);
-    free(task);
+    if(store_tombstone(store, slot) == UNSUCCESSFUL) return UNSUCCESSFUL;
     
-    remove(file_name);
-    rename(TMP_FILE_NAME, file_name);
+    tombstone_cnt = store->task_cnt - store->live_cnt;
+    if(tombstone_cnt >= COMPACT_MIN_TOMBSTONES
+       && 2*tombstone_cnt >= store->task_cnt)
+        return compact_tasks(store);
     
     return SUCCESSFUL;
 }
+
+
+/**
+ * Remove a task from store, return an integer.
+ * The task is only marked as deleted; the file is compacted once deleted
+ * tasks make up half of it.
+ * @param index number of tasks from the beginning of the file to the task
+ *              in question, deleted ones excluded.
+ * @param store opened data file.
+ * @return 0 if successful, else -1.
+ */
+
+int delete_task(long int index, TaskStore *store) {
+    return delete_slot(store_slot(store, index), store);
+}
+
+
+/**
+ * Remove a task from store by ID, return an integer.
+ * Unlike numbers, the IDs of other tasks do not change.
+ * @param id ID of the task in question.
+ * @param store opened data file.
+ * @return 0 if successful, else -1.
+ */
+
+int delete_task_id(uint64_t id, TaskStore *store) {
+    return delete_slot(store_find_id(store, id), store);
+}
+
+
+/**
+ * Drop deleted tasks from file, return an integer.
+ * Other tasks keep their order, so their numbering does not change.
+ * @param store opened data file.
+ * @return 0 if successful, else -1.
+ */
+
+int compact_tasks(TaskStore *store) {
+    return store_compact(store);
+}
+
+
+/**
+ * Find tasks colliding with a task, return an integer.
+ * All collisions are reported if the task carries FLAG_COLLISION_WARNING,
+ * else only those with tasks carrying it. The store's collision index is
+ * built on first use and kept up to date by save_task.
+ * @param task the task in question, usually not saved yet.
+ * @param store opened data file.
+ * @param slots place-holder for positions of colliding tasks in the store.
+ * @param max_slots capacity of slots.
+ * @return number of colliding tasks if successful, else -1.
+ */
+
+long int find_collisions(const Task *task,
+                         TaskStore *store,
+                         int64_t *slots,
+                         long int max_slots) {
+    if(store->collisions == NULL) {
+        store->collisions = (CollisionIndex *)malloc(sizeof(CollisionIndex));
+        if(store->collisions == NULL) return UNSUCCESSFUL;
+        collision_init(store->collisions);
+        if(collision_build(store->collisions, store->tasks, store->task_cnt)
+           == UNSUCCESSFUL) {
+            store_drop_collisions(store);
+            return UNSUCCESSFUL;
+        }
+    }
+    
+    return collision_find(store->collisions, store->tasks, task,
+                          task->flags & FLAG_COLLISION_WARNING,
+                          slots, max_slots);
+}
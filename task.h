@@ -11,6 +11,7 @@
 #include <time.h>
 
 #include "utils.h"
+#include "arena.h"
 
 // ---------------------------------------------------------------------------
 // Module constants
@@ -22,7 +23,7 @@
 #define FLAG_WEEKLY 0x02
 #define FLAG_DAILY 0x04
 #define FLAG_COLLISION_WARNING 0x08
-#define FLAG_RESERVED_1 0x10
+#define FLAG_DELETED 0x10 /* tombstone, slot may be reused */
 #define FLAG_RESERVED_2 0x20
 #define FLAG_RESERVED_3 0x40
 #define FLAG_RESERVED_4 0x80
@@ -33,45 +34,93 @@
 #define IMPORTANCE_THRESHOLD 10
 
 #define TASK_NAME_MAXLEN 64
-#define TMP_FILE_NAME "tmp.bin"
+
+/**
+ * Most tasks find_tasks_by_name returns the IDs of.
+ */
+#define TASK_FIND_MAX 256
 
 // ---------------------------------------------------------------------------
 // Task struct
 // Contain basic information of a task, i.e task's name, time, ...
+// This is also the on-disk record, so every field has a fixed width and
+// there is no padding. The fields read by every scan come first and fit in
+// 16 bytes, the ID and name follow. IDs are given by the store when a task
+// is saved and never change nor get reused, unlike positions in the file.
 
 typedef struct {
-    char t_name[TASK_NAME_MAXLEN]; // task's name
-    time_t t_time; // task's start time
+    int64_t t_time; // task's start time
     uint16_t t_duration_in_mins; // task's duration
     uint16_t t_repeat_cnt; // times repeated
     uint8_t t_importance_rtn; // task's importance
     uint8_t flags;
+    uint8_t t_reserved[2]; // must be zero
+    uint64_t t_id; // task's ID, 0 until saved
+    char t_name[TASK_NAME_MAXLEN]; // task's name
 } Task;
 
+_Static_assert(sizeof(Task) == 24 + TASK_NAME_MAXLEN,
+               "Task must match the on-disk record layout");
+
+// ---------------------------------------------------------------------------
+// Dashboard struct
+// Counts and on going tasks main_menu shows, gathered by get_dashboard in a
+// single pass. Its next tasks come from a Ranking instead.
+
+typedef struct {
+    Task *current_tasks; // on going tasks in file order, in an arena
+    int current_cnt; // number of on going tasks
+    int day_cnt; // number of tasks left today, as get_day_tasks
+    int week_cnt; // number of important tasks left this week, as get_week_tasks
+} Dashboard;
+
+// Opened data file and selections of its tasks, see store.h
+typedef struct TaskStore TaskStore;
+typedef struct TaskView TaskView;
+
+// Best upcoming tasks of a store, see rank.h
+typedef struct Ranking Ranking;
+
 // ---------------------------------------------------------------------------
 // Functions Prototypes
 
 // Basics
 time_t get_end_time(const Task *task);
+time_t get_period(const Task *task);
 void input_task(Task *task);
 void print_task(const Task *task);
 void update_task(Task *task);
+void update_task_at(Task *task, time_t now);
 
 // File manipulation
-long int get_task_cnt(const char *file_name);
-int save_task(Task *task, const char *file_name);
-int read_task(Task *task, long int index, const char *file_name);
-int read_tasks(Task **tasks,
+long int get_task_cnt(const TaskStore *store);
+int save_task(Task *task, TaskStore *store);
+int read_task(Task *task, long int index, const TaskStore *store);
+int read_task_id(Task *task, uint64_t id, TaskStore *store);
+int find_tasks_by_name(uint64_t *ids,
+                       int max_cnt,
+                       const char *name,
+                       TaskStore *store);
+int read_tasks(Task *tasks,
                long int index,
                int num_to_read,
-               const char *file_name);
-int get_current_tasks(Task **tasks, const char *file_name);
+               const TaskStore *store);
+int get_current_tasks(Task **tasks, Arena *arena, const TaskStore *store);
 int get_next_task(Task *task,
                   uint8_t importance_threshold,
-                  const char *file_name);
-int get_day_tasks(const char *dest_file_name, const char *file_name);
-int get_week_tasks(const char *dest_file_name, const char *file_name);
-int update_all_tasks(const char *file_name);
-int delete_task(long int index, const char *file_name);
+                  const TaskStore *store);
+int get_top_tasks(Task *tasks, Ranking *ranking, const TaskStore *store);
+int get_day_tasks(TaskView *view, const TaskStore *store);
+int get_week_tasks(TaskView *view, const TaskStore *store);
+int update_all_tasks(TaskStore *store);
+int get_dashboard(Dashboard *dashboard, Arena *arena, TaskStore *store);
+int update_task_id(uint64_t id, const Task *task, TaskStore *store);
+int delete_task(long int index, TaskStore *store);
+int delete_task_id(uint64_t id, TaskStore *store);
+int compact_tasks(TaskStore *store);
+long int find_collisions(const Task *task,
+                         TaskStore *store,
+                         int64_t *slots,
+                         long int max_slots);
 
 #endif
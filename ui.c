@@ -1,5 +1,7 @@
 #include "ui.h"
 
+static PageCache page_cache; // pages formatted by display_tasks
+
 // ---------------------------------------------------------------------------
 // Data I/O sub-functions
 
@@ -58,6 +60,9 @@ int input_yes_no(const char *format, ...) {
  */
 
 int input_task_ui(Task *task) {
+    time_t t_time;
+    
+    memset(task, 0, sizeof(Task)); // keep reserved bytes zero
     task->t_repeat_cnt = 0;
     task->flags = 0x00; // reset flags
     task->flags |= FLAG_ACTIVE; // activate
@@ -67,8 +72,9 @@ int input_task_ui(Task *task) {
     printf("Task: "); gets(task->t_name);
     task->t_importance_rtn =
         (uint8_t)input_integer("Importance rating (0-255): ");
-    if(input_date_time(&task->t_time) == UNSUCCESSFUL)
+    if(input_date_time(&t_time) == UNSUCCESSFUL)
         return UNSUCCESSFUL;
+    task->t_time = t_time;
     
     task->t_duration_in_mins = (uint16_t)input_integer("Duration (minutes): ");
     
@@ -78,7 +84,7 @@ int input_task_ui(Task *task) {
             task->flags |= FLAG_DAILY;
         else if(input_yes_no("Weekly?"))
             task->flags |= FLAG_WEEKLY;
-            
+    
     // Collision warning flag:
     if(input_yes_no("Would you like to be warned when this task "
           "collides with other tasks?"))
@@ -110,14 +116,14 @@ time_t input_date_time(time_t *t) {
             return UNSUCCESSFUL;
         case 1:
             time(&now);
-            t_time = *localtime(&now);
+            get_local_time(now, &t_time);
             printf("-Days from now: "); scanf("%d", &temp);
             t_time.tm_mday += temp;
             printf("-Months from now: "); scanf("%d", &temp);
             t_time.tm_mon += temp;
             printf("-Years from now: "); scanf("%d", &temp);
             t_time.tm_year += temp;
-
+        
             break;
         case 2:
             printf("-Day: "); scanf("%d", &t_time.tm_mday);
@@ -125,7 +131,7 @@ time_t input_date_time(time_t *t) {
             t_time.tm_mon -= 1;
             printf("-Year: "); scanf("%d", &t_time.tm_year);
             t_time.tm_year -= 1900; // year 1900 ~ tm_year = 0
-            
+        
             break;
         default:
             display_error("Invalid input", "exit");
@@ -143,19 +149,24 @@ time_t input_date_time(time_t *t) {
 
 
 /**
- * Read tasks from file, display them in a table, return a long integer.
+ * Read tasks from a view, display them in a table, return a long integer.
+ * Formatted pages are cached until the store or view changes, so paging
+ * back and forth formats each page once.
  *
  * @param page_number_ptr Pointer of page number.
- * @param file_name name of the file containing data of tasks.
+ * @param view tasks to display, from an opened data file.
  * @param as_choice determine whether to display items as choices for inputs.
  * @return number displayed items on page.
  */
 
 long int display_tasks(long int *page_number_ptr,
-                       const char *file_name,
+                       const TaskView *view,
                        int is_choice) {
-    FILE *fp;
-    Task *task;
+    const TaskStore *store = view->store;
+    const CachedPage *cached;
+    CachedPage uncached;
+    char text[ITEMS_PER_PAGE*ROW_MAXLEN + 1];
+    const char *row;
     long int task_cnt, page_cnt;
     int item_cnt;
     
@@ -164,7 +175,7 @@ long int display_tasks(long int *page_number_ptr,
            "Id", "Task", "Date", "Active", "Recurrent", "Repeated");
     
     // Check if there's any item to display:
-    task_cnt = get_task_cnt(file_name);
+    task_cnt = store_view_cnt(view);
     if(task_cnt<1) {
         printf("\n(There is nothing to display)\n\n");
         return 0;
@@ -176,119 +187,150 @@ long int display_tasks(long int *page_number_ptr,
     if(*page_number_ptr<0) *page_number_ptr = 0;
     if(*page_number_ptr>page_cnt) *page_number_ptr = page_cnt;
     
-    // Open file and allocate memory for buffer:
-    fp = fopen(file_name, "rb");
-    task = malloc(sizeof(Task));
-    
-    // Move cursor to target page:
-    fseek(fp, *page_number_ptr*ITEMS_PER_PAGE*sizeof(Task), SEEK_SET);
+    // Format target page, unless it is cached:
+    cached = page_cache_find(&page_cache,
+                             store->file_name,
+                             store->generation,
+                             store_view_generation(view),
+                             *page_number_ptr);
+    if(cached == NULL) {
+        Task page[ITEMS_PER_PAGE];
+        TaskCursor cursor;
+        char *text_end = text;
+        
+        store_cursor_init(&cursor, view, *page_number_ptr*ITEMS_PER_PAGE);
+        uncached.row_cnt = store_cursor_read(&cursor, page, ITEMS_PER_PAGE);
+        uncached.text = text;
+        *text = '\0';
+        for(int i = 0; i < uncached.row_cnt; i++) {
+            char repeated[10];
+            char time_str[TIME_STR_LEN];
+            time_t t_time;
+            
+            sprintf(repeated, "%d", page[i].t_repeat_cnt+1);
+            t_time = page[i].t_time;
+            text_end += sprintf(
+                text_end,
+                ROW_FORMAT,
+                page[i].t_name,
+                time2str(&t_time, time_str),
+                (page[i].flags & FLAG_ACTIVE)?"Yes":"No",
+                (page[i].flags & (FLAG_DAILY | FLAG_WEEKLY))?"Yes":"No",
+                repeated
+            );
+        }
+        
+        cached = page_cache_insert(&page_cache,
+                                   store->file_name,
+                                   store->generation,
+                                   store_view_generation(view),
+                                   *page_number_ptr,
+                                   uncached.row_cnt,
+                                   text);
+        if(cached == NULL) cached = &uncached; // out of memory, not cached
+    }
     
-    // Read and display items:
-    for(item_cnt = 1;
-        item_cnt<=ITEMS_PER_PAGE && fread(task, sizeof(Task), 1, fp);
-        item_cnt++) {
-        char index[10];
-        char repeated[10];
+    // Display items:
+    row = cached->text;
+    for(item_cnt = 1; item_cnt<=cached->row_cnt; item_cnt++) {
+        const char *row_end = strchr(row, '\n');
+        char index[16]; // any int, within brackets
+        
         if(is_choice)
-            sprintf(index, "[%d]", item_cnt);
+            snprintf(index, sizeof(index), "[%d]", item_cnt);
         else
-            sprintf(index, "%d", item_cnt);
-        sprintf(repeated, "%d", task->t_repeat_cnt+1);
-        printf(
-            TABLE_FORMAT,
-            index, task->t_name,
-            time2str(&task->t_time),
-            (task->flags & FLAG_ACTIVE)?"Yes":"No",
-            (task->flags & (FLAG_DAILY | FLAG_WEEKLY))?"Yes":"No",
-            repeated
-        );
+            snprintf(index, sizeof(index), "%d", item_cnt);
+        printf(INDEX_FORMAT "%.*s", index, (int)(row_end - row + 1), row);
+        row = row_end + 1;
     }
-
+    
     printf("(%d - %d item(s) out of %d)\n\n",
            *page_number_ptr*ITEMS_PER_PAGE + 1,
            *page_number_ptr*ITEMS_PER_PAGE + item_cnt - 1,
            task_cnt);
     
-    // Close file, free memory:
-    fclose(fp);
-    free(task);
-    
     return item_cnt;
 }
 
 
+/**
+ * Display the time left until a time, in weeks, days, hours and minutes.
+ * @param t time in question, after now.
+ */
+
+void display_time_til(time_t t) {
+    int minutes = (t - time(NULL))/SECS_PER_MIN;
+    int hours = minutes / MINS_PER_HOUR;
+    int days = hours / HOURS_PER_DAY;
+    int weeks = days / DAYS_PER_WEEK;
+    
+    minutes %= MINS_PER_HOUR;
+    hours %= HOURS_PER_DAY;
+    days %= DAYS_PER_WEEK;
+    
+    if(weeks) printf("%d week%s ", weeks, weeks>1?"s":"");
+    if(days) printf("%d day%s ", days, days>1?"s":"");
+    if(hours) printf("%d hour%s ", hours, hours>1?"s":"");
+    printf("%d minute%s.\n", minutes, minutes>1?"s":"");
+}
+
+
 // ---------------------------------------------------------------------------
 // Menus
 
 void main_menu(const char *user_name) {
-    Task *current_tasks = (Task *)malloc(sizeof(Task));
-    Task *next_task = (Task *)malloc(sizeof(Task));
     char *file_name = username2datafilename(user_name, "");
-    char *file_name_day = username2datafilename(user_name, "_day");
-    char *file_name_week = username2datafilename(user_name, "_week");
-    uint8_t threshold_for_next_task = 0;
-    int choice,
-        current_tasks_cnt,
-        weeks_til_next_task,
-        days_til_next_task,
-        hours_til_next_task,
-        minutes_til_next_task;
+    TaskStore store;
+    Dashboard dashboard;
+    Arena arena;
+    Ranking ranking;
+    Task top_tasks[TOP_TASKS_SHOWN];
+    int choice, top_cnt;
+    
+    if(store_open(&store, file_name, STORE_WRITE) == UNSUCCESSFUL) {
+        display_error("Unable to open data file", "exit");
+        free(file_name);
+        return;
+    }
+    if(rank_init(&ranking, TOP_TASKS_SHOWN) == UNSUCCESSFUL) {
+        display_error("Out of memory", "exit");
+        store_close(&store);
+        free(file_name);
+        return;
+    }
+    arena_init(&arena);
     
     do {
+        arena_reset(&arena);
         system("cls");
-        update_all_tasks(file_name);
+        get_dashboard(&dashboard, &arena, &store);
         printf("Welcome to EZ Task, %s!\n\n", user_name);
         
         // Display current tasks:
-        current_tasks_cnt = get_current_tasks(&current_tasks, file_name);
         printf("You have %d on going task%s%s\n",
-               current_tasks_cnt,
-               current_tasks_cnt>1?"s":"", // display in plural if true
-               current_tasks_cnt>0?":":".");
-        for(int i = 0; i < current_tasks_cnt; i++)
-            printf("-%s\n", (current_tasks+i)->t_name);
+               dashboard.current_cnt,
+               dashboard.current_cnt>1?"s":"", // display in plural if true
+               dashboard.current_cnt>0?":":".");
+        for(int i = 0; i < dashboard.current_cnt; i++)
+            printf("-%s\n", (dashboard.current_tasks+i)->t_name);
         
-        // Display next tasks:
-        printf("\nNext task: (with threshold %d)\n", threshold_for_next_task);
-        minutes_til_next_task = get_next_task(next_task,
-                                              threshold_for_next_task,
-                                              file_name);
-        if(minutes_til_next_task >= 0) {
-            
-            hours_til_next_task = minutes_til_next_task / MINS_PER_HOUR;
-            minutes_til_next_task %= MINS_PER_HOUR;
-            days_til_next_task = hours_til_next_task / HOURS_PER_DAY;
-            hours_til_next_task %= HOURS_PER_DAY;
-            weeks_til_next_task = days_til_next_task / DAYS_PER_WEEK;
-            days_til_next_task %= DAYS_PER_WEEK;
-            
-            printf("%s, coming in ", next_task->t_name);
-            if(weeks_til_next_task)
-                printf("%d week%s ",
-                       weeks_til_next_task,
-                       weeks_til_next_task>1?"s":"");
-            if(days_til_next_task)
-                printf("%d day%s ",
-                       days_til_next_task,
-                       days_til_next_task>1?"s":"");
-            if(hours_til_next_task)
-                printf("%d hour%s ",
-                       hours_til_next_task,
-                       hours_til_next_task>1?"s":"");
-            printf("%d minute%s.\n",
-                   minutes_til_next_task,
-                   minutes_til_next_task>1?"s":"");
-        } else printf("None\n");
+        // Display next tasks, most important and soonest first:
+        printf("\nNext tasks:\n");
+        top_cnt = get_top_tasks(top_tasks, &ranking, &store);
+        for(int i = 0; i < top_cnt; i++) {
+            printf("-%s, coming in ", top_tasks[i].t_name);
+            display_time_til(top_tasks[i].t_time);
+        }
+        if(!top_cnt) printf("None\n");
         
         // Display and read choices:
         choice = input_integer(
             "[1] Manage tasks\n"
-            "[2] Today's tasks\n"
-            "[3] This week's important tasks (rating >= 10)\n"
-            "[4] Threshold +\n"
-            "[5] Threshold -\n"
+            "[2] Today's tasks (%d)\n"
+            "[3] This week's important tasks (rating >= 10) (%d)\n"
             "[0] Exit\n"
-            "\nPlease enter your choice: "
+            "\nPlease enter your choice: ",
+            dashboard.day_cnt, dashboard.week_cnt
         );
         switch(choice) {
             case 0: // exit
@@ -296,49 +338,43 @@ void main_menu(const char *user_name) {
                 getch();
                 break;
             case 1: // all task
-                task_menu(file_name);
+                task_menu(&store);
                 break;
             case 2: // day's task
                 subset_task_menu("Today's tasks",
-                                 file_name,
-                                 file_name_day,
+                                 &store,
                                  get_day_tasks);
                 break;
             case 3: // week's task
                 subset_task_menu("This week important tasks",
-                                 file_name,
-                                 file_name_week,
+                                 &store,
                                  get_week_tasks);
                 break;
-            case 4: // increase importance threshold
-                threshold_for_next_task++;
-                break;
-            case 5: // decrease importance threshold
-                threshold_for_next_task--;
-                break;
             default:
                 display_error("Invalid input", "continue");
                 break;
         }
     } while(choice);
     
-    free(current_tasks);
-    free(next_task);
+    store_close(&store);
+    page_cache_free(&page_cache);
+    arena_free(&arena);
+    rank_free(&ranking);
     free(file_name);
-    free(file_name_day);
-    free(file_name_week);
 }
 
 
-void task_menu(const char *file_name) {
+void task_menu(TaskStore *store) {
+    TaskView view;
     int choice;
     long int page_number = 0;
     
+    store_view_all(&view, store);
     do {
-        update_all_tasks(file_name);
+        update_all_tasks(store);
         system("cls");
         printf("All tasks:\n\n");
-        display_tasks(&page_number, file_name, 0);
+        display_tasks(&page_number, &view, 0);
         choice = input_integer(
             "[1] Next page\n"
             "[2] Previous page\n"
@@ -358,13 +394,13 @@ void task_menu(const char *file_name) {
                 page_number--;
                 break;
             case 3:
-                add_task_menu(file_name);
+                add_task_menu(store);
                 break;
             case 4: // view item, need exact position
-                view_task_menu(&page_number, file_name);
+                view_task_menu(&page_number, &view);
                 break;
             case 5: // remove item, need exact position
-                remove_task_menu(&page_number, file_name);
+                remove_task_menu(&page_number, store);
                 break;
             default:
                 display_error("Invalid input", "continue");
@@ -375,18 +411,22 @@ void task_menu(const char *file_name) {
 
 
 void subset_task_menu(const char *title,
-                      const char *file_name,
-                      const char *tmp_file_name,
-                      int (*filter_func)(const char *, const char *)) {
+                      TaskStore *store,
+                      int (*filter_func)(TaskView *, const TaskStore *)) {
+    TaskView view;
     int choice;
     long int page_number = 0;
     
+    store_view_all(&view, store);
     do {
         system("cls");
-        update_all_tasks(file_name);
-        (*filter_func)(tmp_file_name, file_name);
+        update_all_tasks(store);
+        if((*filter_func)(&view, store) == UNSUCCESSFUL) {
+            display_error("Out of memory", "go back");
+            break;
+        }
         printf("%s:\n\n", title);
-        display_tasks(&page_number, tmp_file_name, 0);
+        display_tasks(&page_number, &view, 0);
         choice = input_integer(
             "[1] Next page\n"
             "[2] Previous page\n"
@@ -404,7 +444,7 @@ void subset_task_menu(const char *title,
                 page_number--;
                 break;
             case 3: // view item, need exact position
-                view_task_menu(&page_number, tmp_file_name);
+                view_task_menu(&page_number, &view);
                 break;
             default:
                 display_error("Invalid input", "continue");
@@ -412,34 +452,52 @@ void subset_task_menu(const char *title,
         }
     } while(choice);
     
-    remove(tmp_file_name);
+    store_view_free(&view);
 }
 
-void add_task_menu(const char *file_name) {
-    Task *task = (Task *)malloc(sizeof(Task));
+void add_task_menu(TaskStore *store) {
+    Task task;
+    int64_t collisions[COLLISIONS_SHOWN];
+    long int collision_cnt;
     
     system("cls");
-    if(input_task_ui(task) == UNSUCCESSFUL)
+    if(input_task_ui(&task) == UNSUCCESSFUL) {
         display_error("Task entry has been cancelled", "go back");
-    else
-        save_task(task, file_name);
-    free(task);
+        return;
+    }
+    
+    // Warn about collisions before saving:
+    collision_cnt = find_collisions(&task,
+                                    store,
+                                    collisions,
+                                    COLLISIONS_SHOWN);
+    if(collision_cnt > 0) {
+        printf("\nThis task collides with:\n");
+        for(long int i = 0; i < collision_cnt; i++)
+            printf("-%s\n", store->tasks[collisions[i]].t_name);
+        if(!input_yes_no("Save it anyway?")) {
+            display_error("Task entry has been cancelled", "go back");
+            return;
+        }
+    }
+    
+    save_task(&task, store);
 }
 
-void view_task_menu(long int *page_number_ptr, const char *file_name) {
+void view_task_menu(long int *page_number_ptr, const TaskView *view) {
+    Task task;
     int choice;
     int item_cnt;
-    Task *task = (Task *)malloc(sizeof(Task));
     
     do {
         system("cls");
         printf("View task: \n\n");
-        if(get_task_cnt(file_name) < 1) {
+        if(store_view_cnt(view) < 1) {
             display_error("Nothing to view", "go back");
             break;
         }
         
-        item_cnt = display_tasks(page_number_ptr, file_name, 1);
+        item_cnt = display_tasks(page_number_ptr, view, 1);
         choice = input_integer(
             "[%d] Next page\n"
             "[%d] Prev page\n"
@@ -451,10 +509,10 @@ void view_task_menu(long int *page_number_ptr, const char *file_name) {
         // Check if choice falls in range:
         if(0 < choice && choice < item_cnt) {
             system("cls");
-            read_task(task,
-                      *page_number_ptr*ITEMS_PER_PAGE + choice - 1,
-                      file_name);
-            print_task(task);
+            task = view->store->tasks[
+                store_view_slot(view,
+                                *page_number_ptr*ITEMS_PER_PAGE + choice - 1)];
+            print_task(&task);
             getch();
         } else switch(choice) {
             case 0:
@@ -471,23 +529,23 @@ void view_task_menu(long int *page_number_ptr, const char *file_name) {
         }
         
     } while(choice);
-    
-    free(task);
 }
 
-void remove_task_menu(long int *page_number_ptr, const char *file_name) {
+void remove_task_menu(long int *page_number_ptr, TaskStore *store) {
+    TaskView view;
     int choice;
     int item_cnt;
     
+    store_view_all(&view, store);
     do {
         system("cls");
         printf("Remove task: \n\n");
-        if(get_task_cnt(file_name) < 1) {
+        if(get_task_cnt(store) < 1) {
             display_error("Nothing to remove", "go back");
             break;
         }
         
-        item_cnt = display_tasks(page_number_ptr, file_name, 1);
+        item_cnt = display_tasks(page_number_ptr, &view, 1);
         choice = input_integer(
             "[%d] Next page\n"
             "[%d] Prev page\n"
@@ -496,11 +554,13 @@ void remove_task_menu(long int *page_number_ptr, const char *file_name) {
             ITEMS_PER_PAGE+1, ITEMS_PER_PAGE+2
         );
         
-        // Check if choice falls in range:
-        if(0 < choice && choice < item_cnt)
-            delete_task(*page_number_ptr*ITEMS_PER_PAGE + choice - 1,
-                        file_name);
-        else switch(choice) {
+        // Check if choice falls in range, then delete the task by its ID:
+        if(0 < choice && choice < item_cnt) {
+            long int slot = store_view_slot(
+                &view, *page_number_ptr*ITEMS_PER_PAGE + choice - 1);
+            if(slot != UNSUCCESSFUL)
+                delete_task_id(store->tasks[slot].t_id, store);
+        } else switch(choice) {
             case 0:
                 break;
             case ITEMS_PER_PAGE+1:
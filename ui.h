@@ -11,13 +11,21 @@
 #include <stdarg.h>
 
 #include "task.h"
+#include "store.h"
+#include "pagecache.h"
+#include "rank.h"
 #include "utils.h"
 
 // ---------------------------------------------------------------------------
 // Module constants
 
 #define ITEMS_PER_PAGE 8 /* items per page for display_tasks function */
-#define TABLE_FORMAT "%-6.4s%-26.24s%-18.16s%-8.6s%-11.9s%-10.8s\n"
+#define COLLISIONS_SHOWN 8 /* collisions listed by add_task_menu */
+#define TOP_TASKS_SHOWN 5 /* next tasks listed by main_menu */
+#define INDEX_FORMAT "%-6.4s"
+#define ROW_FORMAT "%-26.24s%-18.16s%-8.6s%-11.9s%-10.8s\n"
+#define TABLE_FORMAT INDEX_FORMAT ROW_FORMAT
+#define ROW_MAXLEN 80 /* longest row printed with ROW_FORMAT */
 
 // ---------------------------------------------------------------------------
 // Function prototypes
@@ -29,18 +37,18 @@ int input_yes_no(const char *format, ...);
 int input_task_ui(Task *task);
 time_t input_date_time(time_t *t);
 long int display_tasks(long int *page_number_ptr,
-                       const char *file_name,
+                       const TaskView *view,
                        int as_choices);
+void display_time_til(time_t t);
 
 // Menus
 void main_menu(const char *user_name);
-void task_menu(const char *file_name);
+void task_menu(TaskStore *store);
 void subset_task_menu(const char *title,
-                      const char *file_name,
-                      const char *tmp_file_name,
-                      int (*filter_func)(const char *, const char *));
-void add_task_menu(const char *file_name);
-void view_task_menu(long int *page_number_ptr, const char *file_name);
-void remove_task_menu(long int *page_number_ptr, const char *file_name);
+                      TaskStore *store,
+                      int (*filter_func)(TaskView *, const TaskStore *));
+void add_task_menu(TaskStore *store);
+void view_task_menu(long int *page_number_ptr, const TaskView *view);
+void remove_task_menu(long int *page_number_ptr, TaskStore *store);
 
 #endif
@@ -1,22 +1,127 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "utils.h"
 
+#include <ctype.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// ---------------------------------------------------------------------------
+// Module constants
+
+#define CALENDAR_CACHE_SIZE 64 /* days cached per thread */
+
+// ---------------------------------------------------------------------------
+// CalendarDay struct
+// Boundaries of a local day, found with the time zone once and then reused
+// for every time within it. Days with a change of UTC offset (daylight
+// saving) are not cached, their times are converted one by one.
+
+typedef struct {
+    time_t start; // local midnight starting the day
+    time_t end; // next local midnight
+    time_t weekend; // as get_weekend_midnight for times of the day
+    char date[11]; // the day as %d/%m/%Y
+    int cached; // 0 if times of the day must be converted one by one
+} CalendarDay;
+
+// Days last looked up, by UTC day modulo the cache's size. One cache per
+// thread, so no locking is needed.
+static _Thread_local CalendarDay cached_days[CALENDAR_CACHE_SIZE];
+
+// ---------------------------------------------------------------------------
+// Helpers
+
+/**
+ * Find the local day of a time, from the cache if possible.
+ * @param t time in question.
+ * @return the day, valid until the next lookup on the same thread.
+ */
+
+static const CalendarDay *lookup_day(time_t t) {
+    CalendarDay *day = cached_days
+                       + (uint64_t)(t/SECS_PER_DAY)%CALENDAR_CACHE_SIZE;
+    struct tm time_info;
+    time_t wall_start;
+    
+    if(day->cached && t >= day->start && t < day->end) return day;
+    
+    get_local_time(t, &time_info);
+    wall_start = t - (time_info.tm_hour*3600
+                      + time_info.tm_min*60 + time_info.tm_sec);
+    strftime(day->date, sizeof(day->date), "%d/%m/%Y", &time_info);
+    
+    time_info.tm_hour = 0;
+    time_info.tm_min = 0;
+    time_info.tm_sec = 0;
+    time_info.tm_isdst = -1;
+    time_info.tm_mday += 1;
+    day->end = mktime(&time_info);
+    time_info.tm_mday -= 1;
+    time_info.tm_isdst = -1;
+    day->start = mktime(&time_info);
+    time_info.tm_mday += 8 - time_info.tm_wday;
+    time_info.tm_isdst = -1;
+    day->weekend = mktime(&time_info);
+    
+    // Arithmetic on the day's times holds only if the offset is constant:
+    day->cached = day->start == wall_start
+                  && day->end - day->start == SECS_PER_DAY;
+    
+    return day;
+}
+
 // ---------------------------------------------------------------------------
 // Utility functions
 
 /**
  * Convert time_t into string of format %H:%M %d/%m/%Y.
- * @param t Seconds passed from January 1st 1900 to a specific time.
- * @return The output string contain date-time of the specific time from
- *         the input.
+ * @param t Seconds passed from January 1st 1970 to a specific time.
+ * @param s place-holder for the string, room for TIME_STR_LEN chars.
+ * @return s, containing date-time of the specific time from the input.
  */
 
-const char *time2str(const time_t *t) {
-    char s[17];
-    strftime(s, 17, "%H:%M %d/%m/%Y", localtime(t));
+char *time2str(const time_t *t, char *s) {
+    const CalendarDay *day = lookup_day(*t);
+    
+    if(day->cached) { // same offset all day, no conversion needed
+        int hours = (int)(*t - day->start)/3600;
+        int mins = (int)(*t - day->start)/60%60;
+        s[0] = (char)('0' + hours/10);
+        s[1] = (char)('0' + hours%10);
+        s[2] = ':';
+        s[3] = (char)('0' + mins/10);
+        s[4] = (char)('0' + mins%10);
+        s[5] = ' ';
+        memcpy(s + 6, day->date, sizeof(day->date));
+    } else {
+        struct tm time_info;
+        get_local_time(*t, &time_info);
+        strftime(s, TIME_STR_LEN, "%H:%M %d/%m/%Y", &time_info);
+    }
+    
     return s;
 }
 
 
+/**
+ * Check a username as log_in does: an alphabetical character, then
+ * alphanumerical characters, '_' or '-'.
+ * @return 1 if it is valid, else 0.
+ */
+
+int valid_username(const char *username) {
+    if(!isalpha((unsigned char)*username)) return 0;
+    for(const char *c = username; *c; c++)
+        if(!isalnum((unsigned char)*c) && *c != '_' && *c != '-') return 0;
+    return 1;
+}
+
+
 /**
  * Take a string, add extension behind it, return the result.
  * Remember to free memory of the returned string.
@@ -27,30 +132,107 @@ char *username2datafilename(const char *username, const char *postfix) {
         sizeof(char)
         * (strlen(username)
            + strlen(postfix)
-           + strlen(DATAFILE_EXTENSION)));
+           + strlen(DATAFILE_EXTENSION)
+           + 1));
     strcpy(dfn, username);
     strcat(dfn, postfix);
     strcat(dfn, DATAFILE_EXTENSION);
     return dfn;
 }
 
-time_t get_midnight(time_t t) {
-    struct tm time_info = *localtime(&t);
+
+/**
+ * Take a data file name, return the name of a file kept next to it, e.g.
+ * "user.dat" with postfix "_idx" gives "user_idx.dat".
+ * Remember to free memory of the returned string.
+ */
+
+char *datafilename2sidecar(const char *file_name, const char *postfix) {
+    size_t base_len = strlen(file_name);
+    size_t ext_len = strlen(DATAFILE_EXTENSION);
+    char *sfn;
     
-    time_info.tm_mday += 1;
-    time_info.tm_hour = 0;
-    time_info.tm_min = 0;
-    time_info.tm_sec = 0;
+    if(base_len >= ext_len
+       && strcmp(file_name + base_len - ext_len, DATAFILE_EXTENSION) == 0)
+        base_len -= ext_len; // drop the extension, it is added back below
     
-    return mktime(&time_info);
+    sfn = (char *)malloc(base_len + strlen(postfix) + ext_len + 1);
+    memcpy(sfn, file_name, base_len);
+    strcpy(sfn + base_len, postfix);
+    strcat(sfn, DATAFILE_EXTENSION);
+    return sfn;
+}
+
+
+/**
+ * Move a file over another one in a single step, so there is no moment
+ * when neither of them exists.
+ * @return 0 if successful, else -1.
+ */
+
+int replace_file(const char *src_file_name, const char *dest_file_name) {
+#ifdef _WIN32
+    if(!MoveFileExA(src_file_name, dest_file_name, MOVEFILE_REPLACE_EXISTING))
+        return UNSUCCESSFUL;
+#else
+    if(rename(src_file_name, dest_file_name) != 0)
+        return UNSUCCESSFUL;
+#endif
+    return SUCCESSFUL;
 }
+
+/**
+ * Get the local midnight ending the day of a time.
+ * @param t time in question.
+ * @return the next midnight after t.
+ */
+
+time_t get_midnight(time_t t) {
+    return lookup_day(t)->end;
+}
+
+
+/**
+ * Get the local midnight ending the week of a time, on Monday.
+ * @param t time in question.
+ * @return the midnight starting the next Monday, a week later on Sundays.
+ */
+
 time_t get_weekend_midnight(time_t t) {
-    struct tm time_info = *localtime(&t);
-    
-    time_info.tm_mday += 8 - time_info.tm_wday;
-    time_info.tm_hour = 0;
-    time_info.tm_min = 0;
-    time_info.tm_sec = 0;
-    
-    return mktime(&time_info);
-}
\ No newline at end of file
+    return lookup_day(t)->weekend;
+}
+
+
+/**
+ * Convert a time to local date and time, safe to call from any thread.
+ * @param t time to convert.
+ * @param time_info place-holder for the local date and time.
+ */
+
+void get_local_time(time_t t, struct tm *time_info) {
+#ifdef _WIN32
+    *time_info = *localtime(&t); // the CRT keeps one result per thread
+#else
+    localtime_r(&t, time_info);
+#endif
+}
+
+
+/**
+ * Get a wall-clock time in seconds, from an unspecified starting point.
+ * Only differences between two values are meaningful, they are not
+ * affected by changes of the system's date.
+ */
+
+double get_wall_time(void) {
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (double)counter.QuadPart/frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec/1e9;
+#endif
+}
@@ -9,19 +9,21 @@
 #include <stdio.h>
 #include <malloc.h>
 #include <string.h>
+#include <stdint.h>
 #include <time.h>
 
 // ---------------------------------------------------------------------------
 // Module constants
 
 #define DATAFILE_EXTENSION ".dat"
-#define TIME_T_MAX ~(1<<(4*sizeof(time_t)-1))
+#define TIME_T_MAX ((time_t)(~(uint64_t)0 >> (65 - 8*sizeof(time_t))))
 #define DAYS_PER_WEEK 7
 #define HOURS_PER_DAY 24
 #define MINS_PER_HOUR 60
 #define SECS_PER_MIN 60
 #define SECS_PER_DAY 86400
 #define SECS_PER_WEEK 604800
+#define TIME_STR_LEN 17 /* "HH:MM DD/MM/YYYY" and '\0' */
 
 #define SUCCESSFUL 0
 #define UNSUCCESSFUL -1
@@ -29,9 +31,14 @@
 // ---------------------------------------------------------------------------
 // Functions Prototypes
 
-const char *time2str(const time_t *t);
+char *time2str(const time_t *t, char *s);
+int valid_username(const char *username);
 char *username2datafilename(const char *username, const char *postfix);
+char *datafilename2sidecar(const char *file_name, const char *postfix);
+int replace_file(const char *src_file_name, const char *dest_file_name);
 time_t get_midnight(time_t t);
 time_t get_weekend_midnight(time_t t);
+void get_local_time(time_t t, struct tm *time_info);
+double get_wall_time(void);
 
 #endif
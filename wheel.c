@@ -0,0 +1,253 @@
+#include "wheel.h"
+
+#include <stdlib.h>
+
+// ---------------------------------------------------------------------------
+// Helpers
+
+/**
+ * Number of trailing zero bits of a non-zero word.
+ */
+
+static int lowest_bit(uint64_t x) {
+    int n = 0;
+    
+    while(!(x & 1)) {
+        x >>= 1;
+        n++;
+    }
+    
+    return n;
+}
+
+
+/**
+ * Put a timer in the bucket matching how far ahead it fires. Timers due
+ * already fire with the current second; those beyond the last level wait
+ * in it until they come closer.
+ * @param wheel wheel the timer belongs to.
+ * @param t position of the timer.
+ */
+
+static void place(TimerWheel *wheel, int32_t t) {
+    int64_t expires = wheel->timers[t].expires;
+    int64_t delta;
+    int level = 0;
+    int index;
+    
+    if(expires < wheel->current) expires = wheel->current;
+    delta = expires - wheel->current;
+    while(level < WHEEL_LEVELS - 1
+          && delta >> WHEEL_BITS*(level + 1) != 0)
+        level++;
+    if(delta >> WHEEL_BITS*(level + 1) != 0) // out of range, wait in it
+        expires = wheel->current
+                  + ((int64_t)1 << WHEEL_BITS*WHEEL_LEVELS) - 1;
+    
+    index = (int)(expires >> WHEEL_BITS*level) & (WHEEL_SIZE - 1);
+    wheel->timers[t].next = wheel->buckets[level][index];
+    wheel->buckets[level][index] = t;
+    wheel->occupied[level] |= (uint64_t)1 << index;
+}
+
+
+/**
+ * Move the timers of the buckets coming up at the current second, which
+ * starts a new rotation of level 0, down to lower levels. Higher levels
+ * go first, their timers may land in lower buckets coming up as well.
+ * @param wheel wheel whose current second is a multiple of WHEEL_SIZE.
+ */
+
+static void cascade(TimerWheel *wheel) {
+    int top = 1;
+    
+    // Levels whose lower levels all start a new rotation:
+    while(top < WHEEL_LEVELS - 1
+          && ((wheel->current >> WHEEL_BITS*top) & (WHEEL_SIZE - 1)) == 0)
+        top++;
+    
+    for(int level = top; level > 0; level--) {
+        int index = (int)(wheel->current >> WHEEL_BITS*level)
+                    & (WHEEL_SIZE - 1);
+        int32_t t = wheel->buckets[level][index];
+        
+        wheel->buckets[level][index] = -1;
+        wheel->occupied[level] &= ~((uint64_t)1 << index);
+        while(t >= 0) {
+            int32_t next = wheel->timers[t].next;
+            place(wheel, t);
+            t = next;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Wheel functions
+
+/**
+ * Initialize an empty wheel.
+ * @param wheel wheel to initialize.
+ * @param now first second to expire.
+ */
+
+void wheel_init(TimerWheel *wheel, int64_t now) {
+    wheel->timers = NULL;
+    wheel->timer_cap = 0;
+    wheel_reset(wheel, now);
+}
+
+
+/**
+ * Free a wheel's memory, it is then empty.
+ * @param wheel wheel to free.
+ */
+
+void wheel_free(TimerWheel *wheel) {
+    free(wheel->timers);
+    wheel_init(wheel, wheel->current);
+}
+
+
+/**
+ * Drop every timer of a wheel, keeping its memory for the next ones.
+ * @param wheel wheel to reset.
+ * @param now first second to expire.
+ */
+
+void wheel_reset(TimerWheel *wheel, int64_t now) {
+    wheel->timer_cnt = 0;
+    wheel->free_timer = -1;
+    for(int level = 0; level < WHEEL_LEVELS; level++) {
+        for(int i = 0; i < WHEEL_SIZE; i++)
+            wheel->buckets[level][i] = -1;
+        wheel->occupied[level] = 0;
+    }
+    wheel->current = now;
+    wheel->pending_cnt = 0;
+}
+
+
+/**
+ * Add a timer to a wheel, in O(1).
+ * @param wheel wheel to add to.
+ * @param expires time the timer fires, timers due already fire next.
+ * @param slot what the timer is for.
+ * @return 0 if successful, else -1.
+ */
+
+int wheel_add(TimerWheel *wheel, int64_t expires, int64_t slot) {
+    int32_t t = wheel->free_timer;
+    
+    if(t >= 0) {
+        wheel->free_timer = wheel->timers[t].next;
+    } else {
+        if(wheel->timer_cnt == wheel->timer_cap) {
+            long int cap = wheel->timer_cap ? 2*wheel->timer_cap : 1024;
+            WheelTimer *grown;
+            if(cap > INT32_MAX) return UNSUCCESSFUL;
+            grown = (WheelTimer *)realloc(wheel->timers,
+                                          cap*sizeof(WheelTimer));
+            if(grown == NULL) return UNSUCCESSFUL;
+            wheel->timers = grown;
+            wheel->timer_cap = cap;
+        }
+        t = (int32_t)wheel->timer_cnt++;
+    }
+    
+    wheel->timers[t].expires = expires;
+    wheel->timers[t].slot = slot;
+    place(wheel, t);
+    wheel->pending_cnt++;
+    
+    return SUCCESSFUL;
+}
+
+
+/**
+ * Fire every timer of a wheel due by a time, in time order. Timers firing
+ * in the same second come in no particular order. Timers may be added by
+ * fire, those due already fire in this call.
+ * Empty seconds are skipped, up to the end of level 0's rotation.
+ * @param wheel wheel to advance.
+ * @param now last second to expire.
+ * @param fire called for every timer, with context, the timer's slot and
+ *        the time it fired for.
+ * @param context passed to fire.
+ * @return number of timers fired.
+ */
+
+long int wheel_advance(TimerWheel *wheel,
+                       int64_t now,
+                       void (*fire)(void *, int64_t, int64_t),
+                       void *context) {
+    long int fired_cnt = 0;
+    
+    while(wheel->current <= now) {
+        int index = (int)wheel->current & (WHEEL_SIZE - 1);
+        uint64_t later;
+        int64_t next;
+        
+        while(wheel->buckets[0][index] >= 0) {
+            int32_t t = wheel->buckets[0][index];
+            
+            wheel->buckets[0][index] = -1;
+            wheel->occupied[0] &= ~((uint64_t)1 << index);
+            while(t >= 0) { // free each timer first, fire may reuse it
+                WheelTimer timer = wheel->timers[t];
+                wheel->timers[t].next = wheel->free_timer;
+                wheel->free_timer = t;
+                wheel->pending_cnt--;
+                fire(context, timer.slot, timer.expires);
+                fired_cnt++;
+                t = timer.next;
+            }
+        }
+        
+        // Skip to the next bucket with timers, or the next rotation:
+        later = index + 1 < WHEEL_SIZE
+                ? wheel->occupied[0] >> (index + 1) << (index + 1) : 0;
+        if(later)
+            next = (wheel->current & ~(int64_t)(WHEEL_SIZE - 1))
+                   + lowest_bit(later);
+        else
+            next = (wheel->current | (WHEEL_SIZE - 1)) + 1;
+        if(next > now + 1) next = now + 1;
+        wheel->current = next;
+        if((next & (WHEEL_SIZE - 1)) == 0) cascade(wheel);
+    }
+    
+    return fired_cnt;
+}
+
+
+/**
+ * Get the earliest time a wheel may fire a timer. Timers of higher levels
+ * are only known to the bucket, so this is the time their bucket comes up:
+ * advancing the wheel to it fires nothing but brings the timers closer.
+ * @param wheel wheel in question.
+ * @return the time in seconds, INT64_MAX if the wheel has no timers.
+ */
+
+int64_t wheel_next(const TimerWheel *wheel) {
+    int64_t next = INT64_MAX;
+    
+    for(int level = 0; level < WHEEL_LEVELS; level++) {
+        int64_t base = wheel->current >> WHEEL_BITS*level;
+        int index = (int)base & (WHEEL_SIZE - 1);
+        uint64_t occupied = wheel->occupied[level];
+        int64_t t;
+        int ahead;
+        
+        if(!occupied) continue;
+        // Buckets in order from the current one, which only level 0 has
+        // yet to expire; the others' come up again in a whole rotation:
+        if(level > 0) index = (index + 1) & (WHEEL_SIZE - 1);
+        occupied = occupied >> index
+                   | (index ? occupied << (WHEEL_SIZE - index) : 0);
+        ahead = lowest_bit(occupied) + (level > 0);
+        t = level ? (base + ahead) << WHEEL_BITS*level : base + ahead;
+        if(t < next) next = t;
+    }
+    
+    return next;
+}
@@ -0,0 +1,59 @@
+/**
+ * Hierarchical timing wheel.
+ * Timers firing at whole seconds, bucketed by how far ahead they are:
+ * level 0 has a bucket per second of the next 64, level 1 a bucket per 64
+ * seconds of the next 64^2, and so on. Adding a timer is O(1); timers move
+ * down a level when their bucket comes up, at most once per level, so
+ * expiring them is O(1) amortized as well.
+ */
+
+#ifndef WHEEL_H
+#define WHEEL_H
+
+#include <stdint.h>
+
+#include "utils.h"
+
+// ---------------------------------------------------------------------------
+// Module constants
+
+#define WHEEL_BITS 6
+#define WHEEL_SIZE (1 << WHEEL_BITS) /* buckets per level */
+#define WHEEL_LEVELS 6 /* the last level spans 64^6 seconds, 2000 years */
+
+// ---------------------------------------------------------------------------
+// TimerWheel struct
+// Timers live in one growing array and link to each other by position,
+// like interval tree nodes; fired timers are reused by the next ones added.
+
+typedef struct {
+    int64_t expires; // time the timer fires, in seconds
+    int64_t slot; // what the timer is for, given back when it fires
+    int32_t next; // next timer of the bucket or free list, -1 if none
+} WheelTimer;
+
+typedef struct {
+    WheelTimer *timers;
+    long int timer_cnt; // timers in use or free
+    long int timer_cap;
+    int32_t free_timer; // first free timer, -1 if none
+    int32_t buckets[WHEEL_LEVELS][WHEEL_SIZE]; // first timers, -1 if none
+    uint64_t occupied[WHEEL_LEVELS]; // bit i is set if bucket i has timers
+    int64_t current; // next second to expire
+    long int pending_cnt; // number of timers not fired yet
+} TimerWheel;
+
+// ---------------------------------------------------------------------------
+// Functions Prototypes
+
+void wheel_init(TimerWheel *wheel, int64_t now);
+void wheel_free(TimerWheel *wheel);
+void wheel_reset(TimerWheel *wheel, int64_t now);
+int wheel_add(TimerWheel *wheel, int64_t expires, int64_t slot);
+long int wheel_advance(TimerWheel *wheel,
+                       int64_t now,
+                       void (*fire)(void *, int64_t, int64_t),
+                       void *context);
+int64_t wheel_next(const TimerWheel *wheel);
+
+#endif